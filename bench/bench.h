@@ -0,0 +1,56 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+/*
+ * Small helpers shared by the benchmark programs. These are not part of the
+ * library, they only exist to keep each bench_*.c file focused on what it
+ * measures.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, good enough to generate workloads and cheap to inline */
+static inline uint64_t bench_random(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+  return x * UINT64_C(0x2545f4914f6cdd1d);
+}
+
+/* Keeps the optimizer from discarding results we only compute to time them */
+static inline void bench_consume(uint64_t value) {
+  static volatile uint64_t sink;
+  sink ^= value;
+}
+
+static inline size_t bench_arg(int argc, char **argv, int index, size_t fallback) {
+  return argc > index ? (size_t) strtoull(argv[index], 0, 10) : fallback;
+}
+
+#endif /* _BENCH_H_ */
@@ -0,0 +1,96 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Builds the same table with one pdict_put per key and with pdict_bulk_load
+ * on a growing amount of threads. Every figure is the best of BENCH_RUNS, so
+ * the first run paying for page faults on fresh memory does not skew it.
+ *
+ * Usage: bench_bulk_load [keys] [max threads]
+ */
+
+#include "bench.h"
+#include "putils/pdict.h"
+#include <string.h>
+
+#define BENCH_KEY_LEN 24
+#define BENCH_RUNS 3
+
+static double bench_build(pdict_options *options, const void **keys, size_t *lens, void **values,
+                          size_t count, size_t threads) {
+  double best = 0;
+
+  for (size_t run = 0; run < BENCH_RUNS; ++run) {
+    double start = bench_now();
+    pdict *dict;
+
+    if (threads) {
+      dict = pdict_bulk_load_with_options(options, keys, lens, values, count, threads);
+    } else {
+      dict = pdict_create_with_options(options);
+      for (size_t i = 0; i < count; ++i) {
+        pdict_put_n(dict, keys[i], lens[i], values[i]);
+      }
+    }
+
+    double elapsed = bench_now() - start;
+    best = run == 0 || elapsed < best ? elapsed : best;
+    bench_consume(pdict_size(dict));
+    pdict_destroy(dict);
+  }
+
+  return best;
+}
+
+static void bench_mode(const char *name, pdict_mode mode, const void **keys, size_t *lens,
+                       void **values, size_t count, size_t max_threads) {
+  pdict_options options = {.mode = mode};
+  double sequential = bench_build(&options, keys, lens, values, count, 0);
+
+  printf("  %-7s pdict_put:            %7.1f ms\n", name, sequential * 1e3);
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    double bulk = bench_build(&options, keys, lens, values, count, threads);
+    printf("  %-7s bulk load, %2zu threads: %7.1f ms (%.1fx)\n", name, threads, bulk * 1e3,
+           sequential / bulk);
+  }
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 4u << 20);
+  size_t max_threads = bench_arg(argc, argv, 2, 8);
+  char (*names)[BENCH_KEY_LEN] = malloc(count * sizeof(*names));
+  const void **keys = malloc(count * sizeof(*keys));
+  size_t *lens = malloc(count * sizeof(*lens));
+  void **values = malloc(count * sizeof(*values));
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(names[i], sizeof(names[i]), "user:%016zx", i * UINT64_C(0x9e3779b97f4a7c15));
+    keys[i] = names[i];
+    lens[i] = strlen(names[i]);
+    values[i] = names[i];
+  }
+
+  printf("%zu keys\n", count);
+  bench_mode("chained", PDICT_CHAINED, keys, lens, values, count, max_threads);
+  bench_mode("open", PDICT_OPEN_ADDRESSING, keys, lens, values, count, max_threads);
+
+  free(names);
+  free(keys);
+  free(lens);
+  free(values);
+  return 0;
+}
@@ -0,0 +1,147 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Throughput of a 90% get / 10% put workload on random keys, run with 1, 2,
+ * 4... threads, for a pdict behind one global mutex and for pdict_concurrent.
+ *
+ * Usage: bench_concurrent [max threads] [keys] [ops per thread]
+ */
+
+#include "bench.h"
+#include "putils/pdict_concurrent.h"
+#include <pthread.h>
+#include <string.h>
+
+#define BENCH_KEY_LEN 24
+
+typedef struct bench_context bench_context;
+struct bench_context {
+  pdict *locked;
+  pthread_mutex_t mutex;
+  pdict_concurrent *sharded;
+  char (*keys)[BENCH_KEY_LEN];
+  size_t count;
+  size_t ops;
+};
+
+typedef struct bench_worker bench_worker;
+struct bench_worker {
+  bench_context *context;
+  uint64_t seed;
+  pthread_t thread;
+};
+
+static void *bench_locked(void *arg) {
+  bench_worker *worker = arg;
+  bench_context *context = worker->context;
+  uint64_t state = worker->seed;
+  uint64_t acc = 0;
+
+  for (size_t i = 0; i < context->ops; ++i) {
+    uint64_t random = bench_random(&state);
+    char *key = context->keys[(random >> 8) % context->count];
+
+    pthread_mutex_lock(&context->mutex);
+
+    if (random % 10 == 0) {
+      pdict_put(context->locked, key, key);
+    } else {
+      acc += (uintptr_t) pdict_get_value(context->locked, key);
+    }
+
+    pthread_mutex_unlock(&context->mutex);
+  }
+
+  bench_consume(acc);
+  return 0;
+}
+
+static void *bench_sharded(void *arg) {
+  bench_worker *worker = arg;
+  bench_context *context = worker->context;
+  uint64_t state = worker->seed;
+  uint64_t acc = 0;
+
+  for (size_t i = 0; i < context->ops; ++i) {
+    uint64_t random = bench_random(&state);
+    char *key = context->keys[(random >> 8) % context->count];
+
+    if (random % 10 == 0) {
+      pdict_concurrent_put(context->sharded, key, key);
+    } else {
+      acc += (uintptr_t) pdict_concurrent_get_value(context->sharded, key);
+    }
+  }
+
+  bench_consume(acc);
+  return 0;
+}
+
+static double bench_run(bench_context *context, size_t threads, void *(*body)(void *)) {
+  bench_worker *workers = calloc(threads, sizeof(bench_worker));
+  double start = bench_now();
+
+  for (size_t i = 0; i < threads; ++i) {
+    workers[i].context = context;
+    workers[i].seed = 88172645463325252ull + i * 7919;
+    pthread_create(&workers[i].thread, 0, body, &workers[i]);
+  }
+
+  for (size_t i = 0; i < threads; ++i) {
+    pthread_join(workers[i].thread, 0);
+  }
+
+  double elapsed = bench_now() - start;
+  free(workers);
+  return (double)(threads * context->ops) / elapsed / 1e6;
+}
+
+int main(int argc, char **argv) {
+  size_t max_threads = bench_arg(argc, argv, 1, 64);
+  bench_context context = {
+    .count = bench_arg(argc, argv, 2, 1u << 20),
+    .ops = bench_arg(argc, argv, 3, 1u << 20),
+  };
+
+  context.keys = malloc(context.count * sizeof(*context.keys));
+  context.locked = pdict_create_with_capacity(context.count);
+  context.sharded = pdict_concurrent_create_with_options(&(pdict_options) {
+    .capacity = context.count
+  }, 0);
+  pthread_mutex_init(&context.mutex, 0);
+
+  for (size_t i = 0; i < context.count; ++i) {
+    snprintf(context.keys[i], BENCH_KEY_LEN, "user:%zu", i);
+    pdict_put(context.locked, context.keys[i], context.keys[i]);
+    pdict_concurrent_put(context.sharded, context.keys[i], context.keys[i]);
+  }
+
+  printf("%zu keys, %zu ops per thread, 90%% get / 10%% put\n", context.count, context.ops);
+  printf("  threads   global mutex (Mops/s)   sharded (Mops/s)\n");
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+    double locked = bench_run(&context, threads, bench_locked);
+    double sharded = bench_run(&context, threads, bench_sharded);
+    printf("  %7zu   %21.2f   %16.2f\n", threads, locked, sharded);
+  }
+
+  pthread_mutex_destroy(&context.mutex);
+  pdict_destroy(context.locked);
+  pdict_concurrent_destroy(context.sharded);
+  free(context.keys);
+  return 0;
+}
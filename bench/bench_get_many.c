@@ -0,0 +1,98 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Compares pdict_get_many against the same lookups done one pdict_get_n at a
+ * time, on tables big enough not to fit in the last level cache. Lookups hit
+ * random keys, in batches the size of a request fan-out.
+ *
+ * Usage: bench_get_many [keys] [lookups]
+ */
+
+#include "bench.h"
+#include "putils/pdict.h"
+#include <string.h>
+
+#define BENCH_KEY_LEN 24
+
+static void bench_mode(const char *name, pdict_mode mode, char (*keys)[BENCH_KEY_LEN],
+                       size_t count, size_t lookups) {
+  pdict *dict = pdict_create_with_options(&(pdict_options) {
+    .mode = mode,
+    .capacity = count,
+  });
+  const void **lookup_keys = malloc(lookups * sizeof(*lookup_keys));
+  size_t *lookup_lens = malloc(lookups * sizeof(*lookup_lens));
+  void **values = malloc(lookups * sizeof(*values));
+  size_t batches[] = {16, 64, 256};
+  uint64_t state = 88172645463325252ull;
+  uint64_t acc = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    pdict_put(dict, keys[i], keys[i]);
+  }
+
+  for (size_t i = 0; i < lookups; ++i) {
+    lookup_keys[i] = keys[bench_random(&state) % count];
+    lookup_lens[i] = strlen(lookup_keys[i]);
+  }
+
+  double start = bench_now();
+
+  for (size_t i = 0; i < lookups; ++i) {
+    acc += (uintptr_t) pdict_get_n(dict, lookup_keys[i], lookup_lens[i]);
+  }
+
+  double single = bench_now() - start;
+  printf("  %-7s single gets:      %6.1f ns/key\n", name, single * 1e9 / (double) lookups);
+
+  for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b) {
+    size_t batch = batches[b];
+    start = bench_now();
+
+    for (size_t done = 0; done < lookups; done += batch) {
+      size_t n = lookups - done < batch ? lookups - done : batch;
+      acc += pdict_get_many(dict, lookup_keys + done, lookup_lens + done, n, values + done);
+    }
+
+    double many = bench_now() - start;
+    printf("  %-7s get_many of %3zu: %6.1f ns/key (%.2fx)\n", name, batch,
+           many * 1e9 / (double) lookups, single / many);
+  }
+
+  bench_consume(acc);
+  free(lookup_keys);
+  free(lookup_lens);
+  free(values);
+  pdict_destroy(dict);
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 4u << 20);
+  size_t lookups = bench_arg(argc, argv, 2, 4u << 20);
+  char (*keys)[BENCH_KEY_LEN] = malloc(count * sizeof(*keys));
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(keys[i], sizeof(keys[i]), "session:%08zu", i);
+  }
+
+  printf("%zu keys, %zu random lookups\n", count, lookups);
+  bench_mode("chained", PDICT_CHAINED, keys, count, lookups);
+  bench_mode("open", PDICT_OPEN_ADDRESSING, keys, count, lookups);
+
+  free(keys);
+  return 0;
+}
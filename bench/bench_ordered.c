@@ -0,0 +1,113 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+/*
+ * Heap bytes per entry of pdict_ordered next to both pdict modes, holding
+ * the same keys, plus the cost of filling and probing each of them. Memory
+ * is measured with glibc's mallinfo2, so it includes allocator overhead.
+ *
+ * Usage: bench_ordered [keys]
+ */
+
+#include "bench.h"
+#include "putils/pdict.h"
+#include "putils/pdict_ordered.h"
+#include <string.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#define BENCH_KEY_LEN 24
+
+static size_t bench_heap(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+static void bench_report(const char *name, size_t count, size_t heap, double put, double get) {
+  printf("  %-8s %6.1f bytes/entry, put %5.1f ns, get %5.1f ns\n", name,
+         (double) heap / (double) count, put * 1e9 / (double) count,
+         get * 1e9 / (double) count);
+}
+
+static void bench_pdict(const char *name, pdict_mode mode, char (*keys)[BENCH_KEY_LEN],
+                        size_t count) {
+  size_t before = bench_heap();
+  pdict *dict = pdict_create_with_options(&(pdict_options) {
+    .mode = mode,
+  });
+  uint64_t acc = 0;
+  double start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    pdict_put(dict, keys[i], keys[i]);
+  }
+
+  double put = bench_now() - start;
+  size_t heap = bench_heap() - before;
+  start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    acc += (uintptr_t) pdict_get_value(dict, keys[i]);
+  }
+
+  bench_report(name, count, heap, put, bench_now() - start);
+  bench_consume(acc);
+  pdict_destroy(dict);
+}
+
+static void bench_pdict_ordered(char (*keys)[BENCH_KEY_LEN], size_t count) {
+  size_t before = bench_heap();
+  pdict_ordered *dict = pdict_ordered_create();
+  uint64_t acc = 0;
+  double start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    pdict_ordered_put(dict, keys[i], keys[i]);
+  }
+
+  double put = bench_now() - start;
+  size_t heap = bench_heap() - before;
+  start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    acc += (uintptr_t) pdict_ordered_get_value(dict, keys[i]);
+  }
+
+  bench_report("ordered", count, heap, put, bench_now() - start);
+  bench_consume(acc);
+  pdict_ordered_destroy(dict);
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 1u << 20);
+  char (*keys)[BENCH_KEY_LEN] = malloc(count * sizeof(*keys));
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(keys[i], sizeof(keys[i]), "user:%08zu", i);
+  }
+
+  printf("%zu keys of %zu bytes\n", count, strlen(keys[0]));
+  bench_pdict("chained", PDICT_CHAINED, keys, count);
+  bench_pdict("open", PDICT_OPEN_ADDRESSING, keys, count);
+  bench_pdict_ordered(keys, count);
+
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Replays a Zipfian trace through pcache with every policy and a few cache
+ * sizes, reporting the hit ratio and the cost of each request. A request is
+ * a get followed by a put on a miss, as a read-through cache would do.
+ *
+ * Usage: bench_pcache [keys] [requests] [alpha x 100]
+ */
+
+#include "bench.h"
+#include "putils/pcache.h"
+#include <math.h>
+
+#define BENCH_KEY_LEN 24
+
+/* Cumulative distribution of ranks 1..count, weighted 1 / rank^alpha */
+static double *zipf_cdf(size_t count, double alpha) {
+  double *cdf = malloc(count * sizeof(*cdf));
+  double sum = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    sum += 1.0 / pow((double)(i + 1), alpha);
+    cdf[i] = sum;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    cdf[i] /= sum;
+  }
+  return cdf;
+}
+
+static size_t zipf_draw(const double *cdf, size_t count, uint64_t *state) {
+  double u = (double)(bench_random(state) >> 11) * 0x1.0p-53;
+  size_t low = 0, high = count - 1;
+
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+
+    if (cdf[mid] < u) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+static void bench_policy(const char *name, pcache_policy policy, size_t capacity,
+                         char (*keys)[BENCH_KEY_LEN], const uint32_t *trace, size_t requests) {
+  pcache *cache = pcache_create_with_options(&(pcache_options) {
+    .policy = policy,
+    .max_entries = capacity,
+  });
+  uint64_t acc = 0;
+  double start = bench_now();
+
+  for (size_t i = 0; i < requests; ++i) {
+    char *key = keys[trace[i]];
+    void *value = pcache_get_value(cache, key);
+
+    if (!value) {
+      value = key;
+      pcache_put(cache, key, value);
+    }
+    acc += (uintptr_t) value;
+  }
+
+  double elapsed = bench_now() - start;
+  printf("  %-7s hit ratio %5.1f%%  %6.1f ns/request\n", name, pcache_hit_ratio(cache) * 100,
+         elapsed * 1e9 / (double) requests);
+
+  bench_consume(acc);
+  pcache_destroy(cache);
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 1u << 20);
+  size_t requests = bench_arg(argc, argv, 2, 4u << 20);
+  double alpha = (double) bench_arg(argc, argv, 3, 99) / 100.0;
+  char (*keys)[BENCH_KEY_LEN] = malloc(count * sizeof(*keys));
+  uint32_t *trace = malloc(requests * sizeof(*trace));
+  double *cdf = zipf_cdf(count, alpha);
+  uint64_t state = 88172645463325252ull;
+  size_t ratios[] = {1000, 100, 10};
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(keys[i], sizeof(keys[i]), "object:%08zu", i);
+  }
+  for (size_t i = 0; i < requests; ++i) {
+    trace[i] = (uint32_t) zipf_draw(cdf, count, &state);
+  }
+
+  printf("%zu keys, %zu requests, zipf alpha %.2f\n", count, requests, alpha);
+
+  for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); ++r) {
+    size_t capacity = count / ratios[r] ? count / ratios[r] : 1;
+
+    printf("cache of %zu entries (1/%zu of the keys)\n", capacity, ratios[r]);
+    bench_policy("lru", PCACHE_LRU, capacity, keys, trace, requests);
+    bench_policy("clock", PCACHE_CLOCK, capacity, keys, trace, requests);
+    bench_policy("s3fifo", PCACHE_S3FIFO, capacity, keys, trace, requests);
+  }
+
+  free(cdf);
+  free(trace);
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Compares phash_bytes against the djb2 hash pdict used to ship with:
+ *
+ *  - throughput for several key lengths
+ *  - chain length distribution for a chained table reduced with modulo, using
+ *    the bucket counts pdict grows through (20 * 2^n)
+ *  - average and worst probe length for a power of two linear probing table
+ *
+ * Usage: bench_phash [keys]
+ */
+
+#include "bench.h"
+#include "putils/phash.h"
+#include <string.h>
+
+typedef uint64_t (*bench_hasher)(const void *key, size_t len, uint64_t seed);
+
+static void bench_throughput(const char *name, bench_hasher hasher, size_t key_len) {
+  size_t iterations = (64u << 20) / (key_len + 1);
+  unsigned char *key = malloc(key_len + 8);
+  uint64_t state = 88172645463325252ull;
+  uint64_t acc = 0;
+
+  for (size_t i = 0; i < key_len + 8; ++i) {
+    key[i] = (unsigned char)('a' + bench_random(&state) % 26);
+  }
+
+  double start = bench_now();
+
+  for (size_t i = 0; i < iterations; ++i) {
+    key[i % key_len] ^= (unsigned char) acc;
+    acc += hasher(key, key_len, 1);
+  }
+
+  double elapsed = bench_now() - start;
+  bench_consume(acc);
+  printf("  %-6s len %3zu: %7.2f ns/hash %8.1f MB/s\n", name, key_len,
+         elapsed * 1e9 / (double) iterations,
+         (double)(iterations * key_len) / elapsed / 1e6);
+  free(key);
+}
+
+static void bench_distribution(const char *name, bench_hasher hasher,
+                               char (*keys)[48], size_t count) {
+  size_t buckets = 20;
+  while (buckets < count) buckets *= 2;
+
+  size_t *chains = calloc(buckets, sizeof(size_t));
+  for (size_t i = 0; i < count; ++i) {
+    chains[hasher(keys[i], strlen(keys[i]), 1) % buckets]++;
+  }
+
+  size_t max_chain = 0, used = 0;
+  double squares = 0;
+  for (size_t i = 0; i < buckets; ++i) {
+    if (chains[i] > max_chain) max_chain = chains[i];
+    if (chains[i]) used++;
+    squares += (double)(chains[i] * chains[i]);
+  }
+
+  /* expected sum of squares for an ideal uniform hash: n + n(n-1)/m */
+  double ideal = (double) count + (double) count * (double)(count - 1) / (double) buckets;
+
+  size_t capacity = 16;
+  while (capacity * 7 / 8 < count) capacity *= 2;
+  unsigned char *taken = calloc(capacity, 1);
+  size_t total_probes = 0, max_probes = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t slot = hasher(keys[i], strlen(keys[i]), 1) & (capacity - 1);
+    size_t probes = 1;
+
+    while (taken[slot]) {
+      slot = (slot + 1) & (capacity - 1);
+      probes++;
+    }
+
+    taken[slot] = 1;
+    total_probes += probes;
+    if (probes > max_probes) max_probes = probes;
+  }
+
+  printf("  %-6s chained: %zu buckets, %.1f%% used, max chain %zu, "
+         "sum of squares %.2fx ideal\n",
+         name, buckets, 100.0 * (double) used / (double) buckets, max_chain,
+         squares / ideal);
+  printf("  %-6s probing: capacity %zu, avg probe %.2f, max probe %zu\n",
+         name, capacity, (double) total_probes / (double) count, max_probes);
+  free(chains);
+  free(taken);
+}
+
+static uint64_t bench_djb2(const void *key, size_t len, uint64_t seed) {
+  return phash_djb2(key, len, 0);
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 1u << 20);
+  size_t lengths[] = {8, 16, 40, 64, 120};
+
+  printf("throughput\n");
+  for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i) {
+    bench_throughput("djb2", bench_djb2, lengths[i]);
+    bench_throughput("phash", phash_bytes, lengths[i]);
+  }
+
+  char (*keys)[48] = malloc(count * sizeof(*keys));
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(keys[i], sizeof(keys[i]), "session:%08zu", i);
+  }
+
+  printf("distribution, %zu sequential session keys\n", count);
+  bench_distribution("djb2", bench_djb2, keys, count);
+  bench_distribution("phash", phash_bytes, keys, count);
+
+  free(keys);
+  return 0;
+}
@@ -0,0 +1,144 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+/*
+ * Compares the linked and the unrolled plist layouts: building a list with
+ * appends, walking it with plist_iterate and removing everything from the
+ * front. The linked list gets one allocation per element, the unrolled one
+ * packs PLIST_CHUNK_SLOTS of them per cache aligned chunk.
+ *
+ * It then runs a queue workload (append at the tail, remove from the front,
+ * about a thousand messages in flight) on plain and pooled lists, and a
+ * purge dropping every other element, by index and with a plist_cursor.
+ *
+ * Usage: bench_plist [elements]
+ */
+
+#include "bench.h"
+#include "putils/plist.h"
+
+static uint64_t bench_sum;
+
+static void bench_add(void *data) {
+  bench_sum += (uintptr_t) data;
+}
+
+static void bench_layout(const char *name, plist * (*create)(void), size_t count) {
+  plist *list = create();
+  double start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    plist_append(list, (void *)(uintptr_t)(i + 1));
+  }
+
+  double append = bench_now() - start;
+  start = bench_now();
+
+  for (int round = 0; round < 5; ++round) {
+    plist_iterate(list, bench_add);
+  }
+
+  double iterate = (bench_now() - start) / 5;
+  start = bench_now();
+
+  while (!plist_is_empty(list)) {
+    bench_sum += (uintptr_t) plist_remove(list, 0);
+  }
+
+  double drain = bench_now() - start;
+  printf("  %-9s append %5.1f ns/elem, iterate %5.2f ns/elem, remove front %5.1f ns/elem\n",
+         name, append * 1e9 / (double) count, iterate * 1e9 / (double) count,
+         drain * 1e9 / (double) count);
+
+  bench_consume(bench_sum);
+  plist_destroy(&list);
+}
+
+static void bench_queue(const char *name, plist * (*create)(void), size_t count) {
+  plist *list = create();
+  ppool_stats stats = {0};
+
+  for (size_t i = 0; i < 1024; ++i) {
+    plist_append(list, (void *)(uintptr_t)(i + 1));
+  }
+
+  double start = bench_now();
+
+  for (size_t i = 0; i < count; ++i) {
+    plist_append(list, (void *)(uintptr_t)(i + 1));
+    bench_sum += (uintptr_t) plist_remove(list, 0);
+  }
+
+  double elapsed = bench_now() - start;
+  plist_pool_stats(list, &stats);
+  printf("  %-9s %5.1f ns/message, %zu slabs\n", name, elapsed * 1e9 / (double) count,
+         stats.slabs);
+
+  bench_consume(bench_sum);
+  plist_destroy(&list);
+}
+
+static void bench_purge(const char *name, plist * (*create)(void), size_t count,
+                        bool with_cursor) {
+  plist *list = create();
+
+  for (size_t i = 0; i < count; ++i) {
+    plist_append(list, (void *)(uintptr_t)(i + 1));
+  }
+
+  double start = bench_now();
+
+  if (with_cursor) {
+    plist_cursor cursor;
+    void *data;
+
+    plist_cursor_init(&cursor, list);
+    while (plist_cursor_next(&cursor, &data)) {
+      if ((uintptr_t) data % 2 == 0) {
+        bench_sum += (uintptr_t) plist_cursor_remove_current(&cursor);
+      }
+    }
+  } else {
+    for (size_t i = 1; i < plist_size(list); ++i) {
+      bench_sum += (uintptr_t) plist_remove(list, i);
+    }
+  }
+
+  double elapsed = bench_now() - start;
+  printf("  %-9s %-7s %7.1f ns/element\n", name, with_cursor ? "cursor" : "index",
+         elapsed * 1e9 / (double) count);
+
+  bench_consume(bench_sum);
+  plist_destroy(&list);
+}
+
+int main(int argc, char **argv) {
+  size_t count = bench_arg(argc, argv, 1, 10000000);
+
+  printf("%zu elements\n", count);
+  bench_layout("linked", plist_create, count);
+  bench_layout("unrolled", plist_create_unrolled, count);
+  printf("queue of 1024 messages, %zu enqueue/dequeue pairs\n", count);
+  bench_queue("malloc", plist_create, count);
+  bench_queue("pooled", plist_create_pooled, count);
+
+  size_t purged = count / 200;
+  printf("purge every other element of %zu\n", purged);
+  bench_purge("linked", plist_create, purged, false);
+  bench_purge("linked", plist_create, purged, true);
+  bench_purge("unrolled", plist_create_unrolled, purged, false);
+  bench_purge("unrolled", plist_create_unrolled, purged, true);
+  return 0;
+}
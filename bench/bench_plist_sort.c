@@ -0,0 +1,82 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+/*
+ * Times plist_sort on linked lists holding random, sorted, reversed and
+ * nearly sorted (1% of the elements moved) input, for growing sizes, and
+ * plist_sort_parallel on the same input.
+ *
+ * Lists are pooled so that every one starts with its nodes laid out in
+ * order, whatever the previous runs left in the malloc free lists.
+ *
+ * Usage: bench_plist_sort [max elements] [threads]
+ */
+
+#include "bench.h"
+#include "putils/plist.h"
+
+static bool bench_less(const void *a, const void *b) {
+  return (uintptr_t) a < (uintptr_t) b;
+}
+
+static uintptr_t bench_key(const char *shape, size_t i, size_t count, uint64_t *state) {
+  switch (shape[0]) {
+    case 's':
+      return i;
+    case 'r':
+      return shape[2] == 'v' ? count - i : bench_random(state) % count;
+    default:
+      return bench_random(state) % 100 == 0 ? bench_random(state) % count : i;
+  }
+}
+
+static void bench_shape(const char *shape, size_t count, size_t nthreads) {
+  plist *list = plist_create_pooled();
+  uint64_t state = 88172645463325252ull;
+
+  for (size_t i = 0; i < count; ++i) {
+    plist_append(list, (void *) bench_key(shape, i, count, &state));
+  }
+
+  double start = bench_now();
+  if (nthreads) {
+    plist_sort_parallel(list, bench_less, nthreads);
+  } else {
+    plist_sort(list, bench_less);
+  }
+  double elapsed = bench_now() - start;
+
+  printf("  %-8s %9zu elements, %-11s %8.1f ms, %6.1f ns/element\n", shape, count,
+         nthreads ? "parallel:" : "sequential:", elapsed * 1e3,
+         elapsed * 1e9 / (double) count);
+
+  bench_consume((uintptr_t) plist_get(list, 0));
+  plist_destroy(&list);
+}
+
+int main(int argc, char **argv) {
+  size_t max = bench_arg(argc, argv, 1, 10000000);
+  size_t nthreads = bench_arg(argc, argv, 2, 4);
+  const char *shapes[] = {"random", "sorted", "reversed", "nearly"};
+
+  for (size_t count = 100000; count <= max; count *= 10) {
+    for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); ++s) {
+      bench_shape(shapes[s], count, 0);
+      bench_shape(shapes[s], count, nthreads);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,161 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PCACHE_H_
+#define _PCACHE_H_
+/*!
+ * \file pcache.h
+ * \brief Header for the bounded cache.
+ */
+
+#include "pdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief Replacement policy of a [@ref pcache].
+ *
+ * __Detail:__
+ *
+ * - PCACHE_LRU evicts the least recently used entry. Every hit moves the
+ *   entry to the front of the recency list.
+ * - PCACHE_CLOCK approximates LRU with a reference bit and a sweeping hand.
+ *   A hit only sets the bit, so it never reorders anything.
+ * - PCACHE_S3FIFO keeps a small FIFO queue for new entries (a tenth of the
+ *   budget), a main queue for the ones hit while in it, and a ghost queue with
+ *   the keys recently dropped from the small one. On skewed traces this
+ *   usually beats LRU, since one hit wonders leave quickly.
+ */
+typedef enum pcache_policy {
+  PCACHE_LRU,
+  PCACHE_CLOCK,
+  PCACHE_S3FIFO
+} pcache_policy;
+
+typedef struct pcache_options pcache_options;
+struct pcache_options {
+  pcache_policy policy;
+  /* Maximum amount of entries, 0 for no limit */
+  size_t max_entries;
+  /* Maximum sum of the charges given to pcache_put_charged, 0 for no limit */
+  size_t max_charge;
+  /*
+   * Called with every value leaving the cache because of an eviction or a
+   * replacement. Not called by pcache_remove, which hands the value back.
+   */
+  pdict_context_closure on_evict;
+  void *ctx;
+};
+
+typedef struct pcache_stats pcache_stats;
+struct pcache_stats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t insertions;
+  uint64_t evictions;
+};
+
+/*!
+ * \typedef pcache
+ * \brief Dictionary bounded by an entry count and/or a total charge.
+ *
+ * __Detail:__
+ *
+ * Keys are looked up in a pdict whose values are the cache entries, and the
+ * entries are linked into the policy queues through their own
+ * plist_double_node, so get, put, touch and evict are all O(1).
+ */
+typedef struct pcache pcache;
+
+/*!
+ * \brief Creates an LRU cache holding up to max_entries entries.
+ */
+pcache *pcache_create(size_t max_entries);
+
+pcache *pcache_create_with_options(const pcache_options *options);
+
+/*!
+ * \brief Same as pcache_put_charged with a charge of 1.
+ */
+void pcache_put(pcache *self, char *key, void *value);
+
+/*!
+ * \brief Stores value under key, accounted as charge towards max_charge,
+ * and evicts entries until the cache is back within its budget.
+ *
+ * __Detail:__
+ *
+ * Replacing a key keeps its place in the policy queues and counts as a use.
+ * An entry bigger than the whole budget is never stored: any previous value
+ * under key is dropped and value goes straight to on_evict, leaving the other
+ * entries alone.
+ */
+void pcache_put_charged(pcache *self, char *key, void *value, size_t charge);
+
+/*!
+ * \brief Returns the value of key, or null, and marks it as used.
+ * Updates the hit and miss counters.
+ */
+void *pcache_get_value(pcache *self, char *key);
+
+/*!
+ * \brief Returns the value of key without marking it as used nor updating
+ * the counters.
+ */
+void *pcache_peek(pcache *self, char *key);
+
+/*!
+ * \brief Marks key as used. Returns whether it is cached.
+ */
+bool pcache_touch(pcache *self, char *key);
+
+bool pcache_has_key(pcache *self, char *key);
+
+/*!
+ * \brief Removes key and returns its value without calling on_evict.
+ */
+void *pcache_remove(pcache *self, char *key);
+
+/*!
+ * \brief Evicts the entry the policy picks next.
+ * \return false if the cache is empty.
+ */
+bool pcache_evict(pcache *self);
+
+size_t pcache_size(pcache *self);
+
+/*!
+ * \brief Sum of the charges of the cached entries.
+ */
+size_t pcache_charge(pcache *self);
+
+void pcache_get_stats(pcache *self, pcache_stats *stats);
+
+/*!
+ * \brief Hits over lookups done by pcache_get_value, 0 before any lookup.
+ */
+double pcache_hit_ratio(pcache *self);
+
+void pcache_reset_stats(pcache *self);
+
+/*!
+ * \brief Frees the cache, without calling on_evict on the cached values.
+ */
+void pcache_destroy(pcache *self);
+
+void pcache_destroy_all(pcache *self, pdict_destroyer destroyer);
+
+#endif /* _PCACHE_H_ */
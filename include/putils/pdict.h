@@ -21,14 +21,51 @@
 
 #include "pnode.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef struct pdict pdict;
 
+/*
+ * PDICT_CHAINED keeps one heap node per entry linked from its bucket.
+ * PDICT_OPEN_ADDRESSING stores entries inline in a flat slot array probed in
+ * groups of 16 control bytes (SSE2 when available, scalar otherwise).
+ */
+typedef enum pdict_mode {
+  PDICT_CHAINED = 0,
+  PDICT_OPEN_ADDRESSING
+} pdict_mode;
+
+/*
+ * Hash function used to place keys, phash_bytes by default. The seed is the
+ * per table value from pdict_options (or a random one when that is 0).
+ */
+typedef uint64_t (*pdict_hasher)(const void *key, size_t key_len, uint64_t seed);
+
+typedef struct pdict_options pdict_options;
+struct pdict_options {
+  pdict_mode mode;
+  pdict_hasher hasher;
+  uint64_t seed;
+  /*
+   * Chained mode only: grow by moving a few buckets on every put/get/remove
+   * (or pdict_rehash_step calls) instead of rehashing everything at once.
+   */
+  bool incremental_rehash;
+  /* Elements the table can hold before growing, PDICT_INITIAL_SIZE if 0 */
+  size_t capacity;
+  /*
+   * Max elements per bucket (chained) or slot (open addressing) before the
+   * table grows. 0 picks the mode default, 1.0 and 0.875 respectively.
+   */
+  double max_load_factor;
+};
+
 typedef struct pdict_entry pdict_entry;
 struct pdict_entry {
   void *value;
   char *key;
+  size_t key_len;
 };
 
 typedef struct pdict_entries pdict_entries;
@@ -41,10 +78,157 @@ typedef void (*pdict_destroyer)(void *data);
 
 typedef void (*pdict_closure)(char *key, void *value);
 
+typedef void (*pdict_context_closure)(char *key, void *value, void *ctx);
+
+/*
+ * Cursor over the entries of a dictionary, meant to live on the stack. It is
+ * invalidated by any put or remove, and by lookups on a chained dictionary
+ * that is rehashing incrementally (they move buckets around).
+ */
+typedef struct pdict_iter pdict_iter;
+struct pdict_iter {
+  pdict *dict;
+  size_t table;
+  size_t index;
+  pdict_node *node;
+};
+
+/* Entries of pdict_statistics.length_histogram, the last one counts the rest */
+#define PDICT_STATS_HISTOGRAM 8
+
+/*
+ * Health report filled by pdict_stats. The table shape and memory figures are
+ * computed when asked for. The counters are only maintained when the library
+ * is built with PDICT_ENABLE_STATS, otherwise counters_enabled is false and
+ * they stay at zero.
+ */
+typedef struct pdict_statistics pdict_statistics;
+struct pdict_statistics {
+  pdict_mode mode;
+  size_t elements;
+  /* buckets (chained) or slots (open addressing) of the current table */
+  size_t buckets;
+  /* non empty buckets, or full and deleted slots */
+  size_t used_buckets;
+  /* open addressing only */
+  size_t deleted_slots;
+  double load_factor;
+  /*
+   * Chained: buckets by amount of nodes, index 0 being the empty ones.
+   * Open addressing: elements by amount of groups probed to reach them.
+   */
+  size_t length_histogram[PDICT_STATS_HISTOGRAM];
+  size_t max_length;
+  size_t node_bytes;
+  /* keys too long to be stored inline */
+  size_t key_bytes;
+  size_t bucket_bytes;
+  bool counters_enabled;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t resizes;
+  /* time spent growing, shrinking and migrating buckets, in seconds */
+  double resize_seconds;
+};
+
 pdict *pdict_create();
 
+pdict *pdict_create_with_options(const pdict_options *options);
+
+pdict *pdict_create_with_hasher(pdict_hasher hasher, uint64_t seed);
+
+pdict *pdict_create_with_capacity(size_t capacity);
+
+/*
+ * Builds a dictionary out of n keys (lens may be null for NUL terminated
+ * ones) and their values, hashing and linking on nthreads threads. Later
+ * duplicates win, as with pdict_put. The table is sized upfront and nodes and
+ * long keys come from one allocation each, released when the dictionary is
+ * cleaned or destroyed. incremental_rehash applies to the growth after the
+ * load.
+ */
+pdict *pdict_bulk_load(const void *const *keys, const size_t *lens, void *const *values,
+                       size_t n, size_t nthreads);
+
+pdict *pdict_bulk_load_with_options(const pdict_options *options, const void *const *keys,
+                                    const size_t *lens, void *const *values, size_t n,
+                                    size_t nthreads);
+
+/* Grows the table once so that capacity elements fit without resizing */
+void pdict_reserve(pdict *self, size_t capacity);
+
+/* Shrinks the table to the smallest size that fits the current elements */
+void pdict_shrink_to_fit(pdict *self);
+
+/* Open addressing tables cap the load factor at 0.9375 */
+void pdict_set_max_load_factor(pdict *self, double max_load_factor);
+
+double pdict_max_load_factor(pdict *self);
+
+/* Elements the dictionary can hold before its next resize */
+size_t pdict_capacity(pdict *self);
+
 void pdict_put(pdict *self, char *key, void *data);
 
+/*
+ * Stores data under key, replacing the current value if the key is already
+ * there. Returns the replaced value (or null) so callers can release it.
+ * pdict_put does the same but drops the old value.
+ */
+void *pdict_upsert(pdict *self, char *key, void *data);
+
+/* Stores data only if key is missing. Returns whether it was stored. */
+bool pdict_put_if_absent(pdict *self, char *key, void *data);
+
+/*
+ * Returns the value slot for key, inserting the key with a null value if it
+ * was missing (inserted tells which case happened). The slot can be written
+ * directly and stays valid until the dictionary is modified again.
+ */
+void **pdict_get_or_insert(pdict *self, char *key, bool *inserted);
+
+/*
+ * Binary key variants: key is any len bytes (it may contain NULs) and is
+ * neither scanned with strlen nor required to be terminated. Stored keys get
+ * a trailing NUL appended, which is not part of key_len.
+ */
+void pdict_put_n(pdict *self, const void *key, size_t key_len, void *data);
+
+void *pdict_upsert_n(pdict *self, const void *key, size_t key_len, void *data);
+
+void *pdict_get_n(pdict *self, const void *key, size_t key_len);
+
+void **pdict_get_or_insert_n(pdict *self, const void *key, size_t key_len, bool *inserted);
+
+/*
+ * Variants for callers that already hashed key: hash must be what the
+ * dictionary's hasher returns for key with the dictionary's seed, so both
+ * have to be set in pdict_options. pdict_concurrent hashes once this way to
+ * pick a shard and to look the key up inside it.
+ */
+void *pdict_get_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash);
+
+bool pdict_has_key_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash);
+
+void *pdict_upsert_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash,
+                          void *data);
+
+bool pdict_put_if_absent_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash,
+                                void *data);
+
+void *pdict_remove_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash);
+
+void *pdict_remove_n(pdict *self, const void *key, size_t key_len);
+
+/*
+ * Looks up n keys at once, storing each value (or null) in out_values and
+ * returning how many were found. lens may be null for NUL terminated keys.
+ * Keys are hashed and their buckets prefetched a batch at a time before any
+ * of them is compared, so the cache misses of the batch overlap.
+ */
+size_t pdict_get_many(pdict *self, const void *const *keys, const size_t *lens, size_t n,
+                      void **out_values);
+
 void *pdict_get_value(pdict *self, char *key);
 
 pdict_entry pdict_get(pdict *self, char *key);
@@ -57,6 +241,13 @@ void pdict_remove_and_destroy(pdict *self, char *key, pdict_destroyer destroyer)
 
 void pdict_iterate(pdict *self, pdict_closure closure);
 
+void pdict_iterate_with_context(pdict *self, pdict_context_closure closure, void *ctx);
+
+void pdict_iter_init(pdict_iter *iter, pdict *self);
+
+/* Fills entry with the next element, returns false once all were visited */
+bool pdict_iter_next(pdict_iter *iter, pdict_entry *entry);
+
 void pdict_clean(pdict *self);
 
 void pdict_clean_and_destroy_elements(pdict *self, pdict_destroyer destroyer);
@@ -71,4 +262,18 @@ void pdict_destroy(pdict *self);
 
 void pdict_destroy_all(pdict *self, pdict_destroyer destroyer);
 
+/*
+ * Migrates up to `buckets` non empty buckets of a pending incremental rehash.
+ * Meant to be called from idle hooks. Returns true while work remains.
+ */
+bool pdict_rehash_step(pdict *self, size_t buckets);
+
+bool pdict_is_rehashing(pdict *self);
+
+/* Fills stats, walking the whole table, see pdict_statistics */
+void pdict_stats(pdict *self, pdict_statistics *stats);
+
+/* Zeroes the hit, miss and resize counters */
+void pdict_reset_stats(pdict *self);
+
 #endif /* _DICTIONARY_H_ */
@@ -0,0 +1,107 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_CONCURRENT_H_
+#define _PDICT_CONCURRENT_H_
+/*!
+ * \file pdict_concurrent.h
+ * \brief Header for the thread safe sharded dictionary.
+ */
+
+#include "pdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PDICT_CONCURRENT_DEFAULT_SHARDS 64
+
+/*!
+ * \typedef pdict_concurrent
+ * \brief Dictionary safe to use from several threads at once.
+ *
+ * __Detail:__
+ *
+ * Keys are partitioned by the high bits of their hash into a power of two
+ * amount of shards, each one a regular pdict guarded by its own read/write
+ * lock. Lookups take the shard lock shared, so readers only wait for writers
+ * of the same shard, and every lock sits on its own cache line so threads
+ * working on different shards do not invalidate each other's lines.
+ *
+ * Values are handed out as is: keeping them alive while other threads use
+ * them is up to the caller.
+ */
+typedef struct pdict_concurrent pdict_concurrent;
+
+/*!
+ * \brief Creates a dictionary with the given amount of shards.
+ * \param shards: Rounded up to a power of two, PDICT_CONCURRENT_DEFAULT_SHARDS
+ * when 0.
+ */
+pdict_concurrent *pdict_concurrent_create(size_t shards);
+
+/*!
+ * \brief Same as [@ref pdict_concurrent_create] with the options used to
+ * create every shard. capacity is split among the shards and
+ * incremental_rehash is ignored, since it would make lookups write. A null
+ * options uses the defaults, like pdict_create_with_options. Keys are hashed
+ * once with hasher and seed, which pick the shard and are reused inside it.
+ */
+pdict_concurrent *pdict_concurrent_create_with_options(const pdict_options *options,
+                                                       size_t shards);
+
+void pdict_concurrent_put(pdict_concurrent *self, char *key, void *data);
+
+void pdict_concurrent_put_n(pdict_concurrent *self, const void *key, size_t key_len,
+                            void *data);
+
+/*!
+ * \brief Stores data under key, returning the replaced value (or null).
+ */
+void *pdict_concurrent_upsert(pdict_concurrent *self, char *key, void *data);
+
+/*!
+ * \brief Stores data only if key is missing, atomically.
+ * \return Whether it was stored.
+ */
+bool pdict_concurrent_put_if_absent(pdict_concurrent *self, char *key, void *data);
+
+void *pdict_concurrent_get_value(pdict_concurrent *self, char *key);
+
+void *pdict_concurrent_get_n(pdict_concurrent *self, const void *key, size_t key_len);
+
+bool pdict_concurrent_has_key(pdict_concurrent *self, char *key);
+
+void *pdict_concurrent_remove(pdict_concurrent *self, char *key);
+
+void *pdict_concurrent_remove_n(pdict_concurrent *self, const void *key, size_t key_len);
+
+/*!
+ * \brief Visits every entry, holding each shard lock shared while its
+ * entries are visited. The closure must not modify the dictionary.
+ */
+void pdict_concurrent_iterate_with_context(pdict_concurrent *self,
+                                           pdict_context_closure closure, void *ctx);
+
+/*!
+ * \brief Sum of the shard sizes, exact only when no writer is running.
+ */
+size_t pdict_concurrent_size(pdict_concurrent *self);
+
+size_t pdict_concurrent_shard_count(pdict_concurrent *self);
+
+void pdict_concurrent_destroy(pdict_concurrent *self);
+
+void pdict_concurrent_destroy_all(pdict_concurrent *self, pdict_destroyer destroyer);
+
+#endif /* _PDICT_CONCURRENT_H_ */
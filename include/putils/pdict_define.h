@@ -0,0 +1,244 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_DEFINE_H_
+#define _PDICT_DEFINE_H_
+/*!
+ * \file pdict_define.h
+ * \brief Type specialized hash maps generated by macros.
+ *
+ * __Detail:__
+ *
+ * pdict stores arbitrary byte string keys, which is wasteful when keys are
+ * plain integers. PDICT_DEFINE(name, K, V) generates a map type `name` with
+ * keys of type K and values of type V stored by value in one open addressing
+ * array, hashed with an integer mixer and compared with ==. For example:
+ *
+ * ~~~{.c}
+ * PDICT_DEFINE(u64map, uint64_t, void *)
+ *
+ * u64map *map = u64map_create();
+ * u64map_put(map, 42, data);
+ * void **found = u64map_get(map, 42);
+ * ~~~
+ *
+ * generates:
+ *
+ *  - `name *name_create(void)`, `name *name_create_with_capacity(size_t)`
+ *  - `void name_put(name *, K, V)`, replacing the value of an existing key
+ *  - `V *name_get(name *, K)`, pointer to the stored value or null, valid
+ *    until the next put or remove
+ *  - `bool name_has_key(name *, K)`
+ *  - `bool name_remove(name *, K, V *removed)`, removed may be null
+ *  - `void name_iterate(name *, void (*)(K, V, void *), void *ctx)`
+ *  - `name_iter`, `name_iter_init(name_iter *, name *)` and
+ *    `bool name_iter_next(name_iter *, K *, V *)`
+ *  - `name_size`, `name_is_empty`, `name_clean` and `name_destroy`
+ *
+ * PDICT_DEFINE_WITH(name, K, V, hash, equals) does the same with a custom
+ * `uint64_t hash(K)` and `bool equals(K, K)`, e.g. for struct keys.
+ *
+ * Every function is static inline, so a map can be defined in as many
+ * translation units as needed.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PDICT_DEFINE_MIN_SLOTS 16
+
+/* murmur3 finalizer: spreads sequential ids over the whole table */
+static inline uint64_t pdict_define_mix(uint64_t key) {
+  key ^= key >> 33;
+  key *= UINT64_C(0xff51afd7ed558ccd);
+  key ^= key >> 33;
+  key *= UINT64_C(0xc4ceb9fe1a85ec53);
+  key ^= key >> 33;
+  return key;
+}
+
+#define PDICT_DEFINE_HASH(key) pdict_define_mix((uint64_t)(key))
+#define PDICT_DEFINE_EQUALS(a, b) ((a) == (b))
+
+#define PDICT_DEFINE(name, K, V) \
+  PDICT_DEFINE_WITH(name, K, V, PDICT_DEFINE_HASH, PDICT_DEFINE_EQUALS)
+
+/*
+ * Linear probing at a max load of 3/4. Removal shifts the following entries
+ * of the cluster back instead of leaving tombstones, so lookups never get
+ * slower as keys come and go.
+ */
+#define PDICT_DEFINE_WITH(name, K, V, hash, equals) \
+  typedef struct name##_slot name##_slot; \
+  struct name##_slot { \
+    K key; \
+    V value; \
+  }; \
+  \
+  typedef struct name name; \
+  struct name { \
+    size_t mask; \
+    size_t count; \
+    uint8_t *used; \
+    name##_slot *slots; \
+  }; \
+  \
+  typedef struct name##_iter name##_iter; \
+  struct name##_iter { \
+    name *map; \
+    size_t index; \
+  }; \
+  \
+  static inline void name##_allocate(name *self, size_t slots) { \
+    self->mask = slots - 1; \
+    self->count = 0; \
+    self->used = calloc(slots, 1); \
+    self->slots = malloc(slots * sizeof(name##_slot)); \
+  } \
+  \
+  static inline name *name##_create_with_capacity(size_t capacity) { \
+    name *self = malloc(sizeof(name)); \
+    size_t slots = PDICT_DEFINE_MIN_SLOTS; \
+    while (slots / 4 * 3 < capacity) { \
+      slots *= 2; \
+    } \
+    name##_allocate(self, slots); \
+    return self; \
+  } \
+  \
+  static inline name *name##_create(void) { \
+    return name##_create_with_capacity(0); \
+  } \
+  \
+  static inline size_t name##_find(const name *self, K key) { \
+    size_t index = (size_t) hash(key) & self->mask; \
+    while (self->used[index] && !equals(self->slots[index].key, key)) { \
+      index = (index + 1) & self->mask; \
+    } \
+    return index; \
+  } \
+  \
+  static inline void name##_resize(name *self, size_t slots) { \
+    uint8_t *old_used = self->used; \
+    name##_slot *old_slots = self->slots; \
+    size_t old_size = self->mask + 1; \
+    size_t count = self->count; \
+    name##_allocate(self, slots); \
+    for (size_t i = 0; i < old_size; ++i) { \
+      if (old_used[i]) { \
+        size_t index = name##_find(self, old_slots[i].key); \
+        self->used[index] = 1; \
+        self->slots[index] = old_slots[i]; \
+      } \
+    } \
+    self->count = count; \
+    free(old_used); \
+    free(old_slots); \
+  } \
+  \
+  static inline void name##_put(name *self, K key, V value) { \
+    size_t index = name##_find(self, key); \
+    if (!self->used[index]) { \
+      if ((self->count + 1) * 4 > (self->mask + 1) * 3) { \
+        name##_resize(self, (self->mask + 1) * 2); \
+        index = name##_find(self, key); \
+      } \
+      self->used[index] = 1; \
+      self->slots[index].key = key; \
+      self->count++; \
+    } \
+    self->slots[index].value = value; \
+  } \
+  \
+  static inline V *name##_get(name *self, K key) { \
+    size_t index = name##_find(self, key); \
+    return self->used[index] ? &self->slots[index].value : 0; \
+  } \
+  \
+  static inline bool name##_has_key(name *self, K key) { \
+    return self->used[name##_find(self, key)] != 0; \
+  } \
+  \
+  static inline bool name##_remove(name *self, K key, V *removed) { \
+    size_t hole = name##_find(self, key); \
+    if (!self->used[hole]) { \
+      return false; \
+    } \
+    if (removed) { \
+      *removed = self->slots[hole].value; \
+    } \
+    /* move back every later entry of the cluster whose probe passes the hole */ \
+    for (size_t index = (hole + 1) & self->mask; self->used[index]; \
+         index = (index + 1) & self->mask) { \
+      size_t home = (size_t) hash(self->slots[index].key) & self->mask; \
+      if (((index - home) & self->mask) >= ((index - hole) & self->mask)) { \
+        self->slots[hole] = self->slots[index]; \
+        hole = index; \
+      } \
+    } \
+    self->used[hole] = 0; \
+    self->count--; \
+    return true; \
+  } \
+  \
+  static inline void name##_iter_init(name##_iter *iter, name *self) { \
+    iter->map = self; \
+    iter->index = 0; \
+  } \
+  \
+  static inline bool name##_iter_next(name##_iter *iter, K *key, V *value) { \
+    name *self = iter->map; \
+    while (iter->index <= self->mask) { \
+      size_t index = iter->index++; \
+      if (self->used[index]) { \
+        *key = self->slots[index].key; \
+        *value = self->slots[index].value; \
+        return true; \
+      } \
+    } \
+    return false; \
+  } \
+  \
+  static inline void name##_iterate(name *self, void (*closure)(K, V, void *), void *ctx) { \
+    for (size_t index = 0; index <= self->mask; ++index) { \
+      if (self->used[index]) { \
+        closure(self->slots[index].key, self->slots[index].value, ctx); \
+      } \
+    } \
+  } \
+  \
+  static inline size_t name##_size(name *self) { \
+    return self->count; \
+  } \
+  \
+  static inline bool name##_is_empty(name *self) { \
+    return self->count == 0; \
+  } \
+  \
+  static inline void name##_clean(name *self) { \
+    memset(self->used, 0, self->mask + 1); \
+    self->count = 0; \
+  } \
+  \
+  static inline void name##_destroy(name *self) { \
+    free(self->used); \
+    free(self->slots); \
+    free(self); \
+  }
+
+#endif /* _PDICT_DEFINE_H_ */
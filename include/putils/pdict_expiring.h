@@ -0,0 +1,99 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_EXPIRING_H_
+#define _PDICT_EXPIRING_H_
+/*!
+ * \file pdict_expiring.h
+ * \brief Header for the dictionary with per entry time to live.
+ */
+
+#include "pdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \typedef pdict_expiring
+ * \brief Dictionary whose entries expire after their own time to live.
+ *
+ * __Detail:__
+ *
+ * Deadlines are kept in a hierarchical timing wheel (5 levels of 64 slots,
+ * one tick per clock unit), so inserting, refreshing and removing an entry
+ * are O(1) and pdict_expiring_expire only touches the entries that actually
+ * expired plus the few that move to a finer level. Ticks where nothing is
+ * scheduled are skipped in bulk.
+ *
+ * Lookups compare the deadline with the clock, so an entry that expired but
+ * was not reaped yet is already a miss.
+ */
+typedef struct pdict_expiring pdict_expiring;
+
+/*!
+ * \brief Current time, in whatever unit TTLs are given in.
+ */
+typedef uint64_t (*pdict_expiring_clock)(void *ctx);
+
+/*!
+ * \brief Creates a dictionary timed with a monotonic clock in milliseconds.
+ * \param destroyer: Called on values that expire or get replaced, and on the
+ * remaining ones when the dictionary is destroyed. May be null.
+ */
+pdict_expiring *pdict_expiring_create(pdict_destroyer destroyer);
+
+pdict_expiring *pdict_expiring_create_with_clock(pdict_destroyer destroyer,
+    pdict_expiring_clock clock, void *clock_ctx);
+
+/*!
+ * \brief Stores data under key for ttl clock units, replacing (and
+ * destroying) the current value and deadline of an existing key.
+ */
+void pdict_expiring_put(pdict_expiring *self, char *key, void *data, uint64_t ttl);
+
+void pdict_expiring_put_n(pdict_expiring *self, const void *key, size_t key_len, void *data,
+                          uint64_t ttl);
+
+/*!
+ * \brief Returns the value of key, or null if it is missing or expired.
+ */
+void *pdict_expiring_get_value(pdict_expiring *self, char *key);
+
+void *pdict_expiring_get_n(pdict_expiring *self, const void *key, size_t key_len);
+
+bool pdict_expiring_has_key(pdict_expiring *self, char *key);
+
+/*!
+ * \brief Removes key and hands its value back to the caller without
+ * destroying it. Returns null if the key is missing or expired.
+ */
+void *pdict_expiring_remove(pdict_expiring *self, char *key);
+
+void *pdict_expiring_remove_n(pdict_expiring *self, const void *key, size_t key_len);
+
+/*!
+ * \brief Reaps every entry whose deadline has passed.
+ * \return Amount of reaped entries.
+ */
+size_t pdict_expiring_expire(pdict_expiring *self);
+
+/*!
+ * \brief Stored entries, including expired ones that were not reaped yet.
+ */
+size_t pdict_expiring_size(pdict_expiring *self);
+
+void pdict_expiring_destroy(pdict_expiring *self);
+
+#endif /* _PDICT_EXPIRING_H_ */
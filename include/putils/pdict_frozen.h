@@ -0,0 +1,118 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_FROZEN_H_
+#define _PDICT_FROZEN_H_
+/*!
+ * \file pdict_frozen.h
+ * \brief Header for read only dictionaries built out of a pdict.
+ */
+
+#include "pdict.h"
+#include <stddef.h>
+
+/*!
+ * \typedef pdict_frozen
+ * \brief Immutable snapshot of a pdict.
+ *
+ * __Detail:__
+ *
+ * Keys are placed with a minimal perfect hash (hash and displace): every key
+ * gets its own slot, so a lookup hashes once, reads one displacement, one
+ * entry and does exactly one key comparison.
+ *
+ * Entries, keys and the displacement table live in a single contiguous block.
+ * Nothing is written after pdict_freeze returns, so any number of threads can
+ * look keys up concurrently without locking.
+ */
+typedef struct pdict_frozen pdict_frozen;
+
+/*!
+ * \brief Builds a frozen copy of the dictionary.
+ * \param self: Source dictionary, it is not modified and can be destroyed
+ * afterwards. Values are copied as pointers, the data they point to is shared.
+ * \return The frozen dictionary, or null if no perfect hash could be found or
+ * a key is longer than UINT32_MAX bytes.
+ *
+ * __Detail:__
+ *
+ * Frozen dictionaries always hash with phash_bytes and a seed of their own,
+ * whatever hasher the source dictionary was created with.
+ */
+pdict_frozen *pdict_freeze(pdict *self);
+
+/*!
+ * \brief Writes a frozen image of the dictionary to path.
+ * \param self: Source dictionary, it is not modified.
+ * \param path: Destination file, replaced atomically if it already exists.
+ * \param value_size: Bytes copied from every value into the file. Pointers
+ * mean nothing to another process, so the data has to travel with the keys.
+ * 0 stores the raw pointers, only useful to a process sharing the same heap.
+ * \return Whether the file was written.
+ *
+ * __Detail:__
+ *
+ * The file is the same block a frozen dictionary lives in: a versioned header
+ * with a checksum followed by the sections, all addressed by offsets.
+ */
+bool pdict_save(pdict *self, const char *path, size_t value_size);
+
+/*!
+ * \brief Maps a file written by pdict_save and queries it in place.
+ * \return The frozen dictionary, or null if the file is missing or its header
+ * does not describe a valid image for this build.
+ *
+ * __Detail:__
+ *
+ * The file is mapped read only and shared, so processes opening the same
+ * snapshot share its page cache and nothing is deserialized. Values returned
+ * by lookups point into the mapping and must not be written. Opening only
+ * checks the header; call pdict_frozen_verify to check the whole file.
+ */
+pdict_frozen *pdict_open_mmap(const char *path);
+
+/*!
+ * \brief Checks the image against its checksum, reading all of it.
+ */
+bool pdict_frozen_verify(const pdict_frozen *self);
+
+/*!
+ * \brief Looks up a NUL terminated key.
+ * \return The stored value or null if the key is not there.
+ */
+void *pdict_frozen_get(const pdict_frozen *self, const char *key);
+
+/*!
+ * \brief Same as [@ref pdict_frozen_get] for a key of key_len bytes.
+ */
+void *pdict_frozen_get_n(const pdict_frozen *self, const void *key, size_t key_len);
+
+/*!
+ * \brief Returns whether the key is stored.
+ */
+bool pdict_frozen_has_key(const pdict_frozen *self, const char *key);
+
+/*!
+ * \brief Amount of stored keys.
+ */
+size_t pdict_frozen_size(const pdict_frozen *self);
+
+/*!
+ * \brief Frees (or unmaps) the frozen dictionary. Values that were stored as
+ * pointers are left untouched.
+ */
+void pdict_frozen_destroy(pdict_frozen *self);
+
+#endif /* _PDICT_FROZEN_H_ */
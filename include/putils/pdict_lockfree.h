@@ -0,0 +1,93 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_LOCKFREE_H_
+#define _PDICT_LOCKFREE_H_
+/*!
+ * \file pdict_lockfree.h
+ * \brief Header for the dictionary with lock free lookups.
+ */
+
+#include "pdict.h"
+#include "pepoch.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*!
+ * \typedef pdict_lockfree
+ * \brief Chained dictionary for read mostly workloads.
+ *
+ * __Detail:__
+ *
+ * Lookups take no lock and write no shared memory besides the reader's own
+ * epoch record: they are wait free. Writers serialize on a mutex and publish
+ * new nodes, values and bucket arrays with release stores. Unlinked nodes and
+ * the bucket arrays replaced by a resize are retired through the dictionary's
+ * pepoch domain and freed once no reader can reach them.
+ *
+ * Every reader thread registers once with pdict_lockfree_register and passes
+ * the returned record to the lookups it does.
+ */
+typedef struct pdict_lockfree pdict_lockfree;
+
+pdict_lockfree *pdict_lockfree_create(void);
+
+pdict_lockfree *pdict_lockfree_create_with_capacity(size_t capacity);
+
+/*!
+ * \brief Registers the calling thread as a reader of the dictionary.
+ */
+pepoch_thread *pdict_lockfree_register(pdict_lockfree *self);
+
+void pdict_lockfree_unregister(pdict_lockfree *self, pepoch_thread *reader);
+
+/*!
+ * \brief Lock free lookup.
+ * \param reader: Record of the calling thread.
+ * \return The value, which the dictionary does not keep alive: values that get
+ * replaced or removed while readers may hold them should be retired through
+ * [@ref pdict_lockfree_epoch] rather than freed.
+ */
+void *pdict_lockfree_get_value(pdict_lockfree *self, pepoch_thread *reader, char *key);
+
+void *pdict_lockfree_get_n(pdict_lockfree *self, pepoch_thread *reader, const void *key,
+                           size_t key_len);
+
+/*!
+ * \brief Stores data under key, returning the replaced value (or null).
+ */
+void *pdict_lockfree_put(pdict_lockfree *self, char *key, void *data);
+
+void *pdict_lockfree_put_n(pdict_lockfree *self, const void *key, size_t key_len, void *data);
+
+void *pdict_lockfree_remove(pdict_lockfree *self, char *key);
+
+void *pdict_lockfree_remove_n(pdict_lockfree *self, const void *key, size_t key_len);
+
+size_t pdict_lockfree_size(pdict_lockfree *self);
+
+/*!
+ * \brief Reclamation domain of the dictionary, to retire values with.
+ */
+pepoch *pdict_lockfree_epoch(pdict_lockfree *self);
+
+/*!
+ * \brief Frees the dictionary, no reader may be using it anymore.
+ */
+void pdict_lockfree_destroy(pdict_lockfree *self);
+
+void pdict_lockfree_destroy_all(pdict_lockfree *self, pdict_destroyer destroyer);
+
+#endif /* _PDICT_LOCKFREE_H_ */
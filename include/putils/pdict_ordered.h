@@ -0,0 +1,113 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PDICT_ORDERED_H_
+#define _PDICT_ORDERED_H_
+/*!
+ * \file pdict_ordered.h
+ * \brief Header for the insertion ordered compact dictionary.
+ */
+
+#include "pdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/*!
+ * \typedef pdict_ordered
+ * \brief Dictionary that remembers insertion order.
+ *
+ * __Detail:__
+ *
+ * Entries are appended to a dense array and a separate open addressing index
+ * maps hashes to positions in that array. Index slots are 1, 2, 4 or 8 bytes
+ * wide depending on the capacity, so the per key overhead is a fraction of a
+ * pdict_node. Iterating is a linear scan of the entries in insertion order,
+ * whatever resizes happened in between.
+ *
+ * Replacing the value of an existing key keeps its position, removing a key
+ * and putting it back moves it to the end.
+ *
+ * Keys are copied back to back into a single arena owned by the dictionary,
+ * so storing one costs its bytes plus a NUL and no allocation of its own.
+ * Key pointers handed out by iterations are only valid until the next put.
+ */
+typedef struct pdict_ordered pdict_ordered;
+
+/*!
+ * \brief Cursor over the entries in insertion order, see pdict_iter.
+ */
+typedef struct pdict_ordered_iter pdict_ordered_iter;
+struct pdict_ordered_iter {
+  pdict_ordered *dict;
+  size_t index;
+};
+
+pdict_ordered *pdict_ordered_create(void);
+
+/*!
+ * \brief Creates a dictionary that holds capacity keys without resizing.
+ */
+pdict_ordered *pdict_ordered_create_with_capacity(size_t capacity);
+
+/*!
+ * \brief Stores data under key, replacing the value of an existing key.
+ */
+void pdict_ordered_put(pdict_ordered *self, char *key, void *data);
+
+/*!
+ * \brief Binary key variant of [@ref pdict_ordered_put].
+ */
+void pdict_ordered_put_n(pdict_ordered *self, const void *key, size_t key_len, void *data);
+
+void *pdict_ordered_get_value(pdict_ordered *self, char *key);
+
+void *pdict_ordered_get_n(pdict_ordered *self, const void *key, size_t key_len);
+
+bool pdict_ordered_has_key(pdict_ordered *self, char *key);
+
+/*!
+ * \brief Removes key and returns its value (or null if it was not there).
+ */
+void *pdict_ordered_remove(pdict_ordered *self, char *key);
+
+void *pdict_ordered_remove_n(pdict_ordered *self, const void *key, size_t key_len);
+
+void pdict_ordered_iterate(pdict_ordered *self, pdict_closure closure);
+
+void pdict_ordered_iterate_with_context(pdict_ordered *self, pdict_context_closure closure,
+                                        void *ctx);
+
+void pdict_ordered_iter_init(pdict_ordered_iter *iter, pdict_ordered *self);
+
+/*!
+ * \brief Fills entry with the next element in insertion order.
+ * \return false once all elements were visited.
+ */
+bool pdict_ordered_iter_next(pdict_ordered_iter *iter, pdict_entry *entry);
+
+size_t pdict_ordered_size(pdict_ordered *self);
+
+bool pdict_ordered_is_empty(pdict_ordered *self);
+
+void pdict_ordered_clean(pdict_ordered *self);
+
+void pdict_ordered_destroy(pdict_ordered *self);
+
+/*!
+ * \brief Destroys the dictionary calling destroyer on every value.
+ */
+void pdict_ordered_destroy_all(pdict_ordered *self, pdict_destroyer destroyer);
+
+#endif /* _PDICT_ORDERED_H_ */
@@ -0,0 +1,93 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PEPOCH_H_
+#define _PEPOCH_H_
+/*!
+ * \file pepoch.h
+ * \brief Header for epoch based memory reclamation.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*!
+ * \typedef pepoch
+ * \brief Reclamation domain shared by the readers and writers of a structure.
+ *
+ * __Detail:__
+ *
+ * Lock free readers may still be looking at memory a writer just unlinked, so
+ * writers retire that memory instead of freeing it. Readers wrap every access
+ * in pepoch_enter/pepoch_exit, which only publishes the global epoch the
+ * reader saw, and retired memory is destroyed once every reader that was
+ * active when it got retired has left (the epoch moved twice since).
+ *
+ * Entering and exiting never wait nor loop, so readers stay wait free.
+ */
+typedef struct pepoch pepoch;
+
+/*!
+ * \typedef pepoch_thread
+ * \brief Per thread reader record, see [@ref pepoch_register].
+ */
+typedef struct pepoch_thread pepoch_thread;
+
+typedef void (*pepoch_destroyer)(void *pointer);
+
+pepoch *pepoch_create(void);
+
+/*!
+ * \brief Registers the calling thread as a reader.
+ * \return The record to pass to pepoch_enter/pepoch_exit from this thread.
+ */
+pepoch_thread *pepoch_register(pepoch *self);
+
+/*!
+ * \brief Releases a record, the thread must not be inside a critical section.
+ */
+void pepoch_unregister(pepoch *self, pepoch_thread *thread);
+
+/*!
+ * \brief Starts a read side critical section, they do not nest.
+ */
+void pepoch_enter(pepoch *self, pepoch_thread *thread);
+
+void pepoch_exit(pepoch_thread *thread);
+
+/*!
+ * \brief Schedules pointer to be passed to destroyer once no reader can see it.
+ *
+ * __Detail:__
+ *
+ * Safe to call from several threads. Every few retirements it also tries to
+ * advance the epoch and destroy what became unreachable. Destroyers run with
+ * the domain locked and must not call back into it.
+ */
+void pepoch_retire(pepoch *self, void *pointer, pepoch_destroyer destroyer);
+
+/*!
+ * \brief Tries to advance the epoch and destroy unreachable memory.
+ * \return Amount of retired pointers still waiting.
+ */
+size_t pepoch_reclaim(pepoch *self);
+
+/*!
+ * \brief Destroys everything still retired and frees the domain. No reader
+ * may be active anymore.
+ */
+void pepoch_destroy(pepoch *self);
+
+#endif /* _PEPOCH_H_ */
@@ -0,0 +1,92 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PHAMT_H_
+#define _PHAMT_H_
+/*!
+ * \file phamt.h
+ * \brief Header for the persistent hash array mapped trie dictionary.
+ */
+
+#include "pdict.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \typedef phamt
+ * \brief Handle on one version of a persistent dictionary.
+ *
+ * __Detail:__
+ *
+ * Keys live in a trie indexed 5 hash bits per level, where every branch only
+ * stores the children it has. Nodes are never modified once built: a put or
+ * remove copies the path from the root to the key (a handful of small nodes)
+ * and shares everything else with the previous version.
+ *
+ * That makes phamt_snapshot O(1): it returns a new handle on the same root.
+ * Updating either handle afterwards leaves the other one untouched. Nodes are
+ * reference counted atomically, so a snapshot can be handed to another thread
+ * while the original keeps being updated. A single handle must not be used
+ * from several threads at once.
+ */
+typedef struct phamt phamt;
+
+phamt *phamt_create(void);
+
+/*!
+ * \brief Same as [@ref phamt_create] with a custom hash function.
+ */
+phamt *phamt_create_with_hasher(pdict_hasher hasher, uint64_t seed);
+
+/*!
+ * \brief Returns a new handle sharing the current contents, in O(1).
+ */
+phamt *phamt_snapshot(const phamt *self);
+
+/*!
+ * \brief Stores data under key.
+ * \return The replaced value or null.
+ */
+void *phamt_put(phamt *self, char *key, void *data);
+
+void *phamt_put_n(phamt *self, const void *key, size_t key_len, void *data);
+
+void *phamt_get_value(const phamt *self, char *key);
+
+void *phamt_get_n(const phamt *self, const void *key, size_t key_len);
+
+bool phamt_has_key(const phamt *self, char *key);
+
+/*!
+ * \brief Removes key from this version.
+ * \return Its value, or null if it was not there.
+ */
+void *phamt_remove(phamt *self, char *key);
+
+void *phamt_remove_n(phamt *self, const void *key, size_t key_len);
+
+void phamt_iterate_with_context(const phamt *self, pdict_context_closure closure, void *ctx);
+
+size_t phamt_size(const phamt *self);
+
+bool phamt_is_empty(const phamt *self);
+
+/*!
+ * \brief Drops this version, nodes shared with other versions stay alive.
+ */
+void phamt_destroy(phamt *self);
+
+#endif /* _PHAMT_H_ */
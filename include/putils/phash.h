@@ -0,0 +1,72 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PHASH_H_
+#define _PHASH_H_
+/*!
+ * \file phash.h
+ * \brief Header for the hashing functions used by the containers.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief Seeded 64-bit hash of an arbitrary byte buffer.
+ * \param key: Pointer to the bytes to hash, it does not need to be aligned.
+ * \param len: Amount of bytes to hash.
+ * \param seed: Any 64-bit value, different seeds give unrelated hashes.
+ * \return The hash value.
+ *
+ * __Detail:__
+ *
+ * A wyhash style function: it consumes the input 8 or 16 bytes at a time and
+ * mixes with 64x64->128 bit multiplications, so it is fast on short keys and
+ * spreads well under both modulo and power of two reductions.
+ *
+ * Values depend on the host byte order and are only meant to be stable for a
+ * given seed on a given platform.
+ */
+uint64_t phash_bytes(const void *key, size_t len, uint64_t seed);
+
+/*!
+ * \brief Same as [@ref phash_bytes] for a NUL terminated string.
+ */
+uint64_t phash_string(const char *key, uint64_t seed);
+
+/*!
+ * \brief Classic byte at a time djb2 (hash * 33 + c), seed is used as the
+ * starting value when non zero.
+ *
+ * __Detail:__
+ *
+ * This is what pdict used before the seeded hash was introduced. It is kept
+ * around for comparisons and for callers that depend on its values, but it is
+ * slow on long keys and trivial to flood.
+ */
+uint64_t phash_djb2(const void *key, size_t len, uint64_t seed);
+
+/*!
+ * \brief Returns a fresh random seed.
+ *
+ * __Detail:__
+ *
+ * The first call reads the process wide secret from the operating system
+ * (falling back to time and address entropy), following calls derive new
+ * seeds from it, so getting a seed is cheap and safe to do per table.
+ */
+uint64_t phash_random_seed(void);
+
+#endif /* _PHASH_H_ */
@@ -27,6 +27,7 @@
  *
  */
 #include "pnode.h"
+#include "ppool.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -137,6 +138,45 @@ typedef void (*plist_closure)(void *data);
  */
 typedef struct plist plist;
 
+/*!
+ * \typedef plist_cursor
+ * \brief Position inside a list, meant to live on the stack.
+ *
+ * __Detail:__
+ *
+ * A cursor sits in a gap between two elements, starting before the first one.
+ * plist_cursor_next steps over the next element, which becomes the current
+ * one, and every cursor operation takes constant time on both layouts. This
+ * makes it the way to walk a list while removing or inserting elements.
+ *
+ * ~~~~~~~~~~~~~~~{.c}
+ * plist_cursor cursor;
+ * void *data;
+ *
+ * plist_cursor_init(&cursor, L);
+ * while (plist_cursor_next(&cursor, &data)) {
+ *   if (is_stale(data)) {
+ *     free(plist_cursor_remove_current(&cursor));
+ *   }
+ * }
+ * ~~~~~~~~~~~~~~~
+ *
+ * Changing the list by any other means than the cursor itself invalidates
+ * it. Fields are private.
+ */
+typedef struct plist_cursor plist_cursor;
+struct plist_cursor {
+  plist *list;
+  bool has_current;
+  /* linked layout */
+  plist_node *previous;
+  plist_node *current;
+  /* unrolled layout, the current element is chunk->data[slot - 1] */
+  plist_chunk *previous_chunk;
+  plist_chunk *chunk;
+  size_t slot;
+};
+
 /*!
  * \brief Initialize the list pointer.
  * \return A pointer to the newly created list.
@@ -163,6 +203,42 @@ typedef struct plist plist;
  */
 plist *plist_create(void);
 
+/*!
+ * \brief Initialize a list using the unrolled layout.
+ * \return A pointer to the newly created list.
+ *
+ * __Detail:__
+ *
+ * Same as [plist_create](@ref plist_create), but elements are stored
+ * PLIST_CHUNK_SLOTS at a time in 128 byte chunks instead of one node each.
+ * Appending only allocates once every PLIST_CHUNK_SLOTS elements and
+ * traversals (plist_iterate, plist_filter, plist_map...) read elements
+ * sequentially. Inserting or removing in the middle of a chunk moves up to
+ * PLIST_CHUNK_SLOTS - 1 pointers.
+ *
+ * Every plist_* function works on both layouts. Lists derived from an
+ * unrolled one (plist_filter, plist_map, plist_get_elements...) are unrolled
+ * too.
+ */
+plist *plist_create_unrolled(void);
+
+/*!
+ * \brief Initialize a linked list whose nodes come from its own pool.
+ * \return A pointer to the newly created list.
+ *
+ * __Detail:__
+ *
+ * Same as [plist_create](@ref plist_create), but removed nodes go back to a
+ * [ppool](@ref ppool) owned by the list and later insertions reuse them, so
+ * once the list reached its working size adding and removing never call
+ * malloc or free. This suits queues and stacks with a high turnover. The
+ * memory is only released when the list is destroyed.
+ *
+ * Lists derived from a pooled one (plist_filter, plist_map...) get a pool of
+ * their own. See [plist_pool_stats](@ref plist_pool_stats) for the counters.
+ */
+plist *plist_create_pooled(void);
+
 /*!
  * \brief Frees and destroys the given list.
  * \param self: A pointer to the list to be freed.
@@ -496,9 +572,32 @@ bool plist_is_empty(plist *self);
  * \brief plist_sort
  * \param self
  * \param comparator
+ *
+ * __Detail:__
+ *
+ * The sort is stable: elements the comparator finds equal keep their order.
  */
 void plist_sort(plist *self, plist_comparator comparator);
 
+/*!
+ * \brief Sorts self using up to nthreads threads, the calling one included.
+ * \param self: List to sort.
+ * \param comparator: Strict less than, called from several threads at once.
+ * \param nthreads: Threads to use.
+ *
+ * __Detail:__
+ *
+ * Gathers the elements into an array, sorts one slice of it per thread, then
+ * merges the slices pairwise with every thread writing its share of each
+ * merged run. Linked lists are relinked in place, no node is reallocated.
+ * The result is the same as [plist_sort](@ref plist_sort) gives.
+ *
+ * Every thread gets at least a few thousand elements, so small lists are
+ * simply sorted with plist_sort. Needs two pointers of extra memory per
+ * element, and falls back to plist_sort if they cannot be allocated.
+ */
+void plist_sort_parallel(plist *self, plist_comparator comparator, size_t nthreads);
+
 /*!
  * \brief plist_count_matching
  * \param self
@@ -531,6 +630,55 @@ bool plist_all_match(plist *self, plist_evaluator condition);
  */
 size_t plist_prepend(plist *self, void *data);
 
+/*!
+ * \brief Copies the node pool counters of a pooled list into stats.
+ * \return false, leaving stats untouched, if the list is not pooled.
+ */
+bool plist_pool_stats(plist *self, ppool_stats *stats);
+
+/*!
+ * \brief Number of chunks holding the elements of an unrolled list.
+ * \return 0 for linked lists.
+ */
+size_t plist_chunk_count(plist *self);
+
+/*!
+ * \brief Places cursor before the first element of self.
+ */
+void plist_cursor_init(plist_cursor *cursor, plist *self);
+
+/*!
+ * \brief Steps over the next element and makes it the current one.
+ * \param data: Receives the element.
+ * \return false, with no current element, at the end of the list.
+ */
+bool plist_cursor_next(plist_cursor *cursor, void **data);
+
+/*!
+ * \brief Returns the element plist_cursor_next would step over, without
+ * moving, or null at the end of the list.
+ */
+void *plist_cursor_peek(plist_cursor *cursor);
+
+/*!
+ * \brief Removes the current element and returns it.
+ * \return The removed element, or null if there is no current element.
+ *
+ * __Detail:__
+ *
+ * The cursor is left in the gap the element occupied: there is no current
+ * element until the next plist_cursor_next, which steps over the element that
+ * followed the removed one.
+ */
+void *plist_cursor_remove_current(plist_cursor *cursor);
+
+/*!
+ * \brief Inserts data in the gap the cursor sits in, right after the current
+ * element (or where the last removed one was, or at the head for a cursor
+ * that did not move yet). The next plist_cursor_next steps over it.
+ */
+void plist_cursor_insert_after(plist_cursor *cursor, void *data);
+
 /*
  * Handy macros
  */
@@ -25,6 +25,20 @@ struct plist_node {
   struct plist_node *next;
 };
 
+/*
+ * Storage unit of unrolled lists: several elements per allocation, so walking
+ * the list takes a cache miss every PLIST_CHUNK_SLOTS elements instead of one
+ * per element. 14 slots make a chunk exactly 128 bytes on 64-bit targets.
+ */
+#define PLIST_CHUNK_SLOTS 14
+
+typedef struct plist_chunk plist_chunk;
+struct plist_chunk {
+  struct plist_chunk *next;
+  size_t count;
+  void *data[PLIST_CHUNK_SLOTS];
+};
+
 typedef struct plist_double_node plist_double_node;
 struct plist_double_node {
   void *data;
@@ -32,13 +46,21 @@ struct plist_double_node {
   struct plist_double_node *next;
 };
 
+/*
+ * Keys shorter than PDICT_INLINE_KEY_LEN (terminator included) are stored in
+ * inline_key, right next to the rest of the node, and key points there.
+ * Longer keys are copied to their own heap block.
+ */
+#define PDICT_INLINE_KEY_LEN 24
+
 typedef struct pdict_node pdict_node;
 struct pdict_node {
   char *key;
   size_t key_len;
-  unsigned int hashcode;
+  size_t hashcode;
   void *data;
   struct pdict_node *next;
+  char inline_key[PDICT_INLINE_KEY_LEN];
 };
 
 #endif /* _PNODE_H_ */
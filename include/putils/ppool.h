@@ -0,0 +1,90 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#ifndef _PPOOL_H_
+#define _PPOOL_H_
+/*!
+ * \file ppool.h
+ * \brief Header for the fixed size object pool used by the lists.
+ */
+
+#include <stddef.h>
+
+/*!
+ * \typedef ppool
+ * \brief Allocator for objects of a single size.
+ *
+ * __Detail:__
+ *
+ * Objects are carved out of slabs holding many of them, and freed objects go
+ * to a free list the next allocations pop from. Once a pool warmed up,
+ * allocating and freeing are a couple of pointer moves with no call into
+ * malloc. Slabs are only returned to the system when the pool is destroyed,
+ * so a pool holds on to the most memory it ever needed.
+ *
+ * Pools are not thread safe, they are meant to be owned by a single structure
+ * (see [@ref plist_create_pooled]) or a single thread.
+ */
+typedef struct ppool ppool;
+
+typedef struct ppool_stats ppool_stats;
+struct ppool_stats {
+  size_t slabs;       /* slabs allocated so far */
+  size_t allocations; /* ppool_alloc calls served */
+  size_t reuses;      /* allocations served from the free list */
+  size_t in_use;      /* objects allocated and not freed yet */
+};
+
+/*!
+ * \brief Creates a pool.
+ * \param object_size: Size of every object, rounded up to a pointer size.
+ * \param objects_per_slab: Objects carved out of each slab, 0 for a default.
+ * \return The new pool.
+ *
+ * __Detail:__
+ *
+ * Objects are aligned to a pointer, which is enough for structures made of
+ * pointers and sizes, like list nodes.
+ */
+ppool *ppool_create(size_t object_size, size_t objects_per_slab);
+
+/*!
+ * \brief Returns an uninitialized object, or null if a new slab was needed
+ * and could not be allocated.
+ */
+void *ppool_alloc(ppool *self);
+
+/*!
+ * \brief Gives back an object allocated from this same pool, null is ignored.
+ */
+void ppool_free(ppool *self, void *object);
+
+/*!
+ * \brief Copies the pool counters into stats.
+ */
+void ppool_get_stats(ppool *self, ppool_stats *stats);
+
+/*!
+ * \brief Fraction of allocations served from the free list, 0 before the
+ * first allocation.
+ */
+double ppool_reuse_rate(ppool *self);
+
+/*!
+ * \brief Frees every slab, objects still in use included.
+ */
+void ppool_destroy(ppool *self);
+
+#endif /* _PPOOL_H_ */
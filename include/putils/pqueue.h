@@ -45,6 +45,18 @@ typedef void (*pqueue_destroyer)(void *);
  */
 pqueue *pqueue_create(void);
 
+/*!
+ * \brief pqueue_create_pooled
+ * \return
+ *
+ * __Detail:__
+ *
+ * Like [pqueue_create](@ref pqueue_create) but backed by a pooled list (see
+ * [plist_create_pooled](@ref plist_create_pooled)), nodes of dequeued elements
+ * are recycled instead of freed.
+ */
+pqueue *pqueue_create_pooled(void);
+
 /*!
  * \brief pqueue_enqueue
  * \param self
@@ -53,6 +53,18 @@ typedef void (*pstack_destroyer)(void *);
  */
 pstack *pstack_create(void);
 
+/*!
+ * \brief pstack_create_pooled
+ * \return
+ *
+ * __Detail:__
+ *
+ * Like [pstack_create](@ref pstack_create) but backed by a pooled list (see
+ * [plist_create_pooled](@ref plist_create_pooled)), nodes of popped elements
+ * are recycled instead of freed.
+ */
+pstack *pstack_create_pooled(void);
+
 /*!
  * \brief pstack_push
  * \param self
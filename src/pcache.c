@@ -0,0 +1,469 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pcache.h"
+#include "putils/pnode.h"
+#include <string.h>
+
+#define PCACHE_QUEUE_MAIN 0
+#define PCACHE_QUEUE_SMALL 1
+/* S3-FIFO caps the frequency counter at 3, so an entry survives at most 3 sweeps */
+#define PCACHE_MAX_FREQ 3
+
+/*
+ * The node comes first so queue links convert back to their entries. Queues
+ * are circular with a sentinel: the front (sentinel next) holds the newest
+ * entries and the back (sentinel previous) the oldest ones.
+ */
+typedef struct pcache_entry pcache_entry;
+struct pcache_entry {
+  plist_double_node node;
+  size_t charge;
+  uint8_t queue;
+  /* reference bit for CLOCK, access frequency for S3-FIFO */
+  uint8_t freq;
+  char key[];
+};
+
+typedef struct pcache_ghost pcache_ghost;
+struct pcache_ghost {
+  plist_double_node node;
+  char key[];
+};
+
+struct pcache {
+  pcache_options options;
+  pdict *entries;
+  size_t count;
+  size_t charge;
+  /* LRU list, CLOCK ring or S3-FIFO main queue */
+  plist_double_node main;
+  plist_double_node *hand;
+  /* S3-FIFO only */
+  plist_double_node small;
+  size_t small_weight;
+  plist_double_node ghost;
+  pdict *ghost_keys;
+  size_t ghost_count;
+  pcache_stats stats;
+};
+
+static void pcache_link_after(plist_double_node *position, plist_double_node *node);
+
+static void pcache_unlink(plist_double_node *node);
+
+static size_t pcache_weight(pcache *self, size_t charge);
+
+static bool pcache_over_budget(pcache *self);
+
+static void pcache_reject(pcache *self, char *key, void *value);
+
+static void pcache_use(pcache *self, pcache_entry *entry);
+
+static void pcache_insert(pcache *self, pcache_entry *entry);
+
+static void pcache_detach(pcache *self, pcache_entry *entry);
+
+static pcache_entry *pcache_victim(pcache *self);
+
+static pcache_entry *pcache_s3fifo_victim(pcache *self);
+
+static void pcache_ghost_add(pcache *self, const char *key);
+
+static void pcache_free_ghosts(pcache *self);
+
+pcache *pcache_create(size_t max_entries) {
+  return pcache_create_with_options(&(pcache_options) {
+    .policy = PCACHE_LRU,
+    .max_entries = max_entries,
+  });
+}
+
+pcache *pcache_create_with_options(const pcache_options *options) {
+  pcache *self = calloc(1, sizeof(pcache));
+
+  self->options = *options;
+  self->entries = pdict_create_with_capacity(options->max_entries);
+  self->main.previous = self->main.next = &self->main;
+  self->small.previous = self->small.next = &self->small;
+  self->ghost.previous = self->ghost.next = &self->ghost;
+  self->hand = &self->main;
+
+  if (options->policy == PCACHE_S3FIFO) {
+    self->ghost_keys = pdict_create();
+  }
+
+  return self;
+}
+
+void pcache_put(pcache *self, char *key, void *value) {
+  pcache_put_charged(self, key, value, 1);
+}
+
+void pcache_put_charged(pcache *self, char *key, void *value, size_t charge) {
+  if (self->options.max_charge && charge > self->options.max_charge) {
+    pcache_reject(self, key, value);
+    return;
+  }
+
+  bool inserted;
+  void **slot = pdict_get_or_insert(self->entries, key, &inserted);
+  pcache_entry *entry = *slot;
+
+  if (!inserted) {
+    void *old = entry->node.data;
+
+    if (entry->queue == PCACHE_QUEUE_SMALL) {
+      self->small_weight += pcache_weight(self, charge) - pcache_weight(self, entry->charge);
+    }
+    self->charge += charge - entry->charge;
+    entry->charge = charge;
+    entry->node.data = value;
+    pcache_use(self, entry);
+
+    if (self->options.on_evict && old != value) {
+      self->options.on_evict(entry->key, old, self->options.ctx);
+    }
+  } else {
+    size_t key_len = strlen(key);
+
+    entry = malloc(sizeof(pcache_entry) + key_len + 1);
+    memcpy(entry->key, key, key_len + 1);
+    entry->node.data = value;
+    entry->charge = charge;
+    entry->freq = 0;
+    *slot = entry;
+    pcache_insert(self, entry);
+    ++self->count;
+    self->charge += charge;
+    ++self->stats.insertions;
+  }
+
+  while (pcache_over_budget(self)) {
+    pcache_evict(self);
+  }
+}
+
+void *pcache_get_value(pcache *self, char *key) {
+  pcache_entry *entry = pdict_get_value(self->entries, key);
+
+  if (!entry) {
+    ++self->stats.misses;
+    return 0;
+  }
+
+  ++self->stats.hits;
+  pcache_use(self, entry);
+  return entry->node.data;
+}
+
+void *pcache_peek(pcache *self, char *key) {
+  pcache_entry *entry = pdict_get_value(self->entries, key);
+  return entry ? entry->node.data : 0;
+}
+
+bool pcache_touch(pcache *self, char *key) {
+  pcache_entry *entry = pdict_get_value(self->entries, key);
+
+  if (entry) {
+    pcache_use(self, entry);
+  }
+  return entry != 0;
+}
+
+bool pcache_has_key(pcache *self, char *key) {
+  return pdict_has_key(self->entries, key);
+}
+
+void *pcache_remove(pcache *self, char *key) {
+  pcache_entry *entry = pdict_remove(self->entries, key);
+
+  if (!entry) {
+    return 0;
+  }
+
+  void *value = entry->node.data;
+  pcache_detach(self, entry);
+  free(entry);
+  return value;
+}
+
+bool pcache_evict(pcache *self) {
+  if (!self->count) {
+    return false;
+  }
+
+  pcache_entry *entry = pcache_victim(self);
+  void *value = entry->node.data;
+
+  pdict_remove(self->entries, entry->key);
+  pcache_detach(self, entry);
+  ++self->stats.evictions;
+
+  if (self->options.on_evict) {
+    self->options.on_evict(entry->key, value, self->options.ctx);
+  }
+  free(entry);
+  return true;
+}
+
+size_t pcache_size(pcache *self) {
+  return self->count;
+}
+
+size_t pcache_charge(pcache *self) {
+  return self->charge;
+}
+
+void pcache_get_stats(pcache *self, pcache_stats *stats) {
+  *stats = self->stats;
+}
+
+double pcache_hit_ratio(pcache *self) {
+  uint64_t lookups = self->stats.hits + self->stats.misses;
+  return lookups ? (double) self->stats.hits / (double) lookups : 0.0;
+}
+
+void pcache_reset_stats(pcache *self) {
+  memset(&self->stats, 0, sizeof(self->stats));
+}
+
+void pcache_destroy(pcache *self) {
+  pcache_destroy_all(self, 0);
+}
+
+void pcache_destroy_all(pcache *self, pdict_destroyer destroyer) {
+  plist_double_node *queues[] = {&self->main, &self->small};
+
+  for (size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); ++i) {
+    plist_double_node *node = queues[i]->next;
+
+    while (node != queues[i]) {
+      plist_double_node *next = node->next;
+
+      if (destroyer) {
+        destroyer(node->data);
+      }
+      free(node);
+      node = next;
+    }
+  }
+
+  pcache_free_ghosts(self);
+  pdict_destroy(self->entries);
+  free(self);
+}
+
+static void pcache_link_after(plist_double_node *position, plist_double_node *node) {
+  node->previous = position;
+  node->next = position->next;
+  position->next->previous = node;
+  position->next = node;
+}
+
+static void pcache_unlink(plist_double_node *node) {
+  node->previous->next = node->next;
+  node->next->previous = node->previous;
+}
+
+/* What an entry counts towards the S3-FIFO small queue share of the budget */
+static size_t pcache_weight(pcache *self, size_t charge) {
+  return self->options.max_charge ? charge : 1;
+}
+
+static bool pcache_over_budget(pcache *self) {
+  return (self->options.max_entries && self->count > self->options.max_entries) ||
+         (self->options.max_charge && self->charge > self->options.max_charge);
+}
+
+/*
+ * An entry that can never fit would flush every other entry before leaving
+ * itself, so it goes straight to on_evict along with the value it replaces.
+ */
+static void pcache_reject(pcache *self, char *key, void *value) {
+  pcache_entry *entry = pdict_remove(self->entries, key);
+
+  if (entry) {
+    void *old = entry->node.data;
+
+    pcache_detach(self, entry);
+    if (old != value) {
+      ++self->stats.evictions;
+      if (self->options.on_evict) {
+        self->options.on_evict(entry->key, old, self->options.ctx);
+      }
+    }
+    free(entry);
+  }
+
+  ++self->stats.evictions;
+  if (self->options.on_evict) {
+    self->options.on_evict(key, value, self->options.ctx);
+  }
+}
+
+static void pcache_use(pcache *self, pcache_entry *entry) {
+  switch (self->options.policy) {
+    case PCACHE_LRU:
+      if (self->main.next != &entry->node) {
+        pcache_unlink(&entry->node);
+        pcache_link_after(&self->main, &entry->node);
+      }
+      break;
+    case PCACHE_CLOCK:
+      entry->freq = 1;
+      break;
+    case PCACHE_S3FIFO:
+      if (entry->freq < PCACHE_MAX_FREQ) {
+        ++entry->freq;
+      }
+      break;
+  }
+}
+
+static void pcache_insert(pcache *self, pcache_entry *entry) {
+  entry->queue = PCACHE_QUEUE_MAIN;
+
+  switch (self->options.policy) {
+    case PCACHE_LRU:
+      pcache_link_after(&self->main, &entry->node);
+      break;
+    case PCACHE_CLOCK:
+      /* right behind the hand, so it is the last one the next sweep looks at */
+      pcache_link_after(self->hand, &entry->node);
+      break;
+    case PCACHE_S3FIFO: {
+      pcache_ghost *ghost = pdict_remove(self->ghost_keys, entry->key);
+
+      if (ghost) {
+        /* evicted from the small queue not long ago, it deserves the main one */
+        pcache_unlink(&ghost->node);
+        --self->ghost_count;
+        free(ghost);
+        pcache_link_after(&self->main, &entry->node);
+      } else {
+        entry->queue = PCACHE_QUEUE_SMALL;
+        self->small_weight += pcache_weight(self, entry->charge);
+        pcache_link_after(&self->small, &entry->node);
+      }
+      break;
+    }
+  }
+}
+
+static void pcache_detach(pcache *self, pcache_entry *entry) {
+  if (self->hand == &entry->node) {
+    self->hand = entry->node.previous;
+  }
+  if (entry->queue == PCACHE_QUEUE_SMALL) {
+    self->small_weight -= pcache_weight(self, entry->charge);
+  }
+
+  pcache_unlink(&entry->node);
+  --self->count;
+  self->charge -= entry->charge;
+}
+
+static pcache_entry *pcache_victim(pcache *self) {
+  switch (self->options.policy) {
+    case PCACHE_CLOCK:
+      /* the hand sweeps from the oldest entries to the newest, clearing bits */
+      for (;;) {
+        if (self->hand == &self->main) {
+          self->hand = self->main.previous;
+        }
+
+        pcache_entry *entry = (pcache_entry *) self->hand;
+
+        if (!entry->freq) {
+          return entry;
+        }
+        entry->freq = 0;
+        self->hand = self->hand->previous;
+      }
+    case PCACHE_S3FIFO:
+      return pcache_s3fifo_victim(self);
+    case PCACHE_LRU:
+    default:
+      return (pcache_entry *) self->main.previous;
+  }
+}
+
+static pcache_entry *pcache_s3fifo_victim(pcache *self) {
+  size_t budget = self->options.max_charge ? self->options.max_charge : self->options.max_entries;
+
+  for (;;) {
+    if (self->small.next != &self->small &&
+        (self->small_weight >= budget / 10 || self->main.next == &self->main)) {
+      pcache_entry *entry = (pcache_entry *) self->small.previous;
+
+      if (!entry->freq) {
+        pcache_ghost_add(self, entry->key);
+        return entry;
+      }
+
+      pcache_unlink(&entry->node);
+      self->small_weight -= pcache_weight(self, entry->charge);
+      entry->queue = PCACHE_QUEUE_MAIN;
+      entry->freq = 0;
+      pcache_link_after(&self->main, &entry->node);
+    } else {
+      pcache_entry *entry = (pcache_entry *) self->main.previous;
+
+      if (!entry->freq) {
+        return entry;
+      }
+
+      --entry->freq;
+      pcache_unlink(&entry->node);
+      pcache_link_after(&self->main, &entry->node);
+    }
+  }
+}
+
+/* The ghost queue remembers as many keys as the cache holds entries */
+static void pcache_ghost_add(pcache *self, const char *key) {
+  size_t limit = self->options.max_entries ? self->options.max_entries : self->count;
+  size_t key_len = strlen(key);
+  pcache_ghost *ghost = malloc(sizeof(pcache_ghost) + key_len + 1);
+
+  memcpy(ghost->key, key, key_len + 1);
+  pcache_link_after(&self->ghost, &ghost->node);
+  pdict_put(self->ghost_keys, ghost->key, ghost);
+  ++self->ghost_count;
+
+  while (self->ghost_count > limit) {
+    pcache_ghost *oldest = (pcache_ghost *) self->ghost.previous;
+
+    pcache_unlink(&oldest->node);
+    pdict_remove(self->ghost_keys, oldest->key);
+    --self->ghost_count;
+    free(oldest);
+  }
+}
+
+static void pcache_free_ghosts(pcache *self) {
+  plist_double_node *node = self->ghost.next;
+
+  while (node != &self->ghost) {
+    plist_double_node *next = node->next;
+    free(node);
+    node = next;
+  }
+
+  if (self->ghost_keys) {
+    pdict_destroy(self->ghost_keys);
+  }
+}
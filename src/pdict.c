@@ -14,91 +14,528 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ***************************************************************************/
 
+#ifdef PDICT_ENABLE_STATS
+/* clock_gettime */
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "putils/pdict.h"
+#include "putils/phash.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PDICT_USE_SSE2 1
+#endif
+
+/*
+ * Open addressing layout (Swiss table style): every slot has a control byte
+ * which is either PDICT_CTRL_EMPTY, PDICT_CTRL_DELETED or, for a full slot,
+ * the 7 lowest bits of the mixed hash. Slots are probed a group at a time so a
+ * single 16 byte load tells us which slots may hold the key, and only those
+ * get their key compared.
+ */
+#define PDICT_GROUP_WIDTH 16
+#define PDICT_CTRL_EMPTY ((int8_t) -128)
+#define PDICT_CTRL_DELETED ((int8_t) -2)
+
+/*
+ * Default max load factors (elements per bucket or slot). Open addressing
+ * needs free slots to terminate probes, so its load factor is capped.
+ */
+#define PDICT_CHAINED_MAX_LOAD 1.0
+#define PDICT_OPEN_MAX_LOAD 0.875
+#define PDICT_OPEN_MAX_LOAD_LIMIT 0.9375
+
+/*
+ * Old buckets migrated by every operation while an incremental rehash is in
+ * progress. Empty buckets are cheap to skip, so they only count as a fraction.
+ */
+#define PDICT_REHASH_STEP 4
+#define PDICT_REHASH_EMPTY_VISITS 10
+
+/* Keys pdict_get_many hashes and prefetches before comparing any of them */
+#define PDICT_BATCH_SIZE 16
+
+/* Bucket ranges per pdict_bulk_load thread, more than one evens out the work */
+#define PDICT_BULK_PARTITIONS_PER_THREAD 8
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PDICT_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PDICT_PREFETCH(address) ((void) (address))
+#endif
+
+/*
+ * Hit, miss and resize counters, reported by pdict_stats. Unless the library
+ * is built with PDICT_ENABLE_STATS these expand to nothing and pdict carries
+ * no counters at all. Lookups may run concurrently under a shared lock (see
+ * pdict_concurrent), so hits and misses are relaxed atomics. Resizes only
+ * happen under an exclusive one.
+ */
+#ifdef PDICT_ENABLE_STATS
+typedef struct pdict_counters pdict_counters;
+struct pdict_counters {
+  _Atomic uint64_t hits;
+  _Atomic uint64_t misses;
+  uint64_t resizes;
+  uint64_t resize_ns;
+};
+
+#define PDICT_STAT_LOOKUP(self, found) \
+  atomic_fetch_add_explicit((found) ? &(self)->counters.hits : &(self)->counters.misses, 1, \
+                            memory_order_relaxed)
+#define PDICT_STAT_RESIZE(self) (++(self)->counters.resizes)
+#define PDICT_STAT_TIMER_START(timer) uint64_t timer = pdict_stats_clock()
+#define PDICT_STAT_TIMER_STOP(self, timer) \
+  ((self)->counters.resize_ns += pdict_stats_clock() - (timer))
+#else
+#define PDICT_STAT_LOOKUP(self, found)
+#define PDICT_STAT_RESIZE(self)
+#define PDICT_STAT_TIMER_START(timer)
+#define PDICT_STAT_TIMER_STOP(self, timer)
+#endif
 
 struct pdict {
+  pdict_mode mode;
+  pdict_hasher hasher;
+  uint64_t seed;
   pdict_node **elements;
+  pdict_node **old_elements;
+  size_t old_max_size;
+  size_t rehash_index;
+  bool incremental_rehash;
+  int8_t *control;
+  pdict_node *slots;
   size_t table_max_size;
   size_t table_current_size;
   size_t elements_count;
+  double max_load_factor;
+  size_t grow_threshold;
+  /* nodes and long keys allocated by pdict_bulk_load, released as a whole */
+  pdict_node *node_slab;
+  size_t node_slab_count;
+  char *key_slab;
+  size_t key_slab_size;
+#ifdef PDICT_ENABLE_STATS
+  pdict_counters counters;
+#endif
+};
+
+/* State shared by the pdict_bulk_load passes */
+typedef struct pdict_bulk pdict_bulk;
+struct pdict_bulk {
+  pdict *dict;
+  const void *const *keys;
+  const size_t *lens;
+  void *const *values;
+  size_t n;
+  size_t nthreads;
+  size_t partitions;
+  size_t *hashes;
+  /* strlen of every key when no lens were given */
+  size_t *key_lens;
+  /*
+   * [thread][partition] keys and long key bytes, turned into the offsets
+   * each thread starts writing at by the prefix sums.
+   */
+  size_t *counts;
+  size_t *key_bytes;
+  /* input indexes, grouped by partition */
+  size_t *order;
+  size_t *partition_elements;
+  size_t *partition_used;
 };
 
-static size_t pdict_hash(unsigned char const *str);
+typedef struct pdict_bulk_worker pdict_bulk_worker;
+struct pdict_bulk_worker {
+  pdict_bulk *bulk;
+  size_t id;
+};
+
+static size_t pdict_hash(const pdict *self, const void *key, size_t key_len);
 
 static void pdict_resize(pdict *self, size_t new_max_size);
 
-static pdict_node *pdict_create_element(char *key, size_t key_hash, size_t key_len, void *data);
+static void pdict_migrate_bucket(pdict *self, size_t old_index);
+
+static size_t pdict_chained_tables(const pdict *self, pdict_node **tables[2], size_t sizes[2]);
+
+static void pdict_get_batch(pdict *self, const void *const *keys, const size_t *lens,
+                            size_t n, void **out_values);
+
+static pdict_node **pdict_chained_find(pdict *self, const void *key, size_t key_len,
+                                       size_t key_hash, pdict_node ***bucket);
+
+static pdict_node **pdict_chain_search(pdict_node **link, const void *key,
+                                       size_t key_len, size_t key_hash);
+
+static pdict_node *pdict_create_element(const void *key, size_t key_hash, size_t key_len, void *data);
+
+static pdict_node *pdict_get_element(pdict *self, const void *key, size_t key_len,
+                                     size_t key_hash);
 
-static pdict_node *pdict_get_element(pdict *self, char *key);
+static pdict_node *pdict_find_or_insert(pdict *self, const void *key, size_t key_len,
+                                        size_t key_hash, bool *inserted);
 
-static void *pdict_remove_element(pdict *self, char *key);
+static bool pdict_remove_element(pdict *self, const void *key, size_t key_len, size_t key_hash,
+                                 void **data);
 
-static void pdict_destroy_element(pdict_node *element, pdict_destroyer destroyer);
+static void pdict_node_set_key(pdict_node *element, const void *key, size_t key_len);
+
+static void pdict_node_release_key(const pdict *self, pdict_node *element);
+
+static void pdict_free_node(const pdict *self, pdict_node *element);
+
+static void pdict_release_slabs(pdict *self);
+
+static void pdict_destroy_element(pdict *self, pdict_node *element, pdict_destroyer destroyer);
 
 static void
 internal_dictionary_clean_and_destroy_elements(pdict *self, pdict_destroyer destroyer);
 
-#if defined __USE_XOPEN2K8 || __GLIBC_USE (LIB_EXT2) || __GLIBC_USE (ISOC2X)
-#define pdict_strndup strndup
-#else
-#define pdict_strndup(s, n) \
-  {                                                                            \
-    const char *__old = (s);						       \
-    size_t __len = strnlen(__old, (n));				               \
-    char *__new = (char *)__builtin_alloca(__len + 1);		               \
-    __new[__len] = '\0';						       \
-    (char *)memcpy(__new, __old, __len);\
-  }
+static bool pdict_key_equals(const pdict_node *element, const void *key, size_t key_len);
+
+static size_t pdict_table_size_for(const pdict *self, size_t capacity);
+
+static void pdict_rebuild(pdict *self, size_t new_max_size);
+
+static void pdict_set_threshold(pdict *self);
+
+static pdict_node *pdict_open_find(pdict *self, const void *key, size_t key_len, size_t key_hash);
+
+static size_t pdict_open_find_free_slot(const pdict *self, size_t key_hash);
+
+static pdict_node *pdict_open_find_or_insert(pdict *self, const void *key, size_t key_len,
+                                             size_t key_hash, bool *inserted);
+
+static bool pdict_open_remove(pdict *self, const void *key, size_t key_len, size_t key_hash,
+                              void **data);
+
+static void pdict_open_resize(pdict *self, size_t new_max_size);
+
+static size_t pdict_open_probe_length(const pdict *self, size_t index);
+
+static void pdict_bulk_run(pdict_bulk *bulk, void *(*phase)(void *));
+
+static void *pdict_bulk_hash(void *arg);
+
+static void *pdict_bulk_scatter(void *arg);
+
+static void *pdict_bulk_build(void *arg);
+
+static void pdict_bulk_insert_open(pdict_bulk *bulk);
+
+static char *pdict_bulk_key(pdict_bulk *bulk, pdict_node *element, size_t index, char *key_slab);
+
+static void pdict_stats_length(pdict_statistics *stats, size_t length);
+
+static void pdict_stats_node(pdict_statistics *stats, const pdict_node *element);
+
+#ifdef PDICT_ENABLE_STATS
+static uint64_t pdict_stats_clock(void);
 #endif
 
 pdict *pdict_create() {
+  return pdict_create_with_options(0);
+}
+
+pdict *pdict_create_with_options(const pdict_options *options) {
   pdict *self = calloc(1, sizeof(pdict));
-  self->table_max_size = PDICT_INITIAL_SIZE;
-  self->elements = calloc(self->table_max_size, sizeof(pdict_node *));
+  self->mode = options ? options->mode : PDICT_CHAINED;
+  self->hasher = options && options->hasher ? options->hasher : phash_bytes;
+  self->seed = options && options->seed ? options->seed : phash_random_seed();
+  self->incremental_rehash = options && options->incremental_rehash;
+  self->max_load_factor = self->mode == PDICT_OPEN_ADDRESSING
+                          ? PDICT_OPEN_MAX_LOAD : PDICT_CHAINED_MAX_LOAD;
+
+  if (options && options->max_load_factor > 0) {
+    pdict_set_max_load_factor(self, options->max_load_factor);
+  }
+
+  size_t capacity = options && options->capacity ? options->capacity : PDICT_INITIAL_SIZE;
+  self->table_max_size = pdict_table_size_for(self, capacity);
+
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    self->control = malloc(self->table_max_size);
+    memset(self->control, PDICT_CTRL_EMPTY, self->table_max_size);
+    self->slots = calloc(self->table_max_size, sizeof(pdict_node));
+  } else {
+    self->elements = calloc(self->table_max_size, sizeof(pdict_node *));
+  }
+
   self->table_current_size = 0;
   self->elements_count = 0;
+  pdict_set_threshold(self);
   return self;
 }
 
-void pdict_put(pdict *self, char *key, void *data) {
-  size_t key_hash = pdict_hash((unsigned char *)key);
-  size_t key_len = strlen(key);
-  size_t index = key_hash % self->table_max_size;
+pdict *pdict_create_with_capacity(size_t capacity) {
+  return pdict_create_with_options(&(pdict_options) {
+    .capacity = capacity,
+  });
+}
+
+void pdict_reserve(pdict *self, size_t capacity) {
+  size_t new_max_size = pdict_table_size_for(self, capacity);
 
-  pdict_node *new_element =
-    pdict_create_element(pdict_strndup(key, key_len), key_hash, key_len, data);
+  if (new_max_size > self->table_max_size) {
+    pdict_rebuild(self, new_max_size);
+  }
+}
 
-  pdict_node *element = self->elements[index];
+void pdict_shrink_to_fit(pdict *self) {
+  size_t new_max_size = pdict_table_size_for(self, self->elements_count);
 
-  if (!element) {
-    self->elements[index] = new_element;
-    self->table_current_size++;
+  if (new_max_size < self->table_max_size) {
+    pdict_rebuild(self, new_max_size);
+  }
+}
+
+void pdict_set_max_load_factor(pdict *self, double max_load_factor) {
+  if (max_load_factor <= 0) {
+    return;
+  }
+
+  if (self->mode == PDICT_OPEN_ADDRESSING && max_load_factor > PDICT_OPEN_MAX_LOAD_LIMIT) {
+    max_load_factor = PDICT_OPEN_MAX_LOAD_LIMIT;
+  }
+
+  self->max_load_factor = max_load_factor;
+  pdict_set_threshold(self);
+}
+
+double pdict_max_load_factor(pdict *self) {
+  return self->max_load_factor;
+}
+
+size_t pdict_capacity(pdict *self) {
+  return self->grow_threshold;
+}
+
+pdict *pdict_bulk_load(const void *const *keys, const size_t *lens, void *const *values,
+                       size_t n, size_t nthreads) {
+  return pdict_bulk_load_with_options(0, keys, lens, values, n, nthreads);
+}
+
+/*
+ * Chained mode works in three parallel passes over the input, each thread
+ * owning a contiguous range of it:
+ *
+ *  1. hash every key and count, per thread, how many keys (and long key
+ *     bytes) fall in each partition, a partition being a contiguous range of
+ *     buckets,
+ *  2. scatter the input indexes so each partition gets its own run, in
+ *     input order,
+ *  3. link the nodes of every partition into its buckets, using the slot of
+ *     the index in that run as the node slot in the slab.
+ *
+ * Partitions own disjoint buckets, so the last pass needs no locking. Open
+ * addressing probes may cross partitions, so it only hashes in parallel and
+ * then fills the slots on the calling thread.
+ */
+pdict *pdict_bulk_load_with_options(const pdict_options *options, const void *const *keys,
+                                    const size_t *lens, void *const *values, size_t n,
+                                    size_t nthreads) {
+  pdict_options bulk_options = options ? *options : (pdict_options) {0};
+
+  if (bulk_options.capacity < n) {
+    bulk_options.capacity = n;
+  }
+  /* the table is sized upfront, later growth follows the caller's choice */
+  bulk_options.incremental_rehash = false;
+
+  pdict *self = pdict_create_with_options(&bulk_options);
+
+  if (n == 0) {
+    self->incremental_rehash = options && options->incremental_rehash;
+    return self;
+  }
+
+  pdict_bulk bulk = {
+    .dict = self,
+    .keys = keys,
+    .lens = lens,
+    .values = values,
+    .n = n,
+    .nthreads = nthreads ? nthreads : 1,
+  };
+
+  if (bulk.nthreads > n) {
+    bulk.nthreads = n;
+  }
+
+  bulk.partitions = bulk.nthreads * PDICT_BULK_PARTITIONS_PER_THREAD;
+  if (bulk.partitions > self->table_max_size) {
+    bulk.partitions = self->table_max_size;
+  }
 
-    if (self->table_current_size >= self->table_max_size) {
-      pdict_resize(self, self->table_max_size * 2);
+  size_t cells = bulk.nthreads * bulk.partitions;
+  bulk.hashes = malloc(n * sizeof(size_t));
+  bulk.key_lens = lens ? 0 : malloc(n * sizeof(size_t));
+  bulk.counts = calloc(cells, sizeof(size_t));
+  bulk.key_bytes = calloc(cells, sizeof(size_t));
+  pdict_bulk_run(&bulk, pdict_bulk_hash);
+
+  /* partition major prefix sums, so every partition gets one run */
+  size_t entries = 0, bytes = 0;
+
+  for (size_t partition = 0; partition < bulk.partitions; ++partition) {
+    for (size_t thread = 0; thread < bulk.nthreads; ++thread) {
+      size_t cell = thread * bulk.partitions + partition;
+      size_t count = bulk.counts[cell], key_bytes = bulk.key_bytes[cell];
+
+      bulk.counts[cell] = entries;
+      bulk.key_bytes[cell] = bytes;
+      entries += count;
+      bytes += key_bytes;
     }
+  }
+
+  self->key_slab = bytes ? malloc(bytes) : 0;
+  self->key_slab_size = bytes;
+
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    pdict_bulk_insert_open(&bulk);
   } else {
-    while (element->next) {
-      element = element->next;
+    self->node_slab = malloc(n * sizeof(pdict_node));
+    self->node_slab_count = n;
+    bulk.order = malloc(n * sizeof(size_t));
+    pdict_bulk_run(&bulk, pdict_bulk_scatter);
+    bulk.partition_elements = calloc(bulk.partitions, sizeof(size_t));
+    bulk.partition_used = calloc(bulk.partitions, sizeof(size_t));
+    pdict_bulk_run(&bulk, pdict_bulk_build);
+
+    for (size_t partition = 0; partition < bulk.partitions; ++partition) {
+      self->elements_count += bulk.partition_elements[partition];
+      self->table_current_size += bulk.partition_used[partition];
     }
 
-    element->next = new_element;
+    free(bulk.order);
+    free(bulk.partition_elements);
+    free(bulk.partition_used);
   }
 
-  self->elements_count++;
+  free(bulk.hashes);
+  free(bulk.key_lens);
+  free(bulk.counts);
+  free(bulk.key_bytes);
+  self->incremental_rehash = options && options->incremental_rehash;
+  return self;
+}
+
+pdict *pdict_create_with_hasher(pdict_hasher hasher, uint64_t seed) {
+  return pdict_create_with_options(&(pdict_options) {
+    .hasher = hasher,
+    .seed = seed,
+  });
+}
+
+void pdict_put(pdict *self, char *key, void *data) {
+  pdict_upsert_n(self, key, strlen(key), data);
+}
+
+void pdict_put_n(pdict *self, const void *key, size_t key_len, void *data) {
+  pdict_upsert_n(self, key, key_len, data);
+}
+
+void *pdict_upsert(pdict *self, char *key, void *data) {
+  return pdict_upsert_n(self, key, strlen(key), data);
+}
+
+void *pdict_upsert_n(pdict *self, const void *key, size_t key_len, void *data) {
+  return pdict_upsert_hashed(self, key, key_len, pdict_hash(self, key, key_len), data);
+}
+
+void *pdict_upsert_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash,
+                          void *data) {
+  bool inserted;
+  pdict_node *element = pdict_find_or_insert(self, key, key_len, (size_t) hash, &inserted);
+  void *old_data = inserted ? 0 : element->data;
+  element->data = data;
+  return old_data;
+}
+
+bool pdict_put_if_absent(pdict *self, char *key, void *data) {
+  size_t key_len = strlen(key);
+  return pdict_put_if_absent_hashed(self, key, key_len, pdict_hash(self, key, key_len), data);
+}
+
+bool pdict_put_if_absent_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash,
+                                void *data) {
+  bool inserted;
+  pdict_node *element = pdict_find_or_insert(self, key, key_len, (size_t) hash, &inserted);
+
+  if (inserted) {
+    element->data = data;
+  }
+
+  return inserted;
+}
+
+void **pdict_get_or_insert(pdict *self, char *key, bool *inserted) {
+  return pdict_get_or_insert_n(self, key, strlen(key), inserted);
+}
+
+void **pdict_get_or_insert_n(pdict *self, const void *key, size_t key_len, bool *inserted) {
+  bool was_inserted;
+  pdict_node *element =
+    pdict_find_or_insert(self, key, key_len, pdict_hash(self, key, key_len), &was_inserted);
+
+  if (inserted) {
+    *inserted = was_inserted;
+  }
+
+  return &element->data;
 }
 
 void *pdict_get_value(pdict *self, char *key) {
-  pdict_node *element = pdict_get_element(self, key);
+  return pdict_get_n(self, key, strlen(key));
+}
+
+void *pdict_get_n(pdict *self, const void *key, size_t key_len) {
+  return pdict_get_hashed(self, key, key_len, pdict_hash(self, key, key_len));
+}
+
+void *pdict_get_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash) {
+  pdict_node *element = pdict_get_element(self, key, key_len, (size_t) hash);
   return element ? element->data : 0;
 }
 
+size_t pdict_get_many(pdict *self, const void *const *keys, const size_t *lens, size_t n,
+                      void **out_values) {
+  size_t found = 0;
+
+  for (size_t first = 0; first < n; first += PDICT_BATCH_SIZE) {
+    size_t count = n - first < PDICT_BATCH_SIZE ? n - first : PDICT_BATCH_SIZE;
+    pdict_get_batch(self, keys + first, lens ? lens + first : 0, count, out_values + first);
+
+    for (size_t i = first; i < first + count; ++i) {
+      found += out_values[i] != 0;
+    }
+  }
+
+  return found;
+}
+
 void *pdict_remove(pdict *self, char *key) {
-  void *data = pdict_remove_element(self, key);
+  return pdict_remove_n(self, key, strlen(key));
+}
+
+void *pdict_remove_n(pdict *self, const void *key, size_t key_len) {
+  return pdict_remove_hashed(self, key, key_len, pdict_hash(self, key, key_len));
+}
 
-  if (data != 0) {
+void *pdict_remove_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash) {
+  void *data = 0;
+
+  /* values may be null (see pdict_get_or_insert), so count on the key */
+  if (pdict_remove_element(self, key, key_len, (size_t) hash, &data)) {
     self->elements_count--;
   }
 
@@ -109,23 +546,89 @@ void pdict_remove_and_destroy(pdict *self, char *key, pdict_destroyer destroyer)
   if (!self || !key || !destroyer)
     return;
 
-  void *data = pdict_remove_element(self, key);
+  size_t key_len = strlen(key);
+  void *data;
 
-  if (data != 0) {
+  if (pdict_remove_element(self, key, key_len, pdict_hash(self, key, key_len), &data)) {
     self->elements_count--;
     destroyer(data);
   }
 }
 
 void pdict_iterate(pdict *self, pdict_closure closure) {
-  for (size_t index = 0; index < self->table_max_size; ++index) {
-    pdict_node *element = self->elements[index];
+  pdict_iter iter;
+  pdict_entry entry;
+
+  pdict_iter_init(&iter, self);
+
+  while (pdict_iter_next(&iter, &entry)) {
+    closure(entry.key, entry.value);
+  }
+}
+
+void pdict_iterate_with_context(pdict *self, pdict_context_closure closure, void *ctx) {
+  pdict_iter iter;
+  pdict_entry entry;
+
+  pdict_iter_init(&iter, self);
+
+  while (pdict_iter_next(&iter, &entry)) {
+    closure(entry.key, entry.value, ctx);
+  }
+}
 
-    while (element != 0) {
-      closure(element->key, element->data);
-      element = element->next;
+void pdict_iter_init(pdict_iter *iter, pdict *self) {
+  *iter = (pdict_iter) {
+    .dict = self
+  };
+}
+
+bool pdict_iter_next(pdict_iter *iter, pdict_entry *entry) {
+  pdict *self = iter->dict;
+  pdict_node *element = 0;
+
+  if (!self) {
+    return false;
+  }
+
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    while (iter->index < self->table_max_size && self->control[iter->index] < 0) {
+      iter->index++;
+    }
+
+    if (iter->index == self->table_max_size) {
+      return false;
+    }
+
+    element = &self->slots[iter->index++];
+  } else {
+    pdict_node **tables[2];
+    size_t sizes[2];
+    size_t table_count = pdict_chained_tables(self, tables, sizes);
+
+    /* rest of the current chain first, then the next non empty bucket */
+    element = iter->node;
+
+    while (!element && iter->table < table_count) {
+      if (iter->index < sizes[iter->table]) {
+        element = tables[iter->table][iter->index++];
+      } else {
+        iter->table++;
+        iter->index = 0;
+      }
     }
+
+    if (!element) {
+      return false;
+    }
+
+    iter->node = element->next;
   }
+
+  entry->key = element->key;
+  entry->key_len = element->key_len;
+  entry->value = element->data;
+  return true;
 }
 
 void pdict_clean(pdict *self) {
@@ -137,7 +640,12 @@ void pdict_clean_and_destroy_elements(pdict *self, pdict_destroyer destroyer) {
 }
 
 bool pdict_has_key(pdict *self, char *key) {
-  return pdict_get_element(self, key) != 0;
+  size_t key_len = strlen(key);
+  return pdict_has_key_hashed(self, key, key_len, pdict_hash(self, key, key_len));
+}
+
+bool pdict_has_key_hashed(pdict *self, const void *key, size_t key_len, uint64_t hash) {
+  return pdict_get_element(self, key, key_len, (size_t) hash) != 0;
 }
 
 bool pdict_is_empty(pdict *self) { return self->elements_count == 0; }
@@ -145,22 +653,26 @@ bool pdict_is_empty(pdict *self) { return self->elements_count == 0; }
 size_t pdict_size(pdict *self) { return self->elements_count; }
 
 void pdict_destroy(pdict *self) {
-  pdict_clean(self);
-  free(self->elements);
-  free(self);
+  pdict_destroy_all(self, 0);
 }
 
 void pdict_destroy_all(pdict *self, pdict_destroyer destroyer) {
   pdict_clean_and_destroy_elements(self, destroyer);
   free(self->elements);
+  free(self->old_elements);
+  free(self->control);
+  free(self->slots);
   free(self);
 }
 
 pdict_entry pdict_get(pdict *self, char *key) {
-  pdict_node *element = pdict_get_element(self, key);
+  size_t key_len = strlen(key);
+  pdict_node *element = pdict_get_element(self, key, key_len, pdict_hash(self, key, key_len));
+  if (!element) return (pdict_entry) {0};
   return (pdict_entry) {
     .key = element->key,
     .value = element->data,
+    .key_len = element->key_len,
   };
 }
 
@@ -168,175 +680,944 @@ pdict_entries pdict_get_all(pdict *self) {
   if (!self) return (pdict_entries) {0};
   pdict_entries entries = {
     .count = self->elements_count,
-    .entries = calloc(self->elements_count, sizeof(pdict_entries))
+    .entries = calloc(self->elements_count, sizeof(pdict_entry))
   };
+  pdict_iter iter;
 
-  for (size_t i = 0, j = 0; i < self->elements_count; ++j) {
-    pdict_node *element = self->elements[j];
-    if (!element) continue;
+  pdict_iter_init(&iter, self);
 
-    entries.entries[i].key = element->key;
-    entries.entries[i++].value = element->data;
+  size_t i = 0;
 
-    while (element->next) {
-      element = element->next;
-      entries.entries[i].key = element->key;
-      entries.entries[i++].value = element->data;
-    }
+  while (i < entries.count && pdict_iter_next(&iter, &entries.entries[i])) {
+    i++;
   }
 
   return entries;
 }
 
-static void pdict_resize(pdict *self, size_t new_max_size) {
-  pdict_node **new_table = calloc(new_max_size, sizeof(pdict_node *));
-  pdict_node **old_table = self->elements;
-  self->table_current_size = 0;
-  size_t table_index;
+bool pdict_rehash_step(pdict *self, size_t buckets) {
+  if (!self || !self->old_elements) {
+    return false;
+  }
 
-  for (table_index = 0; table_index < self->table_max_size; table_index++) {
-    pdict_node *old_element = old_table[table_index];
-    pdict_node *next_element;
+  size_t empty_visits = buckets > SIZE_MAX / PDICT_REHASH_EMPTY_VISITS
+                        ? SIZE_MAX : buckets * PDICT_REHASH_EMPTY_VISITS;
 
-    while (old_element != 0) {
-      // new position
-      size_t new_index = old_element->hashcode % new_max_size;
-      pdict_node *new_element = new_table[new_index];
+  while (buckets > 0 && self->rehash_index < self->old_max_size) {
+    if (self->old_elements[self->rehash_index]) {
+      pdict_migrate_bucket(self, self->rehash_index);
+      buckets--;
+    } else if (--empty_visits == 0) {
+      break;
+    }
 
-      if (new_element == 0) {
-        new_table[new_index] = old_element;
-        self->table_current_size++;
-      } else {
-        while (new_element->next != 0) {
-          new_element = new_element->next;
-        }
+    self->rehash_index++;
+  }
+
+  if (self->rehash_index < self->old_max_size) {
+    return true;
+  }
+
+  free(self->old_elements);
+  self->old_elements = 0;
+  self->old_max_size = 0;
+  self->rehash_index = 0;
+  return false;
+}
 
-        new_element->next = old_element;
+bool pdict_is_rehashing(pdict *self) {
+  return self && self->old_elements != 0;
+}
+
+void pdict_stats(pdict *self, pdict_statistics *stats) {
+  memset(stats, 0, sizeof(*stats));
+  stats->mode = self->mode;
+  stats->elements = self->elements_count;
+  stats->buckets = self->table_max_size;
+  stats->used_buckets = self->table_current_size;
+  stats->load_factor = (double) self->elements_count / (double) self->table_max_size;
+
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    stats->bucket_bytes = self->table_max_size * (sizeof(pdict_node) + 1);
+
+    for (size_t slot = 0; slot < self->table_max_size; ++slot) {
+      if (self->control[slot] == PDICT_CTRL_DELETED) {
+        stats->deleted_slots++;
+      } else if (self->control[slot] >= 0) {
+        pdict_stats_length(stats, pdict_open_probe_length(self, slot));
+        pdict_stats_node(stats, &self->slots[slot]);
       }
+    }
+  } else {
+    pdict_node **tables[2];
+    size_t sizes[2];
+    size_t table_count = pdict_chained_tables(self, tables, sizes);
+
+    for (size_t table = 0; table < table_count; ++table) {
+      stats->bucket_bytes += sizes[table] * sizeof(pdict_node *);
+
+      for (size_t index = 0; index < sizes[table]; ++index) {
+        size_t length = 0;
+
+        for (pdict_node *element = tables[table][index]; element; element = element->next) {
+          stats->node_bytes += sizeof(pdict_node);
+          pdict_stats_node(stats, element);
+          length++;
+        }
 
-      next_element = old_element->next;
-      old_element->next = 0;
-      old_element = next_element;
+        pdict_stats_length(stats, length);
+      }
     }
   }
 
-  self->elements = new_table;
+#ifdef PDICT_ENABLE_STATS
+  stats->counters_enabled = true;
+  stats->hits = atomic_load_explicit(&self->counters.hits, memory_order_relaxed);
+  stats->misses = atomic_load_explicit(&self->counters.misses, memory_order_relaxed);
+  stats->resizes = self->counters.resizes;
+  stats->resize_seconds = (double) self->counters.resize_ns * 1e-9;
+#endif
+}
+
+void pdict_reset_stats(pdict *self) {
+#ifdef PDICT_ENABLE_STATS
+  atomic_store_explicit(&self->counters.hits, 0, memory_order_relaxed);
+  atomic_store_explicit(&self->counters.misses, 0, memory_order_relaxed);
+  self->counters.resizes = 0;
+  self->counters.resize_ns = 0;
+#else
+  (void) self;
+#endif
+}
+
+/*
+ * Growing keeps the old bucket array around and moves its chains a few
+ * buckets at a time (see pdict_rehash_step). Without incremental_rehash all
+ * of them are moved right away, as it always used to be.
+ */
+static void pdict_resize(pdict *self, size_t new_max_size) {
+  if (self->old_elements) {
+    pdict_rehash_step(self, SIZE_MAX);
+  }
+
+  self->old_elements = self->elements;
+  self->old_max_size = self->table_max_size;
+  self->rehash_index = 0;
+  self->elements = calloc(new_max_size, sizeof(pdict_node *));
   self->table_max_size = new_max_size;
-  free(old_table);
+  self->table_current_size = 0;
+
+  if (!self->incremental_rehash) {
+    pdict_rehash_step(self, SIZE_MAX);
+  }
+}
+
+static void pdict_migrate_bucket(pdict *self, size_t old_index) {
+  pdict_node *element = self->old_elements[old_index];
+
+  while (element != 0) {
+    pdict_node *next_element = element->next;
+    size_t new_index = element->hashcode % self->table_max_size;
+
+    if (self->elements[new_index] == 0) {
+      self->table_current_size++;
+    }
+
+    element->next = self->elements[new_index];
+    self->elements[new_index] = element;
+    element = next_element;
+  }
+
+  self->old_elements[old_index] = 0;
+}
+
+static size_t pdict_chained_tables(const pdict *self, pdict_node **tables[2], size_t sizes[2]) {
+  tables[0] = self->elements;
+  sizes[0] = self->table_max_size;
+
+  if (!self->old_elements) {
+    return 1;
+  }
+
+  tables[1] = self->old_elements;
+  sizes[1] = self->old_max_size;
+  return 2;
 }
 
 static void
 internal_dictionary_clean_and_destroy_elements(pdict *self, pdict_destroyer destroyer) {
-  for (size_t table_index = 0; table_index < self->table_max_size;
-       table_index++) {
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    for (size_t slot = 0; slot < self->table_max_size; slot++) {
+      if (self->control[slot] >= 0) {
+        if (destroyer) destroyer(self->slots[slot].data);
+        pdict_node_release_key(self, &self->slots[slot]);
+      }
+    }
 
-    pdict_node *element = self->elements[table_index];
+    memset(self->control, PDICT_CTRL_EMPTY, self->table_max_size);
+    self->table_current_size = 0;
+    self->elements_count = 0;
+    pdict_release_slabs(self);
+    return;
+  }
 
-    while (element != 0) {
-      pdict_node *next_element = element->next;
-      pdict_destroy_element(element, destroyer);
-      element = next_element;
-    }
+  pdict_node **tables[2];
+  size_t sizes[2];
+  size_t table_count = pdict_chained_tables(self, tables, sizes);
 
-    self->elements[table_index] = 0;
+  for (size_t table = 0; table < table_count; ++table) {
+    for (size_t table_index = 0; table_index < sizes[table]; table_index++) {
+      pdict_node *element = tables[table][table_index];
+
+      while (element != 0) {
+        pdict_node *next_element = element->next;
+        pdict_destroy_element(self, element, destroyer);
+        element = next_element;
+      }
+
+      tables[table][table_index] = 0;
+    }
   }
 
+  free(self->old_elements);
+  self->old_elements = 0;
+  self->old_max_size = 0;
+  self->rehash_index = 0;
+
   self->table_current_size = 0;
   self->elements_count = 0;
+  pdict_release_slabs(self);
 }
 
-static pdict_node *pdict_create_element(char *key, size_t key_hash,
+static pdict_node *pdict_create_element(const void *key, size_t key_hash,
                                         size_t key_len, void *data) {
   pdict_node *element = malloc(sizeof(pdict_node));
-  element->key = key;
-  element->key_len = key_len;
+  pdict_node_set_key(element, key, key_len);
   element->hashcode = key_hash;
   element->data = data;
   element->next = 0;
   return element;
 }
 
-static pdict_node *pdict_get_element(pdict *self, char *key) {
-  size_t input_key_hash = pdict_hash((unsigned char *)key);
-  size_t index = input_key_hash % self->table_max_size;
-  pdict_node *element = self->elements[index];
+static pdict_node *pdict_get_element(pdict *self, const void *key, size_t key_len,
+                                     size_t key_hash) {
+  pdict_node *element;
 
-  if (!element) {
-    return 0;
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    element = pdict_open_find(self, key, key_len, key_hash);
+  } else {
+    pdict_node **link = pdict_chained_find(self, key, key_len, key_hash, 0);
+    element = link ? *link : 0;
   }
 
-  #ifdef __USE_XOPEN2K8
-  size_t smallest_key_len = strnlen(key, element->key_len);
-  #else
-  size_t key_len = strlen(key);
-  size_t smallest_key_len = key_len < element->key_len
-                            ? key_len
-                            : element->key_len;
-  #endif
-  do {
-    if (element->hashcode == input_key_hash
-        && strncmp(element->key, key, smallest_key_len) == 0) {
-      return element;
-    }
-  } while ((element = element->next) != 0);
-
-  return 0;
+  PDICT_STAT_LOOKUP(self, element);
+  return element;
 }
 
-static void *pdict_remove_element(pdict *self, char *key) {
-  unsigned long key_hash = pdict_hash((unsigned char *)key);
+static pdict_node *pdict_find_or_insert(pdict *self, const void *key, size_t key_len,
+                                        size_t key_hash, bool *inserted) {
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    return pdict_open_find_or_insert(self, key, key_len, key_hash, inserted);
+  }
+
+  pdict_node **link = pdict_chained_find(self, key, key_len, key_hash, 0);
+
+  if (link) {
+    *inserted = false;
+    return *link;
+  }
+
   size_t index = key_hash % self->table_max_size;
-  pdict_node *element = self->elements[index];
+  pdict_node *element =
+    pdict_create_element(key, key_hash, key_len, 0);
+
+  if (!self->elements[index]) {
+    self->table_current_size++;
+  }
+
+  element->next = self->elements[index];
+  self->elements[index] = element;
+  self->elements_count++;
+  *inserted = true;
+
+  /* chained nodes never move, so growing after linking keeps element valid */
+  if (self->elements_count > self->grow_threshold) {
+    pdict_rebuild(self, self->table_max_size * 2);
+  }
+
+  return element;
+}
 
-  if (!element) {
-    return 0;
+/* Unlinks the node holding key and hands its value out, false if there is none */
+static bool pdict_remove_element(pdict *self, const void *key, size_t key_len, size_t key_hash,
+                                 void **data) {
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    return pdict_open_remove(self, key, key_len, key_hash, data);
   }
 
-  if (element->hashcode == key_hash) {
-    void *data = element->data;
-    self->elements[index] = element->next;
+  pdict_node **bucket;
+  pdict_node **link = pdict_chained_find(self, key, key_len, key_hash, &bucket);
 
-    if (self->elements[index] == 0) {
-      self->table_current_size--;
+  if (!link) {
+    return false;
+  }
+
+  pdict_node *element = *link;
+  *data = element->data;
+  *link = element->next;
+
+  /* table_current_size only tracks buckets of the current table */
+  if (*bucket == 0 && bucket == &self->elements[key_hash % self->table_max_size]) {
+    self->table_current_size--;
+  }
+
+  pdict_node_release_key(self, element);
+  pdict_free_node(self, element);
+  return true;
+}
+
+/*
+ * Returns the link pointing at the node holding key, or 0 if there is none.
+ * While rehashing, the old table is only searched if the key's old bucket has
+ * not been migrated yet.
+ */
+static pdict_node **pdict_chained_find(pdict *self, const void *key, size_t key_len,
+                                       size_t key_hash, pdict_node ***bucket) {
+  if (self->old_elements) {
+    PDICT_STAT_TIMER_START(timer);
+    pdict_rehash_step(self, PDICT_REHASH_STEP);
+    PDICT_STAT_TIMER_STOP(self, timer);
+  }
+
+  pdict_node **head = &self->elements[key_hash % self->table_max_size];
+  pdict_node **link = pdict_chain_search(head, key, key_len, key_hash);
+
+  if (!link && self->old_elements) {
+    size_t old_index = key_hash % self->old_max_size;
+
+    if (old_index >= self->rehash_index) {
+      head = &self->old_elements[old_index];
+      link = pdict_chain_search(head, key, key_len, key_hash);
     }
+  }
 
-    free(element->key);
-    free(element);
-    return data;
+  if (bucket) {
+    *bucket = head;
   }
 
-  while (element->next != 0) {
-    if (element->next->hashcode == key_hash) {
-      void *data = element->next->data;
-      pdict_node *aux = element->next;
-      element->next = element->next->next;
-      free(aux->key);
-      free(aux);
-      return data;
+  return link;
+}
+
+static pdict_node **pdict_chain_search(pdict_node **link, const void *key,
+                                       size_t key_len, size_t key_hash) {
+  while (*link != 0) {
+    pdict_node *element = *link;
+
+    if (element->hashcode == key_hash && pdict_key_equals(element, key, key_len)) {
+      return link;
     }
 
-    element = element->next;
+    link = &element->next;
   }
 
   return 0;
 }
 
-static void pdict_destroy_element(pdict_node *element, pdict_destroyer destroyer) {
+static void pdict_destroy_element(pdict *self, pdict_node *element, pdict_destroyer destroyer) {
   if (destroyer) {
     destroyer(element->data);
   }
 
-  if (element->key) free(element->key);
-  free(element);
+  pdict_node_release_key(self, element);
+  pdict_free_node(self, element);
+}
+
+/*
+ * Keys are copied with a trailing NUL so string keys can be handed out as is.
+ * Short ones go in the node itself, saving an allocation and a cache miss.
+ */
+static void pdict_node_set_key(pdict_node *element, const void *key, size_t key_len) {
+  element->key = key_len < PDICT_INLINE_KEY_LEN ? element->inline_key : malloc(key_len + 1);
+  element->key_len = key_len;
+  memcpy(element->key, key, key_len);
+  element->key[key_len] = '\0';
+}
+
+static void pdict_node_release_key(const pdict *self, pdict_node *element) {
+  uintptr_t key = (uintptr_t) element->key;
+  uintptr_t slab = (uintptr_t) self->key_slab;
+
+  if (element->key != element->inline_key && (key < slab || key >= slab + self->key_slab_size)) {
+    free(element->key);
+  }
+
+  element->key = 0;
+}
+
+/* Nodes carved out of the bulk load slab are only freed along with it */
+static void pdict_free_node(const pdict *self, pdict_node *element) {
+  uintptr_t node = (uintptr_t) element;
+  uintptr_t slab = (uintptr_t) self->node_slab;
+
+  if (node < slab || node >= slab + self->node_slab_count * sizeof(pdict_node)) {
+    free(element);
+  }
+}
+
+static void pdict_release_slabs(pdict *self) {
+  free(self->node_slab);
+  free(self->key_slab);
+  self->node_slab = 0;
+  self->node_slab_count = 0;
+  self->key_slab = 0;
+  self->key_slab_size = 0;
+}
+
+/* Copies a node into a slot, pointing inline keys at the slot's own buffer */
+static inline void pdict_node_move(pdict_node *to, const pdict_node *from) {
+  *to = *from;
+
+  if (from->key == from->inline_key) {
+    to->key = to->inline_key;
+  }
+}
+
+static bool pdict_key_equals(const pdict_node *element, const void *key, size_t key_len) {
+  return element->key_len == key_len && memcmp(element->key, key, key_len) == 0;
+}
+
+/********* OPEN ADDRESSING **************/
+
+/* cheap finalizer so weak user supplied hashers still spread tags and groups */
+static inline size_t pdict_open_mix(size_t key_hash) {
+  uint64_t h = (uint64_t) key_hash;
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (size_t) h;
+}
+
+static inline int8_t pdict_open_tag(size_t mixed_hash) {
+  return (int8_t)(mixed_hash & 0x7F);
+}
+
+static inline size_t pdict_open_first_group(const pdict *self, size_t mixed_hash) {
+  return (mixed_hash >> 7) & (self->table_max_size / PDICT_GROUP_WIDTH - 1);
+}
+
+static inline unsigned pdict_ctz(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned) __builtin_ctz(mask);
+#else
+  unsigned count = 0;
+  while (!(mask & 1u)) {
+    mask >>= 1;
+    count++;
+  }
+  return count;
+#endif
+}
+
+/* Bitmask of the slots in the group whose control byte equals tag. */
+static inline unsigned pdict_group_match(const int8_t *group, int8_t tag) {
+#ifdef PDICT_USE_SSE2
+  __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+  return (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < PDICT_GROUP_WIDTH; ++i) {
+    mask |= (unsigned)(group[i] == tag) << i;
+  }
+  return mask;
+#endif
+}
+
+/* Bitmask of the slots in the group that are either empty or deleted. */
+static inline unsigned pdict_group_match_free(const int8_t *group) {
+#ifdef PDICT_USE_SSE2
+  return (unsigned) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+  unsigned mask = 0;
+  for (unsigned i = 0; i < PDICT_GROUP_WIDTH; ++i) {
+    mask |= (unsigned)(group[i] < 0) << i;
+  }
+  return mask;
+#endif
+}
+
+/* Smallest table that holds capacity elements without exceeding the load factor */
+static size_t pdict_table_size_for(const pdict *self, size_t capacity) {
+  double buckets = (double) capacity / self->max_load_factor;
+
+  if (self->mode != PDICT_OPEN_ADDRESSING) {
+    size_t size = (size_t) buckets;
+    size += (double) size < buckets;
+    return size ? size : 1;
+  }
+
+  size_t size = PDICT_GROUP_WIDTH;
+
+  while ((double) size < buckets) {
+    size *= 2;
+  }
+
+  return size;
+}
+
+static void pdict_set_threshold(pdict *self) {
+  self->grow_threshold = (size_t)((double) self->table_max_size * self->max_load_factor);
+
+  if (self->mode == PDICT_OPEN_ADDRESSING && self->grow_threshold >= self->table_max_size) {
+    self->grow_threshold = self->table_max_size - 1;
+  }
+}
+
+static void pdict_rebuild(pdict *self, size_t new_max_size) {
+  PDICT_STAT_TIMER_START(timer);
+  size_t needed = pdict_table_size_for(self, self->elements_count);
+
+  if (new_max_size < needed) {
+    new_max_size = needed;
+  }
+
+  if (self->mode == PDICT_OPEN_ADDRESSING) {
+    pdict_open_resize(self, new_max_size);
+  } else {
+    pdict_resize(self, new_max_size);
+  }
+
+  pdict_set_threshold(self);
+  PDICT_STAT_RESIZE(self);
+  PDICT_STAT_TIMER_STOP(self, timer);
+}
+
+static pdict_node *pdict_open_find(pdict *self, const void *key, size_t key_len,
+                                   size_t key_hash) {
+  size_t mixed = pdict_open_mix(key_hash);
+  int8_t tag = pdict_open_tag(mixed);
+  size_t group_mask = self->table_max_size / PDICT_GROUP_WIDTH - 1;
+  size_t group = pdict_open_first_group(self, mixed);
+
+  for (size_t step = 1; step <= group_mask + 1; ++step) {
+    const int8_t *control = &self->control[group * PDICT_GROUP_WIDTH];
+    unsigned match = pdict_group_match(control, tag);
+
+    while (match) {
+      pdict_node *slot = &self->slots[group * PDICT_GROUP_WIDTH + pdict_ctz(match)];
+
+      if (slot->hashcode == key_hash && pdict_key_equals(slot, key, key_len)) {
+        return slot;
+      }
+
+      match &= match - 1;
+    }
+
+    if (pdict_group_match(control, PDICT_CTRL_EMPTY)) {
+      return 0;
+    }
+
+    group = (group + step) & group_mask;
+  }
+
+  return 0;
 }
 
-static size_t pdict_hash(unsigned char const *str) {
-  size_t hash = 5381;
-  int c;
+static size_t pdict_open_find_free_slot(const pdict *self, size_t key_hash) {
+  size_t mixed = pdict_open_mix(key_hash);
+  size_t group_mask = self->table_max_size / PDICT_GROUP_WIDTH - 1;
+  size_t group = pdict_open_first_group(self, mixed);
 
-  while ((c = *str++)) {
-    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+  for (size_t step = 1;; ++step) {
+    unsigned match = pdict_group_match_free(&self->control[group * PDICT_GROUP_WIDTH]);
+
+    if (match) {
+      return group * PDICT_GROUP_WIDTH + pdict_ctz(match);
+    }
+
+    group = (group + step) & group_mask;
   }
+}
+
+/*
+ * Single probe insertion: the same walk that looks for the key remembers the
+ * first free slot, which is where the key goes if it turns out to be missing.
+ */
+static pdict_node *pdict_open_find_or_insert(pdict *self, const void *key, size_t key_len,
+                                             size_t key_hash, bool *inserted) {
+  /* table_current_size counts full and deleted slots, both lengthen probes */
+  if (self->table_current_size + 1 > self->grow_threshold) {
+    /* mostly tombstones: rehashing in place is enough to reclaim them */
+    bool mostly_deleted = (self->elements_count + 1) * 2 <= self->grow_threshold;
+    pdict_rebuild(self, mostly_deleted ? self->table_max_size : self->table_max_size * 2);
+  }
+
+  size_t mixed = pdict_open_mix(key_hash);
+  int8_t tag = pdict_open_tag(mixed);
+  size_t group_mask = self->table_max_size / PDICT_GROUP_WIDTH - 1;
+  size_t group = pdict_open_first_group(self, mixed);
+  size_t free_slot = SIZE_MAX;
+
+  for (size_t step = 1; step <= group_mask + 1; ++step) {
+    const int8_t *control = &self->control[group * PDICT_GROUP_WIDTH];
+    unsigned match = pdict_group_match(control, tag);
+
+    while (match) {
+      pdict_node *slot = &self->slots[group * PDICT_GROUP_WIDTH + pdict_ctz(match)];
+
+      if (slot->hashcode == key_hash && pdict_key_equals(slot, key, key_len)) {
+        *inserted = false;
+        return slot;
+      }
+
+      match &= match - 1;
+    }
+
+    unsigned free_match = pdict_group_match_free(control);
+
+    if (free_slot == SIZE_MAX && free_match) {
+      free_slot = group * PDICT_GROUP_WIDTH + pdict_ctz(free_match);
+    }
+
+    if (pdict_group_match(control, PDICT_CTRL_EMPTY)) {
+      break;
+    }
+
+    group = (group + step) & group_mask;
+  }
+
+  if (self->control[free_slot] == PDICT_CTRL_EMPTY) {
+    self->table_current_size++;
+  }
+
+  pdict_node *slot = &self->slots[free_slot];
+  self->control[free_slot] = tag;
+  pdict_node_set_key(slot, key, key_len);
+  slot->hashcode = key_hash;
+  slot->data = 0;
+  slot->next = 0;
+  self->elements_count++;
+  *inserted = true;
+  return slot;
+}
+
+static bool pdict_open_remove(pdict *self, const void *key, size_t key_len, size_t key_hash,
+                              void **data) {
+  pdict_node *slot = pdict_open_find(self, key, key_len, key_hash);
+
+  if (!slot) {
+    return false;
+  }
+
+  size_t index = (size_t)(slot - self->slots);
+  const int8_t *group = &self->control[index - index % PDICT_GROUP_WIDTH];
+
+  /*
+   * Probing stops at the first group holding an empty slot, so if this group
+   * already has one nobody can be probing past it and the slot can go back to
+   * empty instead of becoming a tombstone.
+   */
+  if (pdict_group_match(group, PDICT_CTRL_EMPTY)) {
+    self->control[index] = PDICT_CTRL_EMPTY;
+    self->table_current_size--;
+  } else {
+    self->control[index] = PDICT_CTRL_DELETED;
+  }
+
+  *data = slot->data;
+  pdict_node_release_key(self, slot);
+  return true;
+}
+
+static void pdict_open_resize(pdict *self, size_t new_max_size) {
+  int8_t *old_control = self->control;
+  pdict_node *old_slots = self->slots;
+  size_t old_max_size = self->table_max_size;
+
+  self->control = malloc(new_max_size);
+  memset(self->control, PDICT_CTRL_EMPTY, new_max_size);
+  self->slots = calloc(new_max_size, sizeof(pdict_node));
+  self->table_max_size = new_max_size;
+  self->table_current_size = 0;
+
+  for (size_t index = 0; index < old_max_size; ++index) {
+    if (old_control[index] < 0) continue;
+
+    size_t slot = pdict_open_find_free_slot(self, old_slots[index].hashcode);
+    self->control[slot] = old_control[index];
+    pdict_node_move(&self->slots[slot], &old_slots[index]);
+    self->table_current_size++;
+  }
+
+  free(old_control);
+  free(old_slots);
+}
+
+/*
+ * Three passes over the batch: hash every key and prefetch its bucket (or
+ * control group), then prefetch the first node (or first matching slot), and
+ * only then compare keys. Prefetches are only hints, the lookups themselves
+ * go through the regular find functions.
+ */
+static void pdict_get_batch(pdict *self, const void *const *keys, const size_t *lens,
+                            size_t n, void **out_values) {
+  size_t key_lens[PDICT_BATCH_SIZE];
+  size_t hashes[PDICT_BATCH_SIZE];
+
+  for (size_t i = 0; i < n; ++i) {
+    key_lens[i] = lens ? lens[i] : strlen(keys[i]);
+    hashes[i] = pdict_hash(self, keys[i], key_lens[i]);
+
+    if (self->mode == PDICT_OPEN_ADDRESSING) {
+      size_t group = pdict_open_first_group(self, pdict_open_mix(hashes[i]));
+      PDICT_PREFETCH(&self->control[group * PDICT_GROUP_WIDTH]);
+    } else {
+      PDICT_PREFETCH(&self->elements[hashes[i] % self->table_max_size]);
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    if (self->mode == PDICT_OPEN_ADDRESSING) {
+      size_t mixed = pdict_open_mix(hashes[i]);
+      size_t group = pdict_open_first_group(self, mixed);
+      unsigned match = pdict_group_match(&self->control[group * PDICT_GROUP_WIDTH],
+                                         pdict_open_tag(mixed));
+
+      if (match) {
+        PDICT_PREFETCH(&self->slots[group * PDICT_GROUP_WIDTH + pdict_ctz(match)]);
+      }
+    } else {
+      pdict_node *head = self->elements[hashes[i] % self->table_max_size];
+
+      if (head) {
+        PDICT_PREFETCH(head);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    pdict_node *element;
+
+    if (self->mode == PDICT_OPEN_ADDRESSING) {
+      element = pdict_open_find(self, keys[i], key_lens[i], hashes[i]);
+    } else {
+      pdict_node **link = pdict_chained_find(self, keys[i], key_lens[i], hashes[i], 0);
+      element = link ? *link : 0;
+    }
+
+    PDICT_STAT_LOOKUP(self, element);
+    out_values[i] = element ? element->data : 0;
+  }
+}
+
+#define PDICT_BULK_LEN(bulk, i) ((bulk)->lens ? (bulk)->lens[i] : (bulk)->key_lens[i])
+
+static inline size_t pdict_bulk_partition(const pdict_bulk *bulk, size_t key_hash) {
+  return key_hash % bulk->dict->table_max_size * bulk->partitions / bulk->dict->table_max_size;
+}
+
+/* Runs phase on every worker, the calling thread being worker 0 */
+static void pdict_bulk_run(pdict_bulk *bulk, void *(*phase)(void *)) {
+  pdict_bulk_worker *workers = malloc(bulk->nthreads * sizeof(pdict_bulk_worker));
+  pthread_t *threads = malloc(bulk->nthreads * sizeof(pthread_t));
+  bool *started = calloc(bulk->nthreads, sizeof(bool));
+
+  for (size_t id = 0; id < bulk->nthreads; ++id) {
+    workers[id] = (pdict_bulk_worker) {
+      bulk, id
+    };
+  }
+
+  for (size_t id = 1; id < bulk->nthreads; ++id) {
+    started[id] = pthread_create(&threads[id], 0, phase, &workers[id]) == 0;
+  }
+
+  phase(&workers[0]);
+
+  for (size_t id = 1; id < bulk->nthreads; ++id) {
+    if (started[id]) {
+      pthread_join(threads[id], 0);
+    } else {
+      phase(&workers[id]);
+    }
+  }
+
+  free(started);
+  free(threads);
+  free(workers);
+}
+
+static void *pdict_bulk_hash(void *arg) {
+  pdict_bulk_worker *worker = arg;
+  pdict_bulk *bulk = worker->bulk;
+  size_t *counts = &bulk->counts[worker->id * bulk->partitions];
+  size_t *key_bytes = &bulk->key_bytes[worker->id * bulk->partitions];
+  size_t end = bulk->n * (worker->id + 1) / bulk->nthreads;
+
+  for (size_t i = bulk->n * worker->id / bulk->nthreads; i < end; ++i) {
+    if (!bulk->lens) {
+      bulk->key_lens[i] = strlen(bulk->keys[i]);
+    }
+
+    size_t key_len = PDICT_BULK_LEN(bulk, i);
+    size_t key_hash = pdict_hash(bulk->dict, bulk->keys[i], key_len);
+    size_t partition = pdict_bulk_partition(bulk, key_hash);
+
+    bulk->hashes[i] = key_hash;
+    counts[partition]++;
+    if (key_len >= PDICT_INLINE_KEY_LEN) {
+      key_bytes[partition] += key_len + 1;
+    }
+  }
+
+  return 0;
+}
+
+static void *pdict_bulk_scatter(void *arg) {
+  pdict_bulk_worker *worker = arg;
+  pdict_bulk *bulk = worker->bulk;
+  size_t *offsets = &bulk->counts[worker->id * bulk->partitions];
+  size_t end = bulk->n * (worker->id + 1) / bulk->nthreads;
+
+  for (size_t i = bulk->n * worker->id / bulk->nthreads; i < end; ++i) {
+    bulk->order[offsets[pdict_bulk_partition(bulk, bulk->hashes[i])]++] = i;
+  }
+
+  return 0;
+}
+
+static void *pdict_bulk_build(void *arg) {
+  pdict_bulk_worker *worker = arg;
+  pdict_bulk *bulk = worker->bulk;
+  pdict *self = bulk->dict;
+
+  for (size_t partition = worker->id; partition < bulk->partitions;
+       partition += bulk->nthreads) {
+    /* after scattering, the offsets of the last thread mark where runs end */
+    size_t *ends = &bulk->counts[(bulk->nthreads - 1) * bulk->partitions];
+    size_t first = partition ? ends[partition - 1] : 0;
+    size_t last = ends[partition];
+    char *key_slab = self->key_slab + bulk->key_bytes[partition];
+    size_t elements = 0, used = 0;
+
+    for (size_t k = first; k < last; ++k) {
+      size_t i = bulk->order[k];
+      size_t key_len = PDICT_BULK_LEN(bulk, i);
+      size_t key_hash = bulk->hashes[i];
+      pdict_node **bucket = &self->elements[key_hash % self->table_max_size];
+      pdict_node **link = pdict_chain_search(bucket, bulk->keys[i], key_len, key_hash);
+
+      /* later duplicates win, as they would with pdict_put */
+      if (link) {
+        (*link)->data = bulk->values[i];
+        continue;
+      }
+
+      pdict_node *element = &self->node_slab[k];
+      key_slab = pdict_bulk_key(bulk, element, i, key_slab);
+      element->hashcode = key_hash;
+      element->data = bulk->values[i];
+      element->next = *bucket;
+      used += *bucket == 0;
+      *bucket = element;
+      elements++;
+    }
+
+    bulk->partition_elements[partition] = elements;
+    bulk->partition_used[partition] = used;
+  }
+
+  return 0;
+}
+
+static void pdict_bulk_insert_open(pdict_bulk *bulk) {
+  pdict *self = bulk->dict;
+  char *key_slab = self->key_slab;
+
+  for (size_t i = 0; i < bulk->n; ++i) {
+    /* hashes are known ahead, so the groups of upcoming keys can be fetched early */
+    if (i + PDICT_BATCH_SIZE < bulk->n) {
+      size_t ahead = bulk->hashes[i + PDICT_BATCH_SIZE];
+      size_t group = pdict_open_first_group(self, pdict_open_mix(ahead));
+      PDICT_PREFETCH(&self->control[group * PDICT_GROUP_WIDTH]);
+      PDICT_PREFETCH(&self->slots[group * PDICT_GROUP_WIDTH]);
+    }
+
+    size_t key_len = PDICT_BULK_LEN(bulk, i);
+    size_t key_hash = bulk->hashes[i];
+    pdict_node *element = pdict_open_find(self, bulk->keys[i], key_len, key_hash);
+
+    if (element) {
+      element->data = bulk->values[i];
+      continue;
+    }
+
+    size_t slot = pdict_open_find_free_slot(self, key_hash);
+    element = &self->slots[slot];
+    self->control[slot] = pdict_open_tag(pdict_open_mix(key_hash));
+    key_slab = pdict_bulk_key(bulk, element, i, key_slab);
+    element->hashcode = key_hash;
+    element->data = bulk->values[i];
+    element->next = 0;
+    self->table_current_size++;
+    self->elements_count++;
+  }
+}
+
+/* Stores key i like pdict_node_set_key, long keys going to the slab */
+static char *pdict_bulk_key(pdict_bulk *bulk, pdict_node *element, size_t index, char *key_slab) {
+  size_t key_len = PDICT_BULK_LEN(bulk, index);
+
+  if (key_len < PDICT_INLINE_KEY_LEN) {
+    element->key = element->inline_key;
+  } else {
+    element->key = key_slab;
+    key_slab += key_len + 1;
+  }
+
+  element->key_len = key_len;
+  memcpy(element->key, bulk->keys[index], key_len);
+  element->key[key_len] = '\0';
+  return key_slab;
+}
+
+/* Groups probed to reach the element in index, its own group included */
+static size_t pdict_open_probe_length(const pdict *self, size_t index) {
+  size_t group_mask = self->table_max_size / PDICT_GROUP_WIDTH - 1;
+  size_t group = pdict_open_first_group(self, pdict_open_mix(self->slots[index].hashcode));
+  size_t length = 1;
+
+  while (group != index / PDICT_GROUP_WIDTH) {
+    group = (group + length) & group_mask;
+    length++;
+  }
+
+  return length;
+}
+
+static void pdict_stats_length(pdict_statistics *stats, size_t length) {
+  stats->length_histogram[length < PDICT_STATS_HISTOGRAM ? length : PDICT_STATS_HISTOGRAM - 1]++;
+
+  if (length > stats->max_length) {
+    stats->max_length = length;
+  }
+}
+
+static void pdict_stats_node(pdict_statistics *stats, const pdict_node *element) {
+  if (element->key != element->inline_key) {
+    stats->key_bytes += element->key_len + 1;
+  }
+}
+
+#ifdef PDICT_ENABLE_STATS
+static uint64_t pdict_stats_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+#endif
 
-  return hash;
+static size_t pdict_hash(const pdict *self, const void *key, size_t key_len) {
+  return (size_t) self->hasher(key, key_len, self->seed);
 }
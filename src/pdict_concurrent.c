@@ -0,0 +1,213 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pdict_concurrent.h"
+#include "putils/phash.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define PDICT_CONCURRENT_CACHE_LINE 64
+
+/* Aligning the lock pads every shard to whole cache lines */
+typedef struct pdict_concurrent_shard pdict_concurrent_shard;
+struct pdict_concurrent_shard {
+  _Alignas(PDICT_CONCURRENT_CACHE_LINE) pthread_rwlock_t lock;
+  pdict *dict;
+};
+
+struct pdict_concurrent {
+  pdict_concurrent_shard *shards;
+  size_t shard_count;
+  unsigned shard_shift;
+  pdict_hasher hasher;
+  uint64_t seed;
+};
+
+static pdict_concurrent_shard *pdict_concurrent_shard_for(const pdict_concurrent *self,
+    uint64_t hash);
+
+pdict_concurrent *pdict_concurrent_create(size_t shards) {
+  return pdict_concurrent_create_with_options(0, shards);
+}
+
+pdict_concurrent *pdict_concurrent_create_with_options(const pdict_options *options,
+                                                       size_t shards) {
+  pdict_concurrent *self = malloc(sizeof(pdict_concurrent));
+  pdict_options shard_options = options ? *options : (pdict_options) {0};
+  size_t count = 1;
+  unsigned bits = 0;
+
+  if (shards == 0) {
+    shards = PDICT_CONCURRENT_DEFAULT_SHARDS;
+  }
+
+  while (count < shards) {
+    count *= 2;
+    bits++;
+  }
+
+  /* every shard hashes like the front, so a key is hashed once (0 is no seed) */
+  if (!shard_options.hasher) {
+    shard_options.hasher = phash_bytes;
+  }
+  if (!shard_options.seed) {
+    shard_options.seed = phash_random_seed() | 1;
+  }
+  shard_options.incremental_rehash = false;
+  shard_options.capacity /= count;
+
+  self->shard_count = count;
+  self->shard_shift = 64 - bits;
+  self->hasher = shard_options.hasher;
+  self->seed = shard_options.seed;
+  self->shards = aligned_alloc(PDICT_CONCURRENT_CACHE_LINE,
+                               count * sizeof(pdict_concurrent_shard));
+
+  for (size_t i = 0; i < count; ++i) {
+    pthread_rwlock_init(&self->shards[i].lock, 0);
+    self->shards[i].dict = pdict_create_with_options(&shard_options);
+  }
+
+  return self;
+}
+
+void pdict_concurrent_put(pdict_concurrent *self, char *key, void *data) {
+  pdict_concurrent_put_n(self, key, strlen(key), data);
+}
+
+void pdict_concurrent_put_n(pdict_concurrent *self, const void *key, size_t key_len,
+                            void *data) {
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_wrlock(&shard->lock);
+  pdict_upsert_hashed(shard->dict, key, key_len, hash, data);
+  pthread_rwlock_unlock(&shard->lock);
+}
+
+void *pdict_concurrent_upsert(pdict_concurrent *self, char *key, void *data) {
+  size_t key_len = strlen(key);
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_wrlock(&shard->lock);
+  void *replaced = pdict_upsert_hashed(shard->dict, key, key_len, hash, data);
+  pthread_rwlock_unlock(&shard->lock);
+  return replaced;
+}
+
+bool pdict_concurrent_put_if_absent(pdict_concurrent *self, char *key, void *data) {
+  size_t key_len = strlen(key);
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_wrlock(&shard->lock);
+  bool stored = pdict_put_if_absent_hashed(shard->dict, key, key_len, hash, data);
+  pthread_rwlock_unlock(&shard->lock);
+  return stored;
+}
+
+void *pdict_concurrent_get_value(pdict_concurrent *self, char *key) {
+  return pdict_concurrent_get_n(self, key, strlen(key));
+}
+
+void *pdict_concurrent_get_n(pdict_concurrent *self, const void *key, size_t key_len) {
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_rdlock(&shard->lock);
+  void *data = pdict_get_hashed(shard->dict, key, key_len, hash);
+  pthread_rwlock_unlock(&shard->lock);
+  return data;
+}
+
+bool pdict_concurrent_has_key(pdict_concurrent *self, char *key) {
+  size_t key_len = strlen(key);
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_rdlock(&shard->lock);
+  bool found = pdict_has_key_hashed(shard->dict, key, key_len, hash);
+  pthread_rwlock_unlock(&shard->lock);
+  return found;
+}
+
+void *pdict_concurrent_remove(pdict_concurrent *self, char *key) {
+  return pdict_concurrent_remove_n(self, key, strlen(key));
+}
+
+void *pdict_concurrent_remove_n(pdict_concurrent *self, const void *key, size_t key_len) {
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  pdict_concurrent_shard *shard = pdict_concurrent_shard_for(self, hash);
+
+  pthread_rwlock_wrlock(&shard->lock);
+  void *data = pdict_remove_hashed(shard->dict, key, key_len, hash);
+  pthread_rwlock_unlock(&shard->lock);
+  return data;
+}
+
+void pdict_concurrent_iterate_with_context(pdict_concurrent *self,
+                                           pdict_context_closure closure, void *ctx) {
+  for (size_t i = 0; i < self->shard_count; ++i) {
+    pthread_rwlock_rdlock(&self->shards[i].lock);
+    pdict_iterate_with_context(self->shards[i].dict, closure, ctx);
+    pthread_rwlock_unlock(&self->shards[i].lock);
+  }
+}
+
+size_t pdict_concurrent_size(pdict_concurrent *self) {
+  size_t size = 0;
+
+  for (size_t i = 0; i < self->shard_count; ++i) {
+    pthread_rwlock_rdlock(&self->shards[i].lock);
+    size += pdict_size(self->shards[i].dict);
+    pthread_rwlock_unlock(&self->shards[i].lock);
+  }
+
+  return size;
+}
+
+size_t pdict_concurrent_shard_count(pdict_concurrent *self) {
+  return self->shard_count;
+}
+
+void pdict_concurrent_destroy(pdict_concurrent *self) {
+  pdict_concurrent_destroy_all(self, 0);
+}
+
+void pdict_concurrent_destroy_all(pdict_concurrent *self, pdict_destroyer destroyer) {
+  for (size_t i = 0; i < self->shard_count; ++i) {
+    pdict_destroy_all(self->shards[i].dict, destroyer);
+    pthread_rwlock_destroy(&self->shards[i].lock);
+  }
+
+  free(self->shards);
+  free(self);
+}
+
+/*
+ * Shards take the high bits of the hash while the tables inside them place
+ * keys by a modulo of it (chained) or a remix of it (open addressing), so keys
+ * of one shard still spread over all of its buckets.
+ */
+static pdict_concurrent_shard *pdict_concurrent_shard_for(const pdict_concurrent *self,
+    uint64_t hash) {
+  if (self->shard_count == 1) {
+    return &self->shards[0];
+  }
+
+  return &self->shards[hash >> self->shard_shift];
+}
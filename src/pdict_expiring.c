@@ -0,0 +1,319 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#define _POSIX_C_SOURCE 200809L
+
+#include "putils/pdict_expiring.h"
+#include <string.h>
+#include <time.h>
+
+/*
+ * Level l takes deadlines less than 64^(l + 1) ticks away from the current
+ * one, in slots 64^l ticks wide. Whenever level l - 1 wraps around, the next
+ * slot of level l is cascaded: its entries are scheduled again and fall into
+ * finer levels. Deadlines past the whole wheel are parked in the farthest
+ * slot of the last level and come back down as it gets cascaded.
+ */
+#define PDICT_EXPIRING_LEVELS 5
+#define PDICT_EXPIRING_SLOT_BITS 6
+#define PDICT_EXPIRING_SLOTS (1u << PDICT_EXPIRING_SLOT_BITS)
+#define PDICT_EXPIRING_SLOT_MASK (PDICT_EXPIRING_SLOTS - 1)
+#define PDICT_EXPIRING_RANGE \
+  ((uint64_t) 1 << (PDICT_EXPIRING_SLOT_BITS * PDICT_EXPIRING_LEVELS))
+
+typedef struct pdict_expiring_entry pdict_expiring_entry;
+struct pdict_expiring_entry {
+  void *data;
+  uint64_t deadline;
+  pdict_expiring_entry *prev;
+  pdict_expiring_entry *next;
+  unsigned level;
+  unsigned slot;
+  /*
+   * Node of entries holding this entry, whose copy of the key is the only
+   * one. Chained nodes never move, so it stays valid until the key is removed.
+   */
+  pdict_node *node;
+};
+
+struct pdict_expiring {
+  pdict *entries;
+  pdict_destroyer destroyer;
+  pdict_expiring_clock clock;
+  void *clock_ctx;
+  /* last tick processed by the wheel */
+  uint64_t current;
+  size_t level_count[PDICT_EXPIRING_LEVELS];
+  pdict_expiring_entry *wheel[PDICT_EXPIRING_LEVELS][PDICT_EXPIRING_SLOTS];
+};
+
+static uint64_t pdict_expiring_monotonic_ms(void *ctx);
+
+static void pdict_expiring_schedule(pdict_expiring *self, pdict_expiring_entry *entry);
+
+static void pdict_expiring_unschedule(pdict_expiring *self, pdict_expiring_entry *entry);
+
+static void pdict_expiring_cascade(pdict_expiring *self, unsigned level);
+
+static uint64_t pdict_expiring_skip(pdict_expiring *self, uint64_t now);
+
+static void pdict_expiring_release(pdict_expiring *self, pdict_expiring_entry *entry);
+
+static pdict_expiring_entry *pdict_expiring_live(pdict_expiring *self, const void *key,
+    size_t key_len);
+
+pdict_expiring *pdict_expiring_create(pdict_destroyer destroyer) {
+  return pdict_expiring_create_with_clock(destroyer, pdict_expiring_monotonic_ms, 0);
+}
+
+pdict_expiring *pdict_expiring_create_with_clock(pdict_destroyer destroyer,
+    pdict_expiring_clock clock, void *clock_ctx) {
+  pdict_expiring *self = calloc(1, sizeof(pdict_expiring));
+
+  self->entries = pdict_create_with_options(&(pdict_options) {.mode = PDICT_CHAINED});
+  self->destroyer = destroyer;
+  self->clock = clock;
+  self->clock_ctx = clock_ctx;
+  self->current = clock(clock_ctx);
+  return self;
+}
+
+void pdict_expiring_put(pdict_expiring *self, char *key, void *data, uint64_t ttl) {
+  pdict_expiring_put_n(self, key, strlen(key), data, ttl);
+}
+
+void pdict_expiring_put_n(pdict_expiring *self, const void *key, size_t key_len, void *data,
+                          uint64_t ttl) {
+  uint64_t now = self->clock(self->clock_ctx);
+  bool inserted;
+  void **value = pdict_get_or_insert_n(self->entries, key, key_len, &inserted);
+  pdict_expiring_entry *entry = *value;
+
+  if (!inserted) {
+    pdict_expiring_unschedule(self, entry);
+    if (self->destroyer && entry->data != data) {
+      self->destroyer(entry->data);
+    }
+  } else {
+    entry = malloc(sizeof(pdict_expiring_entry));
+    entry->node = (pdict_node *) ((char *) value - offsetof(pdict_node, data));
+    *value = entry;
+  }
+
+  entry->data = data;
+  entry->deadline = ttl > UINT64_MAX - now ? UINT64_MAX : now + ttl;
+  pdict_expiring_schedule(self, entry);
+}
+
+void *pdict_expiring_get_value(pdict_expiring *self, char *key) {
+  return pdict_expiring_get_n(self, key, strlen(key));
+}
+
+void *pdict_expiring_get_n(pdict_expiring *self, const void *key, size_t key_len) {
+  pdict_expiring_entry *entry = pdict_expiring_live(self, key, key_len);
+  return entry ? entry->data : 0;
+}
+
+bool pdict_expiring_has_key(pdict_expiring *self, char *key) {
+  return pdict_expiring_live(self, key, strlen(key)) != 0;
+}
+
+void *pdict_expiring_remove(pdict_expiring *self, char *key) {
+  return pdict_expiring_remove_n(self, key, strlen(key));
+}
+
+void *pdict_expiring_remove_n(pdict_expiring *self, const void *key, size_t key_len) {
+  pdict_expiring_entry *entry = pdict_get_n(self->entries, key, key_len);
+  void *data = 0;
+
+  if (!entry) {
+    return 0;
+  }
+
+  if (entry->deadline > self->clock(self->clock_ctx)) {
+    data = entry->data;
+    entry->data = 0;
+  }
+
+  /* an expired entry is reaped right away, as the expiry pass would */
+  pdict_expiring_unschedule(self, entry);
+  pdict_expiring_release(self, entry);
+  return data;
+}
+
+size_t pdict_expiring_expire(pdict_expiring *self) {
+  uint64_t now = self->clock(self->clock_ctx);
+  size_t reaped = 0;
+
+  while (self->current < now) {
+    self->current = pdict_expiring_skip(self, now);
+    if (self->current == now) {
+      break;
+    }
+
+    uint64_t tick = ++self->current;
+
+    for (unsigned level = 1; level < PDICT_EXPIRING_LEVELS; ++level) {
+      if (tick & (((uint64_t) 1 << (PDICT_EXPIRING_SLOT_BITS * level)) - 1)) {
+        break;
+      }
+      pdict_expiring_cascade(self, level);
+    }
+
+    pdict_expiring_entry **slot = &self->wheel[0][tick & PDICT_EXPIRING_SLOT_MASK];
+    pdict_expiring_entry *entry = *slot;
+
+    *slot = 0;
+    while (entry) {
+      pdict_expiring_entry *next = entry->next;
+
+      --self->level_count[0];
+      if (entry->deadline <= tick) {
+        pdict_expiring_release(self, entry);
+        ++reaped;
+      } else {
+        pdict_expiring_schedule(self, entry);
+      }
+      entry = next;
+    }
+  }
+
+  return reaped;
+}
+
+size_t pdict_expiring_size(pdict_expiring *self) {
+  return pdict_size(self->entries);
+}
+
+void pdict_expiring_destroy(pdict_expiring *self) {
+  for (unsigned level = 0; level < PDICT_EXPIRING_LEVELS; ++level) {
+    for (unsigned i = 0; i < PDICT_EXPIRING_SLOTS; ++i) {
+      pdict_expiring_entry *entry = self->wheel[level][i];
+
+      while (entry) {
+        pdict_expiring_entry *next = entry->next;
+
+        if (self->destroyer) {
+          self->destroyer(entry->data);
+        }
+        free(entry);
+        entry = next;
+      }
+    }
+  }
+
+  pdict_destroy(self->entries);
+  free(self);
+}
+
+static uint64_t pdict_expiring_monotonic_ms(void *ctx) {
+  struct timespec ts;
+
+  (void) ctx;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000 + (uint64_t) ts.tv_nsec / 1000000;
+}
+
+static void pdict_expiring_schedule(pdict_expiring *self, pdict_expiring_entry *entry) {
+  /* already due entries go to the next tick, the current one was processed */
+  uint64_t at = entry->deadline > self->current ? entry->deadline : self->current + 1;
+  uint64_t delta = at - self->current;
+  unsigned level = 0;
+
+  if (delta >= PDICT_EXPIRING_RANGE) {
+    at = self->current + PDICT_EXPIRING_RANGE - 1;
+    delta = PDICT_EXPIRING_RANGE - 1;
+  }
+
+  while (delta >> (PDICT_EXPIRING_SLOT_BITS * (level + 1))) {
+    ++level;
+  }
+
+  unsigned index = (at >> (PDICT_EXPIRING_SLOT_BITS * level)) & PDICT_EXPIRING_SLOT_MASK;
+  pdict_expiring_entry **slot = &self->wheel[level][index];
+
+  entry->level = level;
+  entry->slot = index;
+  entry->prev = 0;
+  entry->next = *slot;
+  if (*slot) {
+    (*slot)->prev = entry;
+  }
+  *slot = entry;
+  ++self->level_count[level];
+}
+
+static void pdict_expiring_unschedule(pdict_expiring *self, pdict_expiring_entry *entry) {
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    self->wheel[entry->level][entry->slot] = entry->next;
+  }
+
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  }
+  --self->level_count[entry->level];
+}
+
+static void pdict_expiring_cascade(pdict_expiring *self, unsigned level) {
+  unsigned index =
+    (self->current >> (PDICT_EXPIRING_SLOT_BITS * level)) & PDICT_EXPIRING_SLOT_MASK;
+  pdict_expiring_entry *entry = self->wheel[level][index];
+
+  self->wheel[level][index] = 0;
+  while (entry) {
+    pdict_expiring_entry *next = entry->next;
+
+    --self->level_count[level];
+    pdict_expiring_schedule(self, entry);
+    entry = next;
+  }
+}
+
+/*
+ * While levels 0 to l are empty nothing can happen until level l + 1 is
+ * cascaded, so the wheel can jump right before that tick.
+ */
+static uint64_t pdict_expiring_skip(pdict_expiring *self, uint64_t now) {
+  uint64_t target = self->current;
+
+  for (unsigned level = 0; level < PDICT_EXPIRING_LEVELS && !self->level_count[level]; ++level) {
+    if (level + 1 == PDICT_EXPIRING_LEVELS) {
+      return now;
+    }
+    target = self->current | (((uint64_t) 1 << (PDICT_EXPIRING_SLOT_BITS * (level + 1))) - 1);
+  }
+
+  return target < now ? target : now;
+}
+
+static void pdict_expiring_release(pdict_expiring *self, pdict_expiring_entry *entry) {
+  pdict_remove_n(self->entries, entry->node->key, entry->node->key_len);
+  if (self->destroyer && entry->data) {
+    self->destroyer(entry->data);
+  }
+  free(entry);
+}
+
+static pdict_expiring_entry *pdict_expiring_live(pdict_expiring *self, const void *key,
+    size_t key_len) {
+  pdict_expiring_entry *entry = pdict_get_n(self->entries, key, key_len);
+
+  if (entry && entry->deadline <= self->clock(self->clock_ctx)) {
+    return 0;
+  }
+  return entry;
+}
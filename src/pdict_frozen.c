@@ -0,0 +1,600 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pdict_frozen.h"
+#include "putils/phash.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PDICT_FROZEN_USE_MMAP 1
+#endif
+
+/*
+ * Hash and displace: keys are first spread over count / PDICT_FROZEN_BUCKET_LOAD
+ * buckets. Starting with the biggest bucket, each one searches for the first
+ * displacement that sends all of its keys to free slots. Single key buckets go
+ * last and just take the remaining free slots directly, flagged with
+ * PDICT_FROZEN_DIRECT, which is what keeps the table minimal (one slot per key)
+ * without long searches at the end.
+ */
+#define PDICT_FROZEN_BUCKET_LOAD 2
+#define PDICT_FROZEN_DIRECT UINT32_C(0x80000000)
+#define PDICT_FROZEN_MAX_DISPLACEMENT (UINT32_C(1) << 20)
+#define PDICT_FROZEN_MAX_ATTEMPTS 16
+/* entries store key lengths in 32 bits */
+#define PDICT_FROZEN_MAX_KEY_LEN UINT32_MAX
+
+#define PDICT_FROZEN_MAGIC "PDFROZEN"
+#define PDICT_FROZEN_VERSION 1
+#define PDICT_FROZEN_BYTE_ORDER UINT32_C(0x01020304)
+#define PDICT_FROZEN_CHECKSUM_SEED UINT64_C(0x70646963742d6673)
+
+/*
+ * The whole dictionary is one block starting with this header. Sections are
+ * referenced by offsets from the start of the block, so it does not hold a
+ * single pointer to itself and can be written to disk and mapped back as is.
+ *
+ * checksum covers everything that follows it, header fields included.
+ */
+typedef struct pdict_frozen_header pdict_frozen_header;
+struct pdict_frozen_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t checksum;
+  uint64_t seed;
+  uint64_t count;
+  uint64_t bucket_count;
+  uint64_t displacements_offset;
+  uint64_t entries_offset;
+  uint64_t keys_offset;
+  uint64_t values_offset;
+  /* 0 when entries hold the value pointers themselves */
+  uint64_t value_size;
+  uint64_t size;
+};
+
+typedef struct pdict_frozen_entry pdict_frozen_entry;
+struct pdict_frozen_entry {
+  /* value pointer, or offset of the value bytes when the image stores them */
+  uint64_t value;
+  uint64_t key_offset;
+  uint32_t key_len;
+  /* high half of the hash, rejects most misses before touching the key */
+  uint32_t hash_check;
+};
+
+struct pdict_frozen {
+  unsigned char *image;
+  /* non zero when image is a file mapping rather than a heap block */
+  size_t mapped_size;
+  const pdict_frozen_header *header;
+  const uint32_t *displacements;
+  const pdict_frozen_entry *entries;
+  const char *keys;
+  size_t keys_size;
+};
+
+typedef struct pdict_frozen_builder pdict_frozen_builder;
+struct pdict_frozen_builder {
+  size_t count;
+  size_t value_size;
+  size_t bucket_count;
+  pdict_entry *entries;
+  uint64_t *hashes;
+  size_t *order;
+  size_t *bucket_starts;
+  size_t *buckets_by_size;
+  uint32_t *displacements;
+  size_t *slots;
+  uint8_t *taken;
+};
+
+static pdict_frozen *pdict_frozen_create(pdict *self, size_t value_size);
+
+static inline size_t pdict_frozen_align(size_t size);
+
+static inline size_t pdict_frozen_bucket(uint64_t hash, size_t bucket_count);
+
+static inline size_t pdict_frozen_slot(uint64_t hash, uint32_t displacement, size_t count);
+
+static bool pdict_frozen_place(pdict_frozen_builder *builder, uint64_t seed);
+
+static bool pdict_frozen_place_bucket(pdict_frozen_builder *builder, size_t bucket);
+
+static pdict_frozen *pdict_frozen_build_image(const pdict_frozen_builder *builder,
+                                              uint64_t seed);
+
+static const pdict_frozen_entry *pdict_frozen_find(const pdict_frozen *self,
+                                                   const void *key, size_t key_len);
+
+static void *pdict_frozen_value(const pdict_frozen *self, const pdict_frozen_entry *entry);
+
+static uint64_t pdict_frozen_checksum(const unsigned char *image, size_t size);
+
+static bool pdict_frozen_attach(pdict_frozen *self, unsigned char *image, size_t size);
+
+pdict_frozen *pdict_freeze(pdict *self) {
+  return pdict_frozen_create(self, 0);
+}
+
+bool pdict_save(pdict *self, const char *path, size_t value_size) {
+  pdict_frozen *frozen = pdict_frozen_create(self, value_size);
+
+  if (!frozen) {
+    return false;
+  }
+
+  /*
+   * Write a sibling file and rename it over path, so processes that have the
+   * previous snapshot mapped keep reading a complete file.
+   */
+  size_t path_len = strlen(path);
+  char *temporary = malloc(path_len + sizeof(".tmp"));
+  memcpy(temporary, path, path_len);
+  memcpy(temporary + path_len, ".tmp", sizeof(".tmp"));
+
+  size_t size = (size_t) frozen->header->size;
+  FILE *file = fopen(temporary, "wb");
+  bool saved = file != 0 && fwrite(frozen->image, 1, size, file) == size;
+
+  if (file && fclose(file) != 0) {
+    saved = false;
+  }
+
+  if (saved) {
+    saved = rename(temporary, path) == 0;
+  }
+
+  if (!saved) {
+    remove(temporary);
+  }
+
+  free(temporary);
+  pdict_frozen_destroy(frozen);
+  return saved;
+}
+
+pdict_frozen *pdict_open_mmap(const char *path) {
+  pdict_frozen *self = calloc(1, sizeof(pdict_frozen));
+
+#ifdef PDICT_FROZEN_USE_MMAP
+  int fd = open(path, O_RDONLY);
+  struct stat file_stat;
+
+  if (fd < 0) {
+    free(self);
+    return 0;
+  }
+
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+    close(fd);
+    free(self);
+    return 0;
+  }
+
+  size_t size = (size_t) file_stat.st_size;
+  void *image = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (image == MAP_FAILED) {
+    free(self);
+    return 0;
+  }
+
+  self->mapped_size = size;
+
+  if (!pdict_frozen_attach(self, image, size)) {
+    munmap(image, size);
+    free(self);
+    return 0;
+  }
+#else
+  /* no mmap: read the image into memory, lookups work the same way */
+  FILE *file = fopen(path, "rb");
+  long size = -1;
+
+  if (file && fseek(file, 0, SEEK_END) == 0) {
+    size = ftell(file);
+  }
+
+  unsigned char *image = size > 0 ? malloc((size_t) size) : 0;
+
+  if (!image || fseek(file, 0, SEEK_SET) != 0 ||
+      fread(image, 1, (size_t) size, file) != (size_t) size ||
+      !pdict_frozen_attach(self, image, (size_t) size)) {
+    free(image);
+    free(self);
+    self = 0;
+  }
+
+  if (file) {
+    fclose(file);
+  }
+#endif
+
+  return self;
+}
+
+bool pdict_frozen_verify(const pdict_frozen *self) {
+  return self->header->checksum ==
+         pdict_frozen_checksum(self->image, (size_t) self->header->size);
+}
+
+static pdict_frozen *pdict_frozen_create(pdict *self, size_t value_size) {
+  pdict_frozen_builder builder = {
+    .count = pdict_size(self),
+    .value_size = value_size
+  };
+  builder.bucket_count = builder.count / PDICT_FROZEN_BUCKET_LOAD + 1;
+  builder.entries = malloc((builder.count + 1) * sizeof(pdict_entry));
+  builder.hashes = malloc((builder.count + 1) * sizeof(uint64_t));
+  builder.order = malloc((builder.count + 1) * sizeof(size_t));
+  builder.bucket_starts = malloc((builder.bucket_count + 1) * sizeof(size_t));
+  builder.buckets_by_size = malloc(builder.bucket_count * sizeof(size_t));
+  builder.displacements = malloc(builder.bucket_count * sizeof(uint32_t));
+  builder.slots = malloc((builder.count + 1) * sizeof(size_t));
+  builder.taken = malloc(builder.count + 1);
+
+  pdict_iter iter;
+  size_t i = 0;
+
+  pdict_iter_init(&iter, self);
+
+  bool fits = true;
+
+  while (i < builder.count && pdict_iter_next(&iter, &builder.entries[i])) {
+    fits = fits && builder.entries[i].key_len <= PDICT_FROZEN_MAX_KEY_LEN;
+    i++;
+  }
+
+  pdict_frozen *frozen = 0;
+
+  for (int attempt = 0; fits && attempt < PDICT_FROZEN_MAX_ATTEMPTS && !frozen; ++attempt) {
+    uint64_t seed = phash_random_seed();
+
+    if (pdict_frozen_place(&builder, seed)) {
+      frozen = pdict_frozen_build_image(&builder, seed);
+    }
+  }
+
+  free(builder.entries);
+  free(builder.hashes);
+  free(builder.order);
+  free(builder.bucket_starts);
+  free(builder.buckets_by_size);
+  free(builder.displacements);
+  free(builder.slots);
+  free(builder.taken);
+  return frozen;
+}
+
+void *pdict_frozen_get(const pdict_frozen *self, const char *key) {
+  return pdict_frozen_get_n(self, key, strlen(key));
+}
+
+void *pdict_frozen_get_n(const pdict_frozen *self, const void *key, size_t key_len) {
+  const pdict_frozen_entry *entry = pdict_frozen_find(self, key, key_len);
+  return entry ? pdict_frozen_value(self, entry) : 0;
+}
+
+bool pdict_frozen_has_key(const pdict_frozen *self, const char *key) {
+  return pdict_frozen_find(self, key, strlen(key)) != 0;
+}
+
+size_t pdict_frozen_size(const pdict_frozen *self) {
+  return (size_t) self->header->count;
+}
+
+void pdict_frozen_destroy(pdict_frozen *self) {
+  if (!self) {
+    return;
+  }
+
+#ifdef PDICT_FROZEN_USE_MMAP
+  if (self->mapped_size) {
+    munmap(self->image, self->mapped_size);
+  } else {
+    free(self->image);
+  }
+#else
+  free(self->image);
+#endif
+
+  free(self);
+}
+
+static const pdict_frozen_entry *pdict_frozen_find(const pdict_frozen *self,
+                                                   const void *key, size_t key_len) {
+  size_t count = (size_t) self->header->count;
+
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t hash = phash_bytes(key, key_len, self->header->seed);
+  uint32_t displacement =
+    self->displacements[pdict_frozen_bucket(hash, (size_t) self->header->bucket_count)];
+  size_t slot = displacement & PDICT_FROZEN_DIRECT
+                ? displacement & ~PDICT_FROZEN_DIRECT
+                : pdict_frozen_slot(hash, displacement, count);
+  /* bounds checks only matter for damaged files, they never fail otherwise */
+  if (slot >= count) {
+    return 0;
+  }
+
+  const pdict_frozen_entry *entry = &self->entries[slot];
+
+  if (entry->key_offset + key_len > self->keys_size) {
+    return 0;
+  }
+
+  if (entry->hash_check != (uint32_t)(hash >> 32) || entry->key_len != key_len ||
+      memcmp(self->keys + entry->key_offset, key, key_len) != 0) {
+    return 0;
+  }
+
+  return entry;
+}
+
+static void *pdict_frozen_value(const pdict_frozen *self, const pdict_frozen_entry *entry) {
+  if (self->header->value_size == 0) {
+    return (void *)(uintptr_t) entry->value;
+  }
+
+  /* values stored in the image are read only, mappings are not writable */
+  return (void *)(uintptr_t)(self->image + entry->value);
+}
+
+static uint64_t pdict_frozen_checksum(const unsigned char *image, size_t size) {
+  size_t covered = offsetof(pdict_frozen_header, checksum) + sizeof(uint64_t);
+  return phash_bytes(image + covered, size - covered, PDICT_FROZEN_CHECKSUM_SEED);
+}
+
+/*
+ * Points self at the sections of image after checking that the header
+ * describes an image of this exact size. The checksum is left to
+ * pdict_frozen_verify since it has to read the whole file.
+ */
+static bool pdict_frozen_attach(pdict_frozen *self, unsigned char *image, size_t size) {
+  const pdict_frozen_header *header = (const pdict_frozen_header *) image;
+
+  if (size < sizeof(pdict_frozen_header) ||
+      memcmp(header->magic, PDICT_FROZEN_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != PDICT_FROZEN_VERSION ||
+      header->byte_order != PDICT_FROZEN_BYTE_ORDER || header->size != size ||
+      header->bucket_count == 0) {
+    return false;
+  }
+
+  uint64_t value_stride = pdict_frozen_align((size_t) header->value_size);
+
+  if (header->displacements_offset + header->bucket_count * sizeof(uint32_t) >
+      header->entries_offset ||
+      header->entries_offset + header->count * sizeof(pdict_frozen_entry) >
+      header->keys_offset ||
+      header->keys_offset > header->values_offset ||
+      header->values_offset + header->count * value_stride > size ||
+      header->displacements_offset % 8 || header->entries_offset % 8) {
+    return false;
+  }
+
+  self->image = image;
+  self->header = header;
+  self->displacements = (const uint32_t *)(image + header->displacements_offset);
+  self->entries = (const pdict_frozen_entry *)(image + header->entries_offset);
+  self->keys = (const char *)(image + header->keys_offset);
+  self->keys_size = (size_t)(header->values_offset - header->keys_offset);
+  return true;
+}
+
+static inline size_t pdict_frozen_align(size_t size) {
+  return (size + 7) & ~(size_t) 7;
+}
+
+static inline size_t pdict_frozen_bucket(uint64_t hash, size_t bucket_count) {
+  return (size_t)(hash % bucket_count);
+}
+
+static inline size_t pdict_frozen_slot(uint64_t hash, uint32_t displacement, size_t count) {
+  uint64_t h = hash ^ ((uint64_t) displacement * UINT64_C(0x9e3779b97f4a7c15));
+  h ^= h >> 33;
+  h *= UINT64_C(0xff51afd7ed558ccd);
+  h ^= h >> 33;
+  h *= UINT64_C(0xc4ceb9fe1a85ec53);
+  h ^= h >> 33;
+  return (size_t)(h % count);
+}
+
+/* Finds a displacement for every bucket, filling builder->slots */
+static bool pdict_frozen_place(pdict_frozen_builder *builder, uint64_t seed) {
+  size_t count = builder->count;
+  size_t bucket_count = builder->bucket_count;
+  size_t max_bucket_size = 0;
+
+  memset(builder->bucket_starts, 0, (bucket_count + 1) * sizeof(size_t));
+  memset(builder->displacements, 0, bucket_count * sizeof(uint32_t));
+  memset(builder->taken, 0, count);
+
+  /* counting sort of the keys by bucket */
+  for (size_t i = 0; i < count; ++i) {
+    const pdict_entry *entry = &builder->entries[i];
+    builder->hashes[i] = phash_bytes(entry->key, entry->key_len, seed);
+    builder->bucket_starts[pdict_frozen_bucket(builder->hashes[i], bucket_count) + 1]++;
+  }
+
+  for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+    size_t size = builder->bucket_starts[bucket + 1];
+
+    if (size > max_bucket_size) {
+      max_bucket_size = size;
+    }
+
+    builder->bucket_starts[bucket + 1] += builder->bucket_starts[bucket];
+  }
+
+  /* slots are not assigned yet, borrow them as the per bucket fill cursors */
+  size_t *fill = builder->slots;
+  memcpy(fill, builder->bucket_starts, bucket_count * sizeof(size_t));
+
+  for (size_t i = 0; i < count; ++i) {
+    builder->order[fill[pdict_frozen_bucket(builder->hashes[i], bucket_count)]++] = i;
+  }
+
+  /* biggest buckets first, they are the hardest to place */
+  size_t sorted = 0;
+
+  for (size_t size = max_bucket_size; size > 0; --size) {
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+      if (builder->bucket_starts[bucket + 1] - builder->bucket_starts[bucket] == size) {
+        builder->buckets_by_size[sorted++] = bucket;
+      }
+    }
+  }
+
+  size_t next_free = 0;
+
+  for (size_t i = 0; i < sorted; ++i) {
+    size_t bucket = builder->buckets_by_size[i];
+    size_t start = builder->bucket_starts[bucket];
+
+    if (builder->bucket_starts[bucket + 1] - start > 1) {
+      if (!pdict_frozen_place_bucket(builder, bucket)) {
+        return false;
+      }
+      continue;
+    }
+
+    while (builder->taken[next_free]) {
+      next_free++;
+    }
+
+    builder->taken[next_free] = 1;
+    builder->slots[builder->order[start]] = next_free;
+    builder->displacements[bucket] = PDICT_FROZEN_DIRECT | (uint32_t) next_free;
+  }
+
+  return true;
+}
+
+static bool pdict_frozen_place_bucket(pdict_frozen_builder *builder, size_t bucket) {
+  size_t start = builder->bucket_starts[bucket];
+  size_t end = builder->bucket_starts[bucket + 1];
+
+  for (uint32_t displacement = 0; displacement < PDICT_FROZEN_MAX_DISPLACEMENT;
+       ++displacement) {
+    size_t placed = start;
+
+    for (; placed < end; ++placed) {
+      size_t key = builder->order[placed];
+      size_t slot = pdict_frozen_slot(builder->hashes[key], displacement, builder->count);
+
+      if (builder->taken[slot]) {
+        break;
+      }
+
+      builder->taken[slot] = 1;
+      builder->slots[key] = slot;
+    }
+
+    if (placed == end) {
+      builder->displacements[bucket] = displacement;
+      return true;
+    }
+
+    /* undo the partial placement before trying the next displacement */
+    while (placed-- > start) {
+      builder->taken[builder->slots[builder->order[placed]]] = 0;
+    }
+  }
+
+  return false;
+}
+
+static pdict_frozen *pdict_frozen_build_image(const pdict_frozen_builder *builder,
+                                              uint64_t seed) {
+  size_t count = builder->count;
+  size_t keys_size = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    keys_size += builder->entries[i].key_len + 1;
+  }
+
+  size_t displacements_offset = pdict_frozen_align(sizeof(pdict_frozen_header));
+  size_t entries_offset = pdict_frozen_align(displacements_offset +
+                                             builder->bucket_count * sizeof(uint32_t));
+  size_t keys_offset = entries_offset + count * sizeof(pdict_frozen_entry);
+  size_t values_offset = pdict_frozen_align(keys_offset + keys_size);
+  size_t value_stride = pdict_frozen_align(builder->value_size);
+  size_t size = values_offset + count * value_stride;
+
+  unsigned char *image = calloc(1, size);
+  pdict_frozen_header *header = (pdict_frozen_header *) image;
+  memcpy(header->magic, PDICT_FROZEN_MAGIC, sizeof(header->magic));
+  header->version = PDICT_FROZEN_VERSION;
+  header->byte_order = PDICT_FROZEN_BYTE_ORDER;
+  header->seed = seed;
+  header->count = count;
+  header->bucket_count = builder->bucket_count;
+  header->displacements_offset = displacements_offset;
+  header->entries_offset = entries_offset;
+  header->keys_offset = keys_offset;
+  header->values_offset = values_offset;
+  header->value_size = builder->value_size;
+  header->size = size;
+
+  memcpy(image + displacements_offset, builder->displacements,
+         builder->bucket_count * sizeof(uint32_t));
+
+  pdict_frozen_entry *entries = (pdict_frozen_entry *)(image + entries_offset);
+  char *keys = (char *)(image + keys_offset);
+  size_t key_offset = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    const pdict_entry *source = &builder->entries[i];
+    size_t slot = builder->slots[i];
+    pdict_frozen_entry *entry = &entries[slot];
+
+    if (builder->value_size == 0) {
+      entry->value = (uint64_t)(uintptr_t) source->value;
+    } else {
+      entry->value = values_offset + slot * value_stride;
+
+      /* a null value is stored as zeroed bytes */
+      if (source->value) {
+        memcpy(image + entry->value, source->value, builder->value_size);
+      }
+    }
+
+    entry->key_offset = key_offset;
+    entry->key_len = (uint32_t) source->key_len;
+    entry->hash_check = (uint32_t)(builder->hashes[i] >> 32);
+    memcpy(keys + key_offset, source->key, source->key_len);
+    key_offset += source->key_len + 1;
+  }
+
+  header->checksum = pdict_frozen_checksum(image, size);
+
+  pdict_frozen *self = calloc(1, sizeof(pdict_frozen));
+  pdict_frozen_attach(self, image, size);
+  return self;
+}
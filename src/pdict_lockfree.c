@@ -0,0 +1,283 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pdict_lockfree.h"
+#include "putils/phash.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct pdict_lockfree_node pdict_lockfree_node;
+struct pdict_lockfree_node {
+  _Atomic(pdict_lockfree_node *) next;
+  _Atomic(void *) data;
+  size_t hash;
+  size_t key_len;
+  char key[];
+};
+
+typedef struct pdict_lockfree_table pdict_lockfree_table;
+struct pdict_lockfree_table {
+  size_t size;
+  _Atomic(pdict_lockfree_node *) buckets[];
+};
+
+struct pdict_lockfree {
+  _Atomic(pdict_lockfree_table *) table;
+  pthread_mutex_t lock;
+  pepoch *epoch;
+  uint64_t seed;
+  _Atomic size_t elements_count;
+};
+
+static pdict_lockfree_table *pdict_lockfree_table_create(size_t size);
+
+static void pdict_lockfree_table_destroy(void *table);
+
+static pdict_lockfree_node *pdict_lockfree_node_create(const void *key, size_t key_len,
+    size_t hash, void *data);
+
+static void pdict_lockfree_resize(pdict_lockfree *self, pdict_lockfree_table *table);
+
+static inline bool pdict_lockfree_matches(const pdict_lockfree_node *node, const void *key,
+    size_t key_len, size_t hash);
+
+pdict_lockfree *pdict_lockfree_create(void) {
+  return pdict_lockfree_create_with_capacity(PDICT_INITIAL_SIZE);
+}
+
+pdict_lockfree *pdict_lockfree_create_with_capacity(size_t capacity) {
+  pdict_lockfree *self = malloc(sizeof(pdict_lockfree));
+
+  atomic_init(&self->table, pdict_lockfree_table_create(capacity ? capacity : 1));
+  atomic_init(&self->elements_count, 0);
+  pthread_mutex_init(&self->lock, 0);
+  self->epoch = pepoch_create();
+  self->seed = phash_random_seed();
+  return self;
+}
+
+pepoch_thread *pdict_lockfree_register(pdict_lockfree *self) {
+  return pepoch_register(self->epoch);
+}
+
+void pdict_lockfree_unregister(pdict_lockfree *self, pepoch_thread *reader) {
+  pepoch_unregister(self->epoch, reader);
+}
+
+void *pdict_lockfree_get_value(pdict_lockfree *self, pepoch_thread *reader, char *key) {
+  return pdict_lockfree_get_n(self, reader, key, strlen(key));
+}
+
+void *pdict_lockfree_get_n(pdict_lockfree *self, pepoch_thread *reader, const void *key,
+                           size_t key_len) {
+  size_t hash = (size_t) phash_bytes(key, key_len, self->seed);
+  void *data = 0;
+
+  pepoch_enter(self->epoch, reader);
+
+  pdict_lockfree_table *table = atomic_load_explicit(&self->table, memory_order_acquire);
+  pdict_lockfree_node *node =
+    atomic_load_explicit(&table->buckets[hash % table->size], memory_order_acquire);
+
+  while (node) {
+    if (pdict_lockfree_matches(node, key, key_len, hash)) {
+      data = atomic_load_explicit(&node->data, memory_order_acquire);
+      break;
+    }
+
+    node = atomic_load_explicit(&node->next, memory_order_acquire);
+  }
+
+  pepoch_exit(reader);
+  return data;
+}
+
+void *pdict_lockfree_put(pdict_lockfree *self, char *key, void *data) {
+  return pdict_lockfree_put_n(self, key, strlen(key), data);
+}
+
+/*
+ * Writers hold the lock, so they can read the structure with relaxed loads.
+ * A new node is fully written before the release store that links it.
+ */
+void *pdict_lockfree_put_n(pdict_lockfree *self, const void *key, size_t key_len, void *data) {
+  size_t hash = (size_t) phash_bytes(key, key_len, self->seed);
+
+  pthread_mutex_lock(&self->lock);
+
+  pdict_lockfree_table *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  _Atomic(pdict_lockfree_node *) *bucket = &table->buckets[hash % table->size];
+  pdict_lockfree_node *head = atomic_load_explicit(bucket, memory_order_relaxed);
+
+  for (pdict_lockfree_node *node = head; node;
+       node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+    if (pdict_lockfree_matches(node, key, key_len, hash)) {
+      void *replaced = atomic_exchange_explicit(&node->data, data, memory_order_acq_rel);
+      pthread_mutex_unlock(&self->lock);
+      return replaced;
+    }
+  }
+
+  pdict_lockfree_node *node = pdict_lockfree_node_create(key, key_len, hash, data);
+  atomic_store_explicit(&node->next, head, memory_order_relaxed);
+  atomic_store_explicit(bucket, node, memory_order_release);
+
+  size_t count = atomic_fetch_add_explicit(&self->elements_count, 1, memory_order_relaxed) + 1;
+
+  if (count > table->size) {
+    pdict_lockfree_resize(self, table);
+  }
+
+  pthread_mutex_unlock(&self->lock);
+  return 0;
+}
+
+void *pdict_lockfree_remove(pdict_lockfree *self, char *key) {
+  return pdict_lockfree_remove_n(self, key, strlen(key));
+}
+
+void *pdict_lockfree_remove_n(pdict_lockfree *self, const void *key, size_t key_len) {
+  size_t hash = (size_t) phash_bytes(key, key_len, self->seed);
+  void *data = 0;
+
+  pthread_mutex_lock(&self->lock);
+
+  pdict_lockfree_table *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+  _Atomic(pdict_lockfree_node *) *link = &table->buckets[hash % table->size];
+  pdict_lockfree_node *node;
+
+  while ((node = atomic_load_explicit(link, memory_order_relaxed)) != 0) {
+    if (pdict_lockfree_matches(node, key, key_len, hash)) {
+      /* readers standing on node still see its next pointer until it is freed */
+      atomic_store_explicit(link, atomic_load_explicit(&node->next, memory_order_relaxed),
+                            memory_order_release);
+      data = atomic_load_explicit(&node->data, memory_order_relaxed);
+      atomic_fetch_sub_explicit(&self->elements_count, 1, memory_order_relaxed);
+      pepoch_retire(self->epoch, node, free);
+      break;
+    }
+
+    link = &node->next;
+  }
+
+  pthread_mutex_unlock(&self->lock);
+  return data;
+}
+
+size_t pdict_lockfree_size(pdict_lockfree *self) {
+  return atomic_load_explicit(&self->elements_count, memory_order_relaxed);
+}
+
+pepoch *pdict_lockfree_epoch(pdict_lockfree *self) {
+  return self->epoch;
+}
+
+void pdict_lockfree_destroy(pdict_lockfree *self) {
+  pdict_lockfree_destroy_all(self, 0);
+}
+
+void pdict_lockfree_destroy_all(pdict_lockfree *self, pdict_destroyer destroyer) {
+  pdict_lockfree_table *table = atomic_load_explicit(&self->table, memory_order_relaxed);
+
+  if (destroyer) {
+    for (size_t i = 0; i < table->size; ++i) {
+      pdict_lockfree_node *node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+
+      for (; node; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+        destroyer(atomic_load_explicit(&node->data, memory_order_relaxed));
+      }
+    }
+  }
+
+  pdict_lockfree_table_destroy(table);
+  pepoch_destroy(self->epoch);
+  pthread_mutex_destroy(&self->lock);
+  free(self);
+}
+
+static pdict_lockfree_table *pdict_lockfree_table_create(size_t size) {
+  pdict_lockfree_table *table =
+    malloc(sizeof(pdict_lockfree_table) + size * sizeof(_Atomic(pdict_lockfree_node *)));
+  table->size = size;
+
+  for (size_t i = 0; i < size; ++i) {
+    atomic_init(&table->buckets[i], 0);
+  }
+
+  return table;
+}
+
+/* Frees a table along with the nodes still linked from it */
+static void pdict_lockfree_table_destroy(void *pointer) {
+  pdict_lockfree_table *table = pointer;
+
+  for (size_t i = 0; i < table->size; ++i) {
+    pdict_lockfree_node *node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+
+    while (node) {
+      pdict_lockfree_node *next = atomic_load_explicit(&node->next, memory_order_relaxed);
+      free(node);
+      node = next;
+    }
+  }
+
+  free(table);
+}
+
+static pdict_lockfree_node *pdict_lockfree_node_create(const void *key, size_t key_len,
+    size_t hash, void *data) {
+  pdict_lockfree_node *node = malloc(sizeof(pdict_lockfree_node) + key_len + 1);
+
+  atomic_init(&node->next, 0);
+  atomic_init(&node->data, data);
+  node->hash = hash;
+  node->key_len = key_len;
+  memcpy(node->key, key, key_len);
+  node->key[key_len] = '\0';
+  return node;
+}
+
+/*
+ * Relinking nodes into the new table would send readers still walking the
+ * old chains into the wrong bucket, so the new table gets copies and the old
+ * one, nodes included, is retired as a whole once the copy is published.
+ */
+static void pdict_lockfree_resize(pdict_lockfree *self, pdict_lockfree_table *table) {
+  pdict_lockfree_table *grown = pdict_lockfree_table_create(table->size * 2);
+
+  for (size_t i = 0; i < table->size; ++i) {
+    pdict_lockfree_node *node = atomic_load_explicit(&table->buckets[i], memory_order_relaxed);
+
+    for (; node; node = atomic_load_explicit(&node->next, memory_order_relaxed)) {
+      void *data = atomic_load_explicit(&node->data, memory_order_relaxed);
+      pdict_lockfree_node *copy = pdict_lockfree_node_create(node->key, node->key_len,
+                                  node->hash, data);
+      _Atomic(pdict_lockfree_node *) *bucket = &grown->buckets[node->hash % grown->size];
+
+      atomic_init(&copy->next, atomic_load_explicit(bucket, memory_order_relaxed));
+      atomic_init(bucket, copy);
+    }
+  }
+
+  atomic_store_explicit(&self->table, grown, memory_order_release);
+  pepoch_retire(self->epoch, table, pdict_lockfree_table_destroy);
+}
+
+static inline bool pdict_lockfree_matches(const pdict_lockfree_node *node, const void *key,
+    size_t key_len, size_t hash) {
+  return node->hash == hash && node->key_len == key_len && memcmp(node->key, key, key_len) == 0;
+}
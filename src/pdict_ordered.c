@@ -0,0 +1,417 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pdict_ordered.h"
+#include "putils/phash.h"
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * The index has a power of two amount of slots, each one either
+ * PDICT_ORDERED_EMPTY, PDICT_ORDERED_DUMMY (a removed key, probes go on past
+ * it) or the position of an entry. Only 2/3 of the slots are ever used so
+ * probes stay short, which is also how many entries get allocated.
+ */
+#define PDICT_ORDERED_MIN_SLOTS 8
+#define PDICT_ORDERED_EMPTY (-1)
+#define PDICT_ORDERED_DUMMY (-2)
+#define PDICT_ORDERED_PERTURB_SHIFT 5
+
+/* key_offset of removed entries, they are skipped until the next resize */
+#define PDICT_ORDERED_REMOVED SIZE_MAX
+
+typedef struct pdict_ordered_entry pdict_ordered_entry;
+struct pdict_ordered_entry {
+  size_t hash;
+  /* position of the NUL terminated key in the key arena */
+  size_t key_offset;
+  size_t key_len;
+  void *data;
+};
+
+struct pdict_ordered {
+  uint64_t seed;
+  void *indices;
+  size_t index_slots;
+  /* bytes per index slot: 1, 2, 4 or 8 */
+  size_t index_width;
+  pdict_ordered_entry *entries;
+  size_t entries_capacity;
+  /* entries appended so far, removed ones included */
+  size_t entries_used;
+  size_t elements_count;
+  /*
+   * Every key lives back to back in this arena instead of in an allocation
+   * of its own. Keys of removed entries are only dropped when a resize
+   * compacts the entries.
+   */
+  char *keys;
+  size_t keys_used;
+  size_t keys_capacity;
+};
+
+#define PDICT_ORDERED_KEY(self, entry) ((self)->keys + (entry)->key_offset)
+
+static void pdict_ordered_allocate(pdict_ordered *self, size_t index_slots);
+
+static void pdict_ordered_resize(pdict_ordered *self, size_t capacity);
+
+static size_t pdict_ordered_slots_for(size_t capacity);
+
+static inline ptrdiff_t pdict_ordered_index_get(const pdict_ordered *self, size_t slot);
+
+static inline void pdict_ordered_index_set(pdict_ordered *self, size_t slot, ptrdiff_t value);
+
+static size_t pdict_ordered_lookup(const pdict_ordered *self, const void *key, size_t key_len,
+                                   size_t hash, ptrdiff_t *position);
+
+static size_t pdict_ordered_free_slot(const pdict_ordered *self, size_t hash);
+
+static size_t pdict_ordered_store_key(pdict_ordered *self, const void *key, size_t key_len);
+
+pdict_ordered *pdict_ordered_create(void) {
+  return pdict_ordered_create_with_capacity(0);
+}
+
+pdict_ordered *pdict_ordered_create_with_capacity(size_t capacity) {
+  pdict_ordered *self = calloc(1, sizeof(pdict_ordered));
+  self->seed = phash_random_seed();
+  pdict_ordered_allocate(self, pdict_ordered_slots_for(capacity));
+  return self;
+}
+
+void pdict_ordered_put(pdict_ordered *self, char *key, void *data) {
+  pdict_ordered_put_n(self, key, strlen(key), data);
+}
+
+void pdict_ordered_put_n(pdict_ordered *self, const void *key, size_t key_len, void *data) {
+  size_t hash = (size_t) phash_bytes(key, key_len, self->seed);
+  ptrdiff_t position;
+  size_t slot = pdict_ordered_lookup(self, key, key_len, hash, &position);
+
+  if (position >= 0) {
+    self->entries[position].data = data;
+    return;
+  }
+
+  /*
+   * A key handed out by an iteration lives in the arena, which the resize or
+   * the append below may move.
+   */
+  uintptr_t arena = (uintptr_t) self->keys;
+  char *copy = 0;
+
+  if (self->keys && (uintptr_t) key >= arena && (uintptr_t) key < arena + self->keys_used) {
+    copy = malloc(key_len);
+    memcpy(copy, key, key_len);
+    key = copy;
+  }
+
+  if (self->entries_used == self->entries_capacity) {
+    /* room for twice the live entries, removed ones are compacted away */
+    pdict_ordered_resize(self, self->elements_count * 2 + 1);
+    slot = pdict_ordered_free_slot(self, hash);
+  }
+
+  pdict_ordered_entry *entry = &self->entries[self->entries_used];
+  entry->hash = hash;
+  entry->key_offset = pdict_ordered_store_key(self, key, key_len);
+  entry->key_len = key_len;
+  entry->data = data;
+
+  pdict_ordered_index_set(self, slot, (ptrdiff_t) self->entries_used++);
+  self->elements_count++;
+  free(copy);
+}
+
+void *pdict_ordered_get_value(pdict_ordered *self, char *key) {
+  return pdict_ordered_get_n(self, key, strlen(key));
+}
+
+void *pdict_ordered_get_n(pdict_ordered *self, const void *key, size_t key_len) {
+  ptrdiff_t position;
+  pdict_ordered_lookup(self, key, key_len, (size_t) phash_bytes(key, key_len, self->seed),
+                       &position);
+  return position >= 0 ? self->entries[position].data : 0;
+}
+
+bool pdict_ordered_has_key(pdict_ordered *self, char *key) {
+  size_t key_len = strlen(key);
+  ptrdiff_t position;
+  pdict_ordered_lookup(self, key, key_len, (size_t) phash_bytes(key, key_len, self->seed),
+                       &position);
+  return position >= 0;
+}
+
+void *pdict_ordered_remove(pdict_ordered *self, char *key) {
+  return pdict_ordered_remove_n(self, key, strlen(key));
+}
+
+void *pdict_ordered_remove_n(pdict_ordered *self, const void *key, size_t key_len) {
+  ptrdiff_t position;
+  size_t slot = pdict_ordered_lookup(self, key, key_len,
+                                     (size_t) phash_bytes(key, key_len, self->seed), &position);
+
+  if (position < 0) {
+    return 0;
+  }
+
+  pdict_ordered_entry *entry = &self->entries[position];
+  void *data = entry->data;
+
+  entry->key_offset = PDICT_ORDERED_REMOVED;
+  entry->data = 0;
+  pdict_ordered_index_set(self, slot, PDICT_ORDERED_DUMMY);
+  self->elements_count--;
+  return data;
+}
+
+void pdict_ordered_iterate(pdict_ordered *self, pdict_closure closure) {
+  pdict_ordered_iter iter;
+  pdict_entry entry;
+
+  pdict_ordered_iter_init(&iter, self);
+
+  while (pdict_ordered_iter_next(&iter, &entry)) {
+    closure(entry.key, entry.value);
+  }
+}
+
+void pdict_ordered_iterate_with_context(pdict_ordered *self, pdict_context_closure closure,
+                                        void *ctx) {
+  pdict_ordered_iter iter;
+  pdict_entry entry;
+
+  pdict_ordered_iter_init(&iter, self);
+
+  while (pdict_ordered_iter_next(&iter, &entry)) {
+    closure(entry.key, entry.value, ctx);
+  }
+}
+
+void pdict_ordered_iter_init(pdict_ordered_iter *iter, pdict_ordered *self) {
+  *iter = (pdict_ordered_iter) {
+    .dict = self
+  };
+}
+
+bool pdict_ordered_iter_next(pdict_ordered_iter *iter, pdict_entry *entry) {
+  pdict_ordered *self = iter->dict;
+
+  while (iter->index < self->entries_used) {
+    pdict_ordered_entry *element = &self->entries[iter->index++];
+
+    if (element->key_offset != PDICT_ORDERED_REMOVED) {
+      entry->key = PDICT_ORDERED_KEY(self, element);
+      entry->key_len = element->key_len;
+      entry->value = element->data;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+size_t pdict_ordered_size(pdict_ordered *self) { return self->elements_count; }
+
+bool pdict_ordered_is_empty(pdict_ordered *self) { return self->elements_count == 0; }
+
+void pdict_ordered_clean(pdict_ordered *self) {
+  memset(self->indices, 0xFF, self->index_slots * self->index_width);
+  self->entries_used = 0;
+  self->elements_count = 0;
+  self->keys_used = 0;
+}
+
+void pdict_ordered_destroy(pdict_ordered *self) {
+  pdict_ordered_destroy_all(self, 0);
+}
+
+void pdict_ordered_destroy_all(pdict_ordered *self, pdict_destroyer destroyer) {
+  for (size_t i = 0; i < self->entries_used; ++i) {
+    if (self->entries[i].key_offset != PDICT_ORDERED_REMOVED && destroyer) {
+      destroyer(self->entries[i].data);
+    }
+  }
+
+  free(self->keys);
+  free(self->indices);
+  free(self->entries);
+  free(self);
+}
+
+/* Allocates an empty index and entries array, all index slots set to EMPTY */
+static void pdict_ordered_allocate(pdict_ordered *self, size_t index_slots) {
+  size_t width = index_slots <= INT8_MAX + 1 ? 1
+                 : index_slots <= INT16_MAX + 1 ? 2
+                 : index_slots <= (size_t) INT32_MAX + 1 ? 4 : 8;
+
+  self->index_slots = index_slots;
+  self->index_width = width;
+  /* all bits set reads back as -1 (EMPTY) at every width */
+  self->indices = malloc(index_slots * width);
+  memset(self->indices, 0xFF, index_slots * width);
+  self->entries_capacity = index_slots * 2 / 3;
+  self->entries = malloc(self->entries_capacity * sizeof(pdict_ordered_entry));
+  self->entries_used = 0;
+}
+
+/*
+ * Rebuilds the index for the given capacity and compacts the live entries
+ * to the front of the new entries array, keeping their order. Their keys are
+ * compacted into a new arena the same way.
+ */
+static void pdict_ordered_resize(pdict_ordered *self, size_t capacity) {
+  void *old_indices = self->indices;
+  pdict_ordered_entry *old_entries = self->entries;
+  size_t old_used = self->entries_used;
+  char *old_keys = self->keys;
+
+  pdict_ordered_allocate(self, pdict_ordered_slots_for(capacity));
+  self->keys = 0;
+  self->keys_used = 0;
+  self->keys_capacity = 0;
+
+  for (size_t i = 0; i < old_used; ++i) {
+    pdict_ordered_entry *entry = &old_entries[i];
+
+    if (entry->key_offset == PDICT_ORDERED_REMOVED) continue;
+
+    size_t slot = pdict_ordered_free_slot(self, entry->hash);
+    entry->key_offset = pdict_ordered_store_key(self, old_keys + entry->key_offset,
+                                                entry->key_len);
+    self->entries[self->entries_used] = *entry;
+    pdict_ordered_index_set(self, slot, (ptrdiff_t) self->entries_used++);
+  }
+
+  free(old_keys);
+  free(old_indices);
+  free(old_entries);
+}
+
+/* Appends key and a NUL to the arena, returns where it starts */
+static size_t pdict_ordered_store_key(pdict_ordered *self, const void *key, size_t key_len) {
+  size_t offset = self->keys_used;
+
+  if (self->keys_capacity - offset < key_len + 1) {
+    size_t capacity = self->keys_capacity ? self->keys_capacity : 64;
+
+    while (capacity - offset < key_len + 1) {
+      capacity *= 2;
+    }
+
+    self->keys = realloc(self->keys, capacity);
+    self->keys_capacity = capacity;
+  }
+
+  memcpy(self->keys + offset, key, key_len);
+  self->keys[offset + key_len] = '\0';
+  self->keys_used = offset + key_len + 1;
+  return offset;
+}
+
+static size_t pdict_ordered_slots_for(size_t capacity) {
+  size_t slots = PDICT_ORDERED_MIN_SLOTS;
+
+  while (slots * 2 / 3 < capacity) {
+    slots *= 2;
+  }
+
+  return slots;
+}
+
+static inline ptrdiff_t pdict_ordered_index_get(const pdict_ordered *self, size_t slot) {
+  switch (self->index_width) {
+    case 1:
+      return ((const int8_t *) self->indices)[slot];
+    case 2:
+      return ((const int16_t *) self->indices)[slot];
+    case 4:
+      return ((const int32_t *) self->indices)[slot];
+    default:
+      return (ptrdiff_t)((const int64_t *) self->indices)[slot];
+  }
+}
+
+static inline void pdict_ordered_index_set(pdict_ordered *self, size_t slot, ptrdiff_t value) {
+  switch (self->index_width) {
+    case 1:
+      ((int8_t *) self->indices)[slot] = (int8_t) value;
+      break;
+    case 2:
+      ((int16_t *) self->indices)[slot] = (int16_t) value;
+      break;
+    case 4:
+      ((int32_t *) self->indices)[slot] = (int32_t) value;
+      break;
+    default:
+      ((int64_t *) self->indices)[slot] = (int64_t) value;
+      break;
+  }
+}
+
+/*
+ * Probes for key. position gets the entry holding it or -1, and the returned
+ * slot is the index slot of that entry or, when missing, the slot the key
+ * should be inserted in (the first dummy met, else the empty slot that ended
+ * the probe).
+ */
+static size_t pdict_ordered_lookup(const pdict_ordered *self, const void *key, size_t key_len,
+                                   size_t hash, ptrdiff_t *position) {
+  size_t mask = self->index_slots - 1;
+  size_t perturb = hash;
+  size_t slot = hash & mask;
+  size_t free_slot = SIZE_MAX;
+
+  for (;;) {
+    ptrdiff_t index = pdict_ordered_index_get(self, slot);
+
+    if (index == PDICT_ORDERED_EMPTY) {
+      *position = -1;
+      return free_slot != SIZE_MAX ? free_slot : slot;
+    }
+
+    if (index == PDICT_ORDERED_DUMMY) {
+      if (free_slot == SIZE_MAX) {
+        free_slot = slot;
+      }
+    } else {
+      const pdict_ordered_entry *entry = &self->entries[index];
+
+      if (entry->hash == hash && entry->key_len == key_len &&
+          memcmp(PDICT_ORDERED_KEY(self, entry), key, key_len) == 0) {
+        *position = index;
+        return slot;
+      }
+    }
+
+    perturb >>= PDICT_ORDERED_PERTURB_SHIFT;
+    slot = (slot * 5 + perturb + 1) & mask;
+  }
+}
+
+/* First slot without an entry on the probe sequence of hash */
+static size_t pdict_ordered_free_slot(const pdict_ordered *self, size_t hash) {
+  size_t mask = self->index_slots - 1;
+  size_t perturb = hash;
+  size_t slot = hash & mask;
+
+  while (pdict_ordered_index_get(self, slot) >= 0) {
+    perturb >>= PDICT_ORDERED_PERTURB_SHIFT;
+    slot = (slot * 5 + perturb + 1) & mask;
+  }
+
+  return slot;
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/pepoch.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PEPOCH_CACHE_LINE 64
+#define PEPOCH_LISTS 3
+#define PEPOCH_ACTIVE UINT64_C(1)
+
+/* Retirements between two reclamation attempts */
+#define PEPOCH_RECLAIM_THRESHOLD 64
+
+/*
+ * state is 0 outside critical sections, else the epoch seen when entering
+ * shifted left once, with PEPOCH_ACTIVE set. Records are never freed before
+ * the domain, unregistering only marks them free for the next thread.
+ */
+struct pepoch_thread {
+  _Alignas(PEPOCH_CACHE_LINE) _Atomic uint64_t state;
+  bool in_use;
+  pepoch_thread *next;
+};
+
+typedef struct pepoch_retired pepoch_retired;
+struct pepoch_retired {
+  void *pointer;
+  pepoch_destroyer destroyer;
+  pepoch_retired *next;
+};
+
+/*
+ * Retired pointers go to the list of the epoch they were retired in. The
+ * epoch only moves to e once every active reader has seen e - 1, so they all
+ * entered after anything retired in e - 2 was unlinked: that list can be
+ * destroyed, and it is the one e + 1 will reuse.
+ */
+struct pepoch {
+  _Alignas(PEPOCH_CACHE_LINE) _Atomic uint64_t epoch;
+  _Alignas(PEPOCH_CACHE_LINE) pthread_mutex_t lock;
+  pepoch_thread *threads;
+  pepoch_retired *limbo[PEPOCH_LISTS];
+  size_t pending;
+  size_t since_reclaim;
+};
+
+static void pepoch_destroy_list(pepoch_retired *retired);
+
+static size_t pepoch_try_advance(pepoch *self);
+
+pepoch *pepoch_create(void) {
+  pepoch *self = aligned_alloc(PEPOCH_CACHE_LINE, sizeof(pepoch));
+
+  atomic_init(&self->epoch, 0);
+  pthread_mutex_init(&self->lock, 0);
+  self->threads = 0;
+  self->pending = 0;
+  self->since_reclaim = 0;
+
+  for (size_t i = 0; i < PEPOCH_LISTS; ++i) {
+    self->limbo[i] = 0;
+  }
+
+  return self;
+}
+
+pepoch_thread *pepoch_register(pepoch *self) {
+  pthread_mutex_lock(&self->lock);
+
+  pepoch_thread *thread = self->threads;
+
+  while (thread && thread->in_use) {
+    thread = thread->next;
+  }
+
+  if (!thread) {
+    thread = aligned_alloc(PEPOCH_CACHE_LINE, sizeof(pepoch_thread));
+    atomic_init(&thread->state, 0);
+    thread->next = self->threads;
+    self->threads = thread;
+  }
+
+  thread->in_use = true;
+  pthread_mutex_unlock(&self->lock);
+  return thread;
+}
+
+void pepoch_unregister(pepoch *self, pepoch_thread *thread) {
+  pthread_mutex_lock(&self->lock);
+  atomic_store_explicit(&thread->state, 0, memory_order_release);
+  thread->in_use = false;
+  pthread_mutex_unlock(&self->lock);
+}
+
+void pepoch_enter(pepoch *self, pepoch_thread *thread) {
+  uint64_t epoch = atomic_load_explicit(&self->epoch, memory_order_relaxed);
+  atomic_store_explicit(&thread->state, (epoch << 1) | PEPOCH_ACTIVE, memory_order_relaxed);
+  /* the reads of the critical section must not move above the announcement */
+  atomic_thread_fence(memory_order_seq_cst);
+}
+
+void pepoch_exit(pepoch_thread *thread) {
+  atomic_store_explicit(&thread->state, 0, memory_order_release);
+}
+
+void pepoch_retire(pepoch *self, void *pointer, pepoch_destroyer destroyer) {
+  pepoch_retired *retired = malloc(sizeof(pepoch_retired));
+  retired->pointer = pointer;
+  retired->destroyer = destroyer;
+
+  pthread_mutex_lock(&self->lock);
+
+  uint64_t epoch = atomic_load_explicit(&self->epoch, memory_order_relaxed);
+  retired->next = self->limbo[epoch % PEPOCH_LISTS];
+  self->limbo[epoch % PEPOCH_LISTS] = retired;
+  self->pending++;
+
+  if (++self->since_reclaim >= PEPOCH_RECLAIM_THRESHOLD) {
+    pepoch_try_advance(self);
+  }
+
+  pthread_mutex_unlock(&self->lock);
+}
+
+size_t pepoch_reclaim(pepoch *self) {
+  pthread_mutex_lock(&self->lock);
+  size_t pending = pepoch_try_advance(self);
+  pthread_mutex_unlock(&self->lock);
+  return pending;
+}
+
+void pepoch_destroy(pepoch *self) {
+  for (size_t i = 0; i < PEPOCH_LISTS; ++i) {
+    pepoch_destroy_list(self->limbo[i]);
+  }
+
+  pepoch_thread *thread = self->threads;
+
+  while (thread) {
+    pepoch_thread *next = thread->next;
+    free(thread);
+    thread = next;
+  }
+
+  pthread_mutex_destroy(&self->lock);
+  free(self);
+}
+
+static void pepoch_destroy_list(pepoch_retired *retired) {
+  while (retired) {
+    pepoch_retired *next = retired->next;
+    retired->destroyer(retired->pointer);
+    free(retired);
+    retired = next;
+  }
+}
+
+/*
+ * Called with the lock held. Advances the epoch if every active reader has
+ * seen the current one and destroys the list that became safe. Readers are
+ * never waited for: if one is behind, the attempt is simply dropped.
+ */
+static size_t pepoch_try_advance(pepoch *self) {
+  uint64_t epoch = atomic_load_explicit(&self->epoch, memory_order_relaxed);
+
+  self->since_reclaim = 0;
+  atomic_thread_fence(memory_order_seq_cst);
+
+  for (pepoch_thread *thread = self->threads; thread; thread = thread->next) {
+    uint64_t state = atomic_load_explicit(&thread->state, memory_order_acquire);
+
+    if ((state & PEPOCH_ACTIVE) && (state >> 1) != epoch) {
+      return self->pending;
+    }
+  }
+
+  epoch++;
+  atomic_store_explicit(&self->epoch, epoch, memory_order_release);
+
+  pepoch_retired *safe = self->limbo[(epoch + 1) % PEPOCH_LISTS];
+  self->limbo[(epoch + 1) % PEPOCH_LISTS] = 0;
+
+  for (pepoch_retired *retired = safe; retired; retired = retired->next) {
+    self->pending--;
+  }
+
+  pepoch_destroy_list(safe);
+  return self->pending;
+}
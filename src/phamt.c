@@ -0,0 +1,478 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/phamt.h"
+#include "putils/phash.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#define PHAMT_BITS 5
+#define PHAMT_MASK ((1u << PHAMT_BITS) - 1)
+
+enum phamt_kind {
+  PHAMT_LEAF = 0,
+  PHAMT_BRANCH,
+  /* keys whose whole 64 bit hash is equal, kept in a flat array */
+  PHAMT_COLLISION
+};
+
+typedef struct phamt_node phamt_node;
+struct phamt_node {
+  _Atomic size_t refs;
+  uint32_t kind;
+  /* children of a branch or collision node */
+  uint32_t count;
+  /* key hash of a leaf, shared hash of a collision node */
+  uint64_t hash;
+};
+
+typedef struct phamt_leaf phamt_leaf;
+struct phamt_leaf {
+  phamt_node node;
+  void *data;
+  size_t key_len;
+  char key[];
+};
+
+/* Branches keep only their present children, ordered by bitmap position */
+typedef struct phamt_branch phamt_branch;
+struct phamt_branch {
+  phamt_node node;
+  uint32_t bitmap;
+  phamt_node *children[];
+};
+
+struct phamt {
+  phamt_node *root;
+  size_t count;
+  pdict_hasher hasher;
+  uint64_t seed;
+};
+
+static inline phamt_node *phamt_retain(phamt_node *node);
+
+static void phamt_release(phamt_node *node);
+
+static phamt_leaf *phamt_leaf_create(const void *key, size_t key_len, uint64_t hash, void *data);
+
+static phamt_branch *phamt_branch_create(uint32_t kind, uint32_t count, uint64_t hash);
+
+static inline unsigned phamt_popcount(uint32_t bits);
+
+static inline bool phamt_leaf_matches(const phamt_leaf *leaf, const void *key, size_t key_len,
+                                      uint64_t hash);
+
+static const phamt_leaf *phamt_find(const phamt *self, const void *key, size_t key_len);
+
+static phamt_node *phamt_insert(phamt_node *node, unsigned shift, phamt_leaf *leaf,
+                                void **replaced, bool *added);
+
+static phamt_node *phamt_merge(phamt_node *first, phamt_node *second, unsigned shift);
+
+static phamt_node *phamt_delete(phamt_node *node, unsigned shift, const void *key,
+                                size_t key_len, uint64_t hash);
+
+static void phamt_iterate_node(const phamt_node *node, pdict_context_closure closure, void *ctx);
+
+phamt *phamt_create(void) {
+  return phamt_create_with_hasher(phash_bytes, phash_random_seed());
+}
+
+phamt *phamt_create_with_hasher(pdict_hasher hasher, uint64_t seed) {
+  phamt *self = malloc(sizeof(phamt));
+  self->root = 0;
+  self->count = 0;
+  self->hasher = hasher;
+  self->seed = seed;
+  return self;
+}
+
+phamt *phamt_snapshot(const phamt *self) {
+  phamt *snapshot = malloc(sizeof(phamt));
+  *snapshot = *self;
+
+  if (snapshot->root) {
+    phamt_retain(snapshot->root);
+  }
+
+  return snapshot;
+}
+
+void *phamt_put(phamt *self, char *key, void *data) {
+  return phamt_put_n(self, key, strlen(key), data);
+}
+
+void *phamt_put_n(phamt *self, const void *key, size_t key_len, void *data) {
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  phamt_leaf *leaf = phamt_leaf_create(key, key_len, hash, data);
+  void *replaced = 0;
+  bool added = true;
+
+  phamt_node *root = self->root
+                     ? phamt_insert(self->root, 0, leaf, &replaced, &added)
+                     : &leaf->node;
+
+  if (self->root) {
+    phamt_release(self->root);
+  }
+
+  self->root = root;
+  self->count += added;
+  return replaced;
+}
+
+void *phamt_get_value(const phamt *self, char *key) {
+  return phamt_get_n(self, key, strlen(key));
+}
+
+void *phamt_get_n(const phamt *self, const void *key, size_t key_len) {
+  const phamt_leaf *leaf = phamt_find(self, key, key_len);
+  return leaf ? leaf->data : 0;
+}
+
+bool phamt_has_key(const phamt *self, char *key) {
+  return phamt_find(self, key, strlen(key)) != 0;
+}
+
+void *phamt_remove(phamt *self, char *key) {
+  return phamt_remove_n(self, key, strlen(key));
+}
+
+void *phamt_remove_n(phamt *self, const void *key, size_t key_len) {
+  const phamt_leaf *leaf = phamt_find(self, key, key_len);
+
+  if (!leaf) {
+    return 0;
+  }
+
+  void *data = leaf->data;
+  phamt_node *root = phamt_delete(self->root, 0, key, key_len, leaf->node.hash);
+
+  phamt_release(self->root);
+  self->root = root;
+  self->count--;
+  return data;
+}
+
+void phamt_iterate_with_context(const phamt *self, pdict_context_closure closure, void *ctx) {
+  if (self->root) {
+    phamt_iterate_node(self->root, closure, ctx);
+  }
+}
+
+size_t phamt_size(const phamt *self) { return self->count; }
+
+bool phamt_is_empty(const phamt *self) { return self->count == 0; }
+
+void phamt_destroy(phamt *self) {
+  if (self->root) {
+    phamt_release(self->root);
+  }
+
+  free(self);
+}
+
+static inline phamt_node *phamt_retain(phamt_node *node) {
+  atomic_fetch_add_explicit(&node->refs, 1, memory_order_relaxed);
+  return node;
+}
+
+/* Frees node once its last version lets go of it, children first */
+static void phamt_release(phamt_node *node) {
+  if (atomic_fetch_sub_explicit(&node->refs, 1, memory_order_acq_rel) != 1) {
+    return;
+  }
+
+  if (node->kind != PHAMT_LEAF) {
+    phamt_branch *branch = (phamt_branch *) node;
+
+    for (uint32_t i = 0; i < node->count; ++i) {
+      phamt_release(branch->children[i]);
+    }
+  }
+
+  free(node);
+}
+
+static phamt_leaf *phamt_leaf_create(const void *key, size_t key_len, uint64_t hash, void *data) {
+  phamt_leaf *leaf = malloc(sizeof(phamt_leaf) + key_len + 1);
+
+  atomic_init(&leaf->node.refs, 1);
+  leaf->node.kind = PHAMT_LEAF;
+  leaf->node.count = 0;
+  leaf->node.hash = hash;
+  leaf->data = data;
+  leaf->key_len = key_len;
+  memcpy(leaf->key, key, key_len);
+  leaf->key[key_len] = '\0';
+  return leaf;
+}
+
+static phamt_branch *phamt_branch_create(uint32_t kind, uint32_t count, uint64_t hash) {
+  phamt_branch *branch = malloc(sizeof(phamt_branch) + count * sizeof(phamt_node *));
+
+  atomic_init(&branch->node.refs, 1);
+  branch->node.kind = kind;
+  branch->node.count = count;
+  branch->node.hash = hash;
+  branch->bitmap = 0;
+  return branch;
+}
+
+static inline unsigned phamt_popcount(uint32_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned) __builtin_popcount(bits);
+#else
+  unsigned count = 0;
+  for (; bits; bits &= bits - 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+static inline bool phamt_leaf_matches(const phamt_leaf *leaf, const void *key, size_t key_len,
+                                      uint64_t hash) {
+  return leaf->node.hash == hash && leaf->key_len == key_len &&
+         memcmp(leaf->key, key, key_len) == 0;
+}
+
+static const phamt_leaf *phamt_find(const phamt *self, const void *key, size_t key_len) {
+  uint64_t hash = self->hasher(key, key_len, self->seed);
+  const phamt_node *node = self->root;
+
+  for (unsigned shift = 0; node; shift += PHAMT_BITS) {
+    if (node->kind == PHAMT_LEAF) {
+      const phamt_leaf *leaf = (const phamt_leaf *) node;
+      return phamt_leaf_matches(leaf, key, key_len, hash) ? leaf : 0;
+    }
+
+    const phamt_branch *branch = (const phamt_branch *) node;
+
+    if (node->kind == PHAMT_COLLISION) {
+      for (uint32_t i = 0; i < node->count; ++i) {
+        const phamt_leaf *leaf = (const phamt_leaf *) branch->children[i];
+
+        if (phamt_leaf_matches(leaf, key, key_len, hash)) {
+          return leaf;
+        }
+      }
+
+      return 0;
+    }
+
+    uint32_t bit = UINT32_C(1) << ((hash >> shift) & PHAMT_MASK);
+
+    if (!(branch->bitmap & bit)) {
+      return 0;
+    }
+
+    node = branch->children[phamt_popcount(branch->bitmap & (bit - 1))];
+  }
+
+  return 0;
+}
+
+/*
+ * Returns a new version of node (which is left untouched) holding leaf. The
+ * caller's reference on leaf moves into the result.
+ */
+static phamt_node *phamt_insert(phamt_node *node, unsigned shift, phamt_leaf *leaf,
+                                void **replaced, bool *added) {
+  uint64_t hash = leaf->node.hash;
+
+  if (node->kind == PHAMT_LEAF) {
+    phamt_leaf *existing = (phamt_leaf *) node;
+
+    if (phamt_leaf_matches(existing, leaf->key, leaf->key_len, hash)) {
+      *replaced = existing->data;
+      *added = false;
+      return &leaf->node;
+    }
+
+    return phamt_merge(phamt_retain(node), &leaf->node, shift);
+  }
+
+  phamt_branch *branch = (phamt_branch *) node;
+
+  if (node->kind == PHAMT_COLLISION) {
+    if (node->hash != hash) {
+      return phamt_merge(phamt_retain(node), &leaf->node, shift);
+    }
+
+    uint32_t count = node->count;
+    uint32_t position = count;
+
+    for (uint32_t i = 0; i < count; ++i) {
+      phamt_leaf *existing = (phamt_leaf *) branch->children[i];
+
+      if (phamt_leaf_matches(existing, leaf->key, leaf->key_len, hash)) {
+        *replaced = existing->data;
+        *added = false;
+        position = i;
+      }
+    }
+
+    phamt_branch *copy = phamt_branch_create(PHAMT_COLLISION, count + (position == count), hash);
+
+    for (uint32_t i = 0; i < count; ++i) {
+      copy->children[i] = i == position ? &leaf->node : phamt_retain(branch->children[i]);
+    }
+
+    if (position == count) {
+      copy->children[count] = &leaf->node;
+    }
+
+    return &copy->node;
+  }
+
+  uint32_t bit = UINT32_C(1) << ((hash >> shift) & PHAMT_MASK);
+  uint32_t position = phamt_popcount(branch->bitmap & (bit - 1));
+  uint32_t count = node->count;
+  bool present = (branch->bitmap & bit) != 0;
+  phamt_branch *copy = phamt_branch_create(PHAMT_BRANCH, count + !present, 0);
+
+  copy->bitmap = branch->bitmap | bit;
+
+  for (uint32_t i = 0, j = 0; i < count; ++i, ++j) {
+    if (i == position) {
+      if (present) {
+        copy->children[j] = phamt_insert(branch->children[i], shift + PHAMT_BITS, leaf,
+                                         replaced, added);
+        continue;
+      }
+
+      copy->children[j++] = &leaf->node;
+    }
+
+    copy->children[j] = phamt_retain(branch->children[i]);
+  }
+
+  if (position == count) {
+    copy->children[count] = &leaf->node;
+  }
+
+  return &copy->node;
+}
+
+/*
+ * Builds the subtree holding two nodes with different hashes (or the same
+ * hash, when both are leaves), taking over the references on both.
+ */
+static phamt_node *phamt_merge(phamt_node *first, phamt_node *second, unsigned shift) {
+  if (first->hash == second->hash) {
+    phamt_branch *collision = phamt_branch_create(PHAMT_COLLISION, 2, first->hash);
+    collision->children[0] = first;
+    collision->children[1] = second;
+    return &collision->node;
+  }
+
+  uint32_t first_index = (uint32_t)(first->hash >> shift) & PHAMT_MASK;
+  uint32_t second_index = (uint32_t)(second->hash >> shift) & PHAMT_MASK;
+
+  if (first_index == second_index) {
+    phamt_branch *branch = phamt_branch_create(PHAMT_BRANCH, 1, 0);
+    branch->bitmap = UINT32_C(1) << first_index;
+    branch->children[0] = phamt_merge(first, second, shift + PHAMT_BITS);
+    return &branch->node;
+  }
+
+  phamt_branch *branch = phamt_branch_create(PHAMT_BRANCH, 2, 0);
+  branch->bitmap = (UINT32_C(1) << first_index) | (UINT32_C(1) << second_index);
+  branch->children[first_index < second_index ? 0 : 1] = first;
+  branch->children[first_index < second_index ? 1 : 0] = second;
+  return &branch->node;
+}
+
+/*
+ * Returns a new version of node without key (which must be present), or
+ * null if nothing is left. Branches left with a single leaf or collision
+ * node collapse into it, so lookups never walk through one child chains.
+ */
+static phamt_node *phamt_delete(phamt_node *node, unsigned shift, const void *key,
+                                size_t key_len, uint64_t hash) {
+  if (node->kind == PHAMT_LEAF) {
+    return 0;
+  }
+
+  phamt_branch *branch = (phamt_branch *) node;
+  uint32_t count = node->count;
+
+  if (node->kind == PHAMT_COLLISION) {
+    uint32_t position = 0;
+
+    while (!phamt_leaf_matches((phamt_leaf *) branch->children[position], key, key_len, hash)) {
+      position++;
+    }
+
+    if (count == 2) {
+      return phamt_retain(branch->children[1 - position]);
+    }
+
+    phamt_branch *copy = phamt_branch_create(PHAMT_COLLISION, count - 1, hash);
+
+    for (uint32_t i = 0, j = 0; i < count; ++i) {
+      if (i != position) {
+        copy->children[j++] = phamt_retain(branch->children[i]);
+      }
+    }
+
+    return &copy->node;
+  }
+
+  uint32_t bit = UINT32_C(1) << ((hash >> shift) & PHAMT_MASK);
+  uint32_t position = phamt_popcount(branch->bitmap & (bit - 1));
+  phamt_node *child = phamt_delete(branch->children[position], shift + PHAMT_BITS, key,
+                                   key_len, hash);
+
+  if (!child && count == 1) {
+    return 0;
+  }
+
+  if (!child && count == 2 && branch->children[1 - position]->kind != PHAMT_BRANCH) {
+    return phamt_retain(branch->children[1 - position]);
+  }
+
+  if (child && count == 1 && child->kind != PHAMT_BRANCH) {
+    return child;
+  }
+
+  phamt_branch *copy = phamt_branch_create(PHAMT_BRANCH, count - !child, 0);
+  copy->bitmap = child ? branch->bitmap : branch->bitmap & ~bit;
+
+  for (uint32_t i = 0, j = 0; i < count; ++i) {
+    if (i != position) {
+      copy->children[j++] = phamt_retain(branch->children[i]);
+    } else if (child) {
+      copy->children[j++] = child;
+    }
+  }
+
+  return &copy->node;
+}
+
+static void phamt_iterate_node(const phamt_node *node, pdict_context_closure closure, void *ctx) {
+  if (node->kind == PHAMT_LEAF) {
+    const phamt_leaf *leaf = (const phamt_leaf *) node;
+    closure((char *) leaf->key, leaf->data, ctx);
+    return;
+  }
+
+  const phamt_branch *branch = (const phamt_branch *) node;
+
+  for (uint32_t i = 0; i < node->count; ++i) {
+    phamt_iterate_node(branch->children[i], closure, ctx);
+  }
+}
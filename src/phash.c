@@ -0,0 +1,158 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/phash.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static const uint64_t phash_secret[4] = {
+  UINT64_C(0xa0761d6478bd642f), UINT64_C(0xe7037ed1a0b428db),
+  UINT64_C(0x8ebc6af09c88c6e3), UINT64_C(0x589965cc75374cc3)
+};
+
+static _Atomic uint64_t phash_seed_state = 0;
+
+static inline void phash_multiply(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (uint64_t) r;
+  *b = (uint64_t)(r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t phash_mix(uint64_t a, uint64_t b) {
+  phash_multiply(&a, &b);
+  return a ^ b;
+}
+
+static inline uint64_t phash_read8(const uint8_t *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t phash_read4(const uint8_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t phash_read3(const uint8_t *p, size_t len) {
+  return ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+}
+
+uint64_t phash_bytes(const void *key, size_t len, uint64_t seed) {
+  const uint8_t *p = key;
+  const uint64_t *s = phash_secret;
+  uint64_t a, b;
+
+  seed ^= phash_mix(seed ^ s[0], s[1]);
+
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (phash_read4(p) << 32) | phash_read4(p + ((len >> 3) << 2));
+      b = (phash_read4(p + len - 4) << 32) | phash_read4(p + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = phash_read3(p, len);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+
+    if (i > 48) {
+      uint64_t see1 = seed, see2 = seed;
+
+      do {
+        seed = phash_mix(phash_read8(p) ^ s[1], phash_read8(p + 8) ^ seed);
+        see1 = phash_mix(phash_read8(p + 16) ^ s[2], phash_read8(p + 24) ^ see1);
+        see2 = phash_mix(phash_read8(p + 32) ^ s[3], phash_read8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+
+      seed ^= see1 ^ see2;
+    }
+
+    while (i > 16) {
+      seed = phash_mix(phash_read8(p) ^ s[1], phash_read8(p + 8) ^ seed);
+      i -= 16;
+      p += 16;
+    }
+
+    a = phash_read8(p + i - 16);
+    b = phash_read8(p + i - 8);
+  }
+
+  a ^= s[1];
+  b ^= seed;
+  phash_multiply(&a, &b);
+  return phash_mix(a ^ s[0] ^ len, b ^ s[1]);
+}
+
+uint64_t phash_string(const char *key, uint64_t seed) {
+  return phash_bytes(key, strlen(key), seed);
+}
+
+uint64_t phash_djb2(const void *key, size_t len, uint64_t seed) {
+  const unsigned char *str = key;
+  uint64_t hash = seed ? seed : 5381;
+
+  for (size_t i = 0; i < len; ++i) {
+    hash = ((hash << 5) + hash) + str[i]; /* hash * 33 + c */
+  }
+
+  return hash;
+}
+
+uint64_t phash_random_seed(void) {
+  uint64_t state = atomic_load_explicit(&phash_seed_state, memory_order_relaxed);
+
+  if (state == 0) {
+    uint64_t entropy = 0;
+    FILE *urandom = fopen("/dev/urandom", "rb");
+
+    if (urandom) {
+      if (fread(&entropy, sizeof(entropy), 1, urandom) != 1) {
+        entropy = 0;
+      }
+      fclose(urandom);
+    }
+
+    entropy ^= phash_mix((uint64_t) time(0) ^ (uint64_t)(uintptr_t) &entropy, (uint64_t) clock());
+    entropy |= 1;
+
+    uint64_t expected = 0;
+    atomic_compare_exchange_strong(&phash_seed_state, &expected, entropy);
+  }
+
+  /* splitmix64 step: distinct and well mixed seeds out of a shared counter */
+  uint64_t z = atomic_fetch_add(&phash_seed_state, UINT64_C(0x9e3779b97f4a7c15));
+  z += UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
@@ -14,30 +14,151 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  ***************************************************************************/
 #include "putils/plist.h"
+#include <pthread.h>
+#include <string.h>
 
 struct plist {
   plist_node *head;
   plist_node *tail;
   size_t elements_count;
+  /* unrolled layout, head and tail stay null */
+  bool unrolled;
+  plist_chunk *first_chunk;
+  plist_chunk *last_chunk;
+  /* node pool of pooled lists */
+  ppool *pool;
+};
+
+/*
+ * Position while walking a list of either layout, see plist_walk_next.
+ */
+typedef struct plist_walk plist_walk;
+struct plist_walk {
+  plist_node *node;
+  plist_chunk *chunk;
+  size_t slot;
+};
+
+/*
+ * Sorted stretch of a linked list being sorted, tail->next is always null.
+ */
+typedef struct plist_run plist_run;
+struct plist_run {
+  plist_node *head;
+  plist_node *tail;
+  size_t length;
+};
+
+/*
+ * Runs shorter than this are grown with an insertion sort before merging.
+ * Pending run lengths grow at least like Fibonacci numbers, so no list that
+ * fits in memory needs more than PLIST_SORT_MAX_RUNS of them.
+ */
+#define PLIST_SORT_MIN_RUN 8
+#define PLIST_SORT_MAX_RUNS 96
+
+/* Below this many elements per thread plist_sort_parallel uses fewer threads */
+#define PLIST_PARALLEL_MIN_ELEMENTS 4096
+
+/* State shared by the plist_sort_parallel phases */
+typedef struct plist_parallel plist_parallel;
+struct plist_parallel {
+  size_t count;
+  size_t nthreads;
+  plist_comparator comparator;
+  /* items are plist_node pointers rather than the data itself */
+  bool nodes;
+  /* merge rounds read runs of width thread slices from source into target */
+  void **source;
+  void **target;
+  size_t width;
+};
+
+typedef struct plist_parallel_worker plist_parallel_worker;
+struct plist_parallel_worker {
+  plist_parallel *sort;
+  size_t id;
 };
 
 static void plist_link_nodes(plist_node *previous, plist_node *next);
 
-static plist_node *plist_create_node(void *data);
+static plist_node *plist_create_node(plist *self, void *data);
+
+static void plist_free_node(plist *self, plist_node *element);
 
 static plist_node *plist_get_node(plist *self, size_t index);
 
 static plist_node *plist_find_node(plist *self, plist_evaluator condition,
                                    size_t *index);
 
-static void plist_merge_sort(plist_node **headReference,
-                             plist_comparator comparator);
+static void plist_natural_merge_sort(plist *self, plist_comparator comparator);
+
+static plist_run plist_take_run(plist_node **rest, plist_comparator comparator);
+
+static void plist_collapse_runs(plist_run *runs, size_t *depth,
+                                plist_comparator comparator, bool force);
+
+static plist_run plist_merge_runs(plist_run left, plist_run right,
+                                  plist_comparator comparator);
+
+static plist *plist_create_like(plist *self);
+
+static plist_node *plist_cursor_upcoming(plist_cursor *cursor);
+
+static plist_walk plist_walk_start(plist *self);
+
+static void **plist_walk_next(plist *self, plist_walk *walk);
+
+static void **plist_get_slot(plist *self, size_t index);
+
+static plist_chunk *plist_create_chunk(void);
+
+static plist_chunk *plist_unrolled_locate(plist *self, size_t *index,
+                                          plist_chunk **previous);
+
+static void plist_unrolled_append(plist *self, void *data);
+
+static void plist_unrolled_prepend(plist *self, void *data);
+
+static void plist_unrolled_add(plist *self, size_t index, void *data);
+
+static plist_chunk *plist_unrolled_insert(plist *self, plist_chunk *chunk,
+                                          size_t *slot, void *data);
 
-static plist_node *plist_sorted_merge(plist_node *self, plist_node *other,
-                                      plist_comparator comparator);
+static bool plist_unrolled_cursor_advance(plist_cursor *cursor);
 
-static void plist_front_back_split(plist_node *source, plist_node **frontRef,
-                                   plist_node **backRef);
+static void plist_unrolled_cursor_unlink(plist_cursor *cursor);
+
+static void *plist_unrolled_remove(plist *self, size_t index);
+
+static void plist_unrolled_unlink(plist *self, plist_chunk *chunk,
+                                  plist_chunk *previous);
+
+static void **plist_unrolled_find(plist *self, plist_evaluator condition,
+                                  size_t *index);
+
+static void plist_unrolled_clean(plist *self);
+
+static void plist_unrolled_sort(plist *self, plist_comparator comparator);
+
+static void plist_unrolled_gather(plist *self, void **items);
+
+static void plist_unrolled_scatter(plist *self, void **items);
+
+static void plist_sort_array(void **items, void **buffer, size_t count,
+                             plist_comparator comparator, bool nodes);
+
+static void plist_parallel_run(plist_parallel *sort, void *(*phase)(void *));
+
+static void *plist_parallel_sort_slice(void *arg);
+
+static void *plist_parallel_merge_round(void *arg);
+
+static void *plist_parallel_link(void *arg);
+
+static size_t plist_parallel_co_rank(void **left, size_t left_count, void **right,
+                                     size_t right_count, size_t k,
+                                     plist_comparator comparator, bool nodes);
 
 plist *plist_create(void) {
   plist *list = calloc(1, sizeof(plist));
@@ -47,8 +168,25 @@ plist *plist_create(void) {
   return list;
 }
 
+plist *plist_create_unrolled(void) {
+  plist *list = plist_create();
+  list->unrolled = true;
+  return list;
+}
+
+plist *plist_create_pooled(void) {
+  plist *list = plist_create();
+  list->pool = ppool_create(sizeof(plist_node), 0);
+  return list;
+}
+
 size_t plist_append(plist *self, void *data) {
-  plist_node *new_element = plist_create_node(data);
+  if (self->unrolled) {
+    plist_unrolled_append(self, data);
+    return self->elements_count;
+  }
+
+  plist_node *new_element = plist_create_node(self, data);
   plist_node *last = self->tail;
 
   if (self->elements_count == 0) {
@@ -64,22 +202,27 @@ size_t plist_append(plist *self, void *data) {
 }
 
 void plist_merge(plist *self, plist *other) {
-  plist_node *node = other->head;
+  plist_walk walk = plist_walk_start(other);
+  void **slot;
 
-  while (node) {
-    plist_append(self, node->data);
-    node = node->next;
+  while ((slot = plist_walk_next(other, &walk))) {
+    plist_append(self, *slot);
   }
 }
 
 void *plist_get(plist *self, size_t index) {
-  plist_node *element = plist_get_node(self, index);
-  return element ? element->data : 0;
+  void **slot = plist_get_slot(self, index);
+  return slot ? *slot : 0;
 }
 
 void plist_add(plist *self, size_t index, void *data) {
   if (self->elements_count >= index) {
-    plist_node *new_element = plist_create_node(data);
+    if (self->unrolled) {
+      plist_unrolled_add(self, index, data);
+      return;
+    }
+
+    plist_node *new_element = plist_create_node(self, data);
 
     if (index == 0) {
       plist_link_nodes(new_element, self->head);
@@ -105,12 +248,12 @@ void plist_add(plist *self, size_t index, void *data) {
 }
 
 void *plist_replace(plist *self, size_t index, void *data) {
-  plist_node *element = plist_get_node(self, index);
+  void **slot = plist_get_slot(self, index);
   void *old_data = 0;
 
-  if (element) {
-    old_data = element->data;
-    element->data = data;
+  if (slot) {
+    old_data = *slot;
+    *slot = data;
   }
 
   return old_data;
@@ -125,6 +268,11 @@ void plist_replace_and_destroy(plist *self, size_t index, void *data,
 }
 
 void *plist_find(plist *self, plist_evaluator condition, size_t *index) {
+  if (self->unrolled) {
+    void **slot = plist_unrolled_find(self, condition, index);
+    return slot ? *slot : 0;
+  }
+
   plist_node *element = plist_find_node(self, condition, index);
   return element ? element->data : 0;
 }
@@ -133,6 +281,15 @@ void plist_iterate(plist *self, plist_closure closure) {
   if (!self || !closure)
     return;
 
+  if (self->unrolled) {
+    for (plist_chunk *chunk = self->first_chunk; chunk; chunk = chunk->next) {
+      for (size_t slot = 0; slot < chunk->count; ++slot) {
+        closure(chunk->data[slot]);
+      }
+    }
+    return;
+  }
+
   plist_node *element = self->head;
 
   while (element) {
@@ -149,6 +306,10 @@ void *plist_remove(plist *self, size_t index) {
     return 0;
   }
 
+  if (self->unrolled) {
+    return index < self->elements_count ? plist_unrolled_remove(self, index) : 0;
+  }
+
   if (index == 0) {
     aux = self->head;
     data = aux->data;
@@ -173,15 +334,28 @@ void *plist_remove(plist *self, size_t index) {
   }
 
   self->elements_count--;
-  free(aux);
+  plist_free_node(self, aux);
 
   return data;
 }
 
 void *plist_remove_selected(plist *self, plist_evaluator condition) {
-  size_t index = 0;
-  plist_node *element = plist_find_node(self, condition, &index);
-  return element ? plist_remove(self, index) : 0;
+  plist_cursor cursor;
+  void *data;
+
+  if (!condition) {
+    return 0;
+  }
+
+  plist_cursor_init(&cursor, self);
+
+  while (plist_cursor_next(&cursor, &data)) {
+    if (condition(data)) {
+      return plist_cursor_remove_current(&cursor);
+    }
+  }
+
+  return 0;
 }
 
 void plist_remove_and_destroy(plist *self, size_t index,
@@ -209,12 +383,17 @@ void plist_clean(plist *self) {
     return;
   }
 
+  if (self->unrolled) {
+    plist_unrolled_clean(self);
+    return;
+  }
+
   while (self->head) {
     plist_node *element;
     element = self->head;
     self->head = self->head->next;
     if (element)
-      free(element);
+      plist_free_node(self, element);
   }
 
   self->tail = self->head;
@@ -228,26 +407,32 @@ void plist_clean_destroying_data(plist *self, plist_destroyer destroyer) {
 
 void plist_destroy(plist **self) {
   plist_clean(*self);
-  if (*self)
+  if (*self) {
+    ppool_destroy((*self)->pool);
     free(*self);
+  }
   *self = 0;
 }
 
 void plist_destroy_all(plist **self, plist_destroyer destroyer) {
   plist_clean_destroying_data(*self, destroyer);
-  if (*self)
+  if (*self) {
+    ppool_destroy((*self)->pool);
     free(*self);
+  }
   *self = 0;
 }
 
 plist *plist_get_elements(plist *self, size_t count) {
-  plist *sublist = plist_create();
+  plist *sublist = plist_create_like(self);
 
   if (!plist_is_empty(self)) {
+    plist_walk walk = plist_walk_start(self);
+    void **slot;
+
     count = count > plist_size(self) ? plist_size(self) : count;
-    for (size_t i = 0; i < count; ++i) {
-      void *data = plist_get(self, i);
-      plist_append(sublist, data);
+    while (count-- && (slot = plist_walk_next(self, &walk))) {
+      plist_append(sublist, *slot);
     }
   }
 
@@ -255,7 +440,7 @@ plist *plist_get_elements(plist *self, size_t count) {
 }
 
 plist *plist_get_removing_elements(plist *self, size_t count) {
-  plist *sublist = plist_create();
+  plist *sublist = plist_create_like(self);
 
   if (!plist_is_empty(self)) {
     count = count > plist_size(self) ? plist_size(self) : count;
@@ -269,15 +454,14 @@ plist *plist_get_removing_elements(plist *self, size_t count) {
 }
 
 plist *plist_filter(plist *self, plist_evaluator condition) {
-  plist *filtered = plist_create();
-  plist_node *element = self->head;
+  plist *filtered = plist_create_like(self);
+  plist_walk walk = plist_walk_start(self);
+  void **slot;
 
-  while (element) {
-    if (condition(element->data)) {
-      plist_append(filtered, element->data);
+  while ((slot = plist_walk_next(self, &walk))) {
+    if (condition(*slot)) {
+      plist_append(filtered, *slot);
     }
-
-    element = element->next;
   }
 
   return filtered;
@@ -286,12 +470,12 @@ plist *plist_filter(plist *self, plist_evaluator condition) {
 plist *plist_map(plist *self, plist_transformer transformer) {
   plist *mapped = 0;
   if (transformer && self) {
-    mapped = plist_create();
-    plist_node *element = self->head;
+    mapped = plist_create_like(self);
+    plist_walk walk = plist_walk_start(self);
+    void **slot;
 
-    while (element) {
-      plist_append(mapped, transformer(element->data));
-      element = element->next;
+    while ((slot = plist_walk_next(self, &walk))) {
+      plist_append(mapped, transformer(*slot));
     }
   }
   return mapped;
@@ -301,10 +485,65 @@ void plist_sort(plist *self, plist_comparator comparator) {
   if (!self || !comparator)
     return;
 
-  plist_merge_sort(&self->head, comparator);
-  if (self->head && self->head->next) {
-    self->tail = plist_get_node(self, self->elements_count - 2)->next;
+  if (self->unrolled) {
+    plist_unrolled_sort(self, comparator);
+    return;
+  }
+
+  plist_natural_merge_sort(self, comparator);
+}
+
+void plist_sort_parallel(plist *self, plist_comparator comparator, size_t nthreads) {
+  if (!self || !comparator)
+    return;
+
+  size_t count = self->elements_count;
+  size_t most = count / PLIST_PARALLEL_MIN_ELEMENTS;
+  void **items = 0;
+
+  nthreads = nthreads > most ? most : nthreads;
+  if (nthreads < 2 || !(items = malloc(count * 2 * sizeof(void *)))) {
+    plist_sort(self, comparator);
+    return;
+  }
+
+  plist_parallel sort = {
+    .count = count,
+    .nthreads = nthreads,
+    .comparator = comparator,
+    .nodes = !self->unrolled,
+    .source = items,
+    .target = items + count,
+  };
+
+  if (self->unrolled) {
+    plist_unrolled_gather(self, items);
+  } else {
+    size_t i = 0;
+    for (plist_node *element = self->head; element; element = element->next) {
+      items[i++] = element;
+    }
+  }
+
+  plist_parallel_run(&sort, plist_parallel_sort_slice);
+
+  for (sort.width = 1; sort.width < nthreads; sort.width *= 2) {
+    plist_parallel_run(&sort, plist_parallel_merge_round);
+
+    void **swap = sort.source;
+    sort.source = sort.target;
+    sort.target = swap;
+  }
+
+  if (self->unrolled) {
+    plist_unrolled_scatter(self, sort.source);
+  } else {
+    plist_parallel_run(&sort, plist_parallel_link);
+    self->head = sort.source[0];
+    self->tail = sort.source[count - 1];
   }
+
+  free(items);
 }
 
 size_t plist_count_matching(plist *self, plist_evaluator condition) {
@@ -323,7 +562,12 @@ bool plist_all_match(plist *self, plist_evaluator condition) {
 }
 
 size_t plist_prepend(plist *self, void *data) {
-  plist_node *new_element = plist_create_node(data);
+  if (self->unrolled) {
+    plist_unrolled_prepend(self, data);
+    return self->elements_count;
+  }
+
+  plist_node *new_element = plist_create_node(self, data);
   new_element->next = self->head;
   self->head = new_element;
 
@@ -335,16 +579,166 @@ size_t plist_prepend(plist *self, void *data) {
   return self->elements_count;
 }
 
-/********* PRIVATE FUNCTIONS **************/
+bool plist_pool_stats(plist *self, ppool_stats *stats) {
+  if (!self || !self->pool) {
+    return false;
+  }
+
+  ppool_get_stats(self->pool, stats);
+  return true;
+}
+
+size_t plist_chunk_count(plist *self) {
+  size_t count = 0;
 
+  for (plist_chunk *chunk = self->first_chunk; chunk; chunk = chunk->next) {
+    ++count;
+  }
+  return count;
+}
+
+void plist_cursor_init(plist_cursor *cursor, plist *self) {
+  *cursor = (plist_cursor) {
+    .list = self,
+    .chunk = self->first_chunk,
+  };
+}
+
+bool plist_cursor_next(plist_cursor *cursor, void **data) {
+  if (cursor->list->unrolled) {
+    if (!plist_unrolled_cursor_advance(cursor)) {
+      cursor->has_current = false;
+      return false;
+    }
+
+    *data = cursor->chunk->data[cursor->slot++];
+    cursor->has_current = true;
+    return true;
+  }
+
+  plist_node *next = plist_cursor_upcoming(cursor);
+
+  if (!next) {
+    cursor->has_current = false;
+    return false;
+  }
+
+  if (cursor->current) {
+    cursor->previous = cursor->current;
+  }
+
+  cursor->current = next;
+  cursor->has_current = true;
+  *data = next->data;
+  return true;
+}
+
+void *plist_cursor_peek(plist_cursor *cursor) {
+  if (cursor->list->unrolled) {
+    plist_chunk *chunk = cursor->chunk;
+    size_t slot = cursor->slot;
+
+    while (chunk && slot == chunk->count) {
+      chunk = chunk->next;
+      slot = 0;
+    }
+
+    return chunk ? chunk->data[slot] : 0;
+  }
+
+  plist_node *next = plist_cursor_upcoming(cursor);
+  return next ? next->data : 0;
+}
+
+void *plist_cursor_remove_current(plist_cursor *cursor) {
+  plist *self = cursor->list;
+  void *data;
+
+  if (!cursor->has_current) {
+    return 0;
+  }
+
+  cursor->has_current = false;
+  self->elements_count--;
+
+  if (self->unrolled) {
+    plist_chunk *chunk = cursor->chunk;
+
+    data = chunk->data[--cursor->slot];
+    chunk->count--;
+    memmove(&chunk->data[cursor->slot], &chunk->data[cursor->slot + 1],
+            (chunk->count - cursor->slot) * sizeof(void *));
+
+    if (chunk->count == 0) {
+      plist_unrolled_cursor_unlink(cursor);
+    }
+    return data;
+  }
+
+  plist_node *element = cursor->current;
+
+  if (cursor->previous) {
+    plist_link_nodes(cursor->previous, element->next);
+  } else {
+    self->head = element->next;
+  }
+
+  if (self->tail == element) {
+    self->tail = cursor->previous;
+  }
+
+  data = element->data;
+  cursor->current = 0;
+  plist_free_node(self, element);
+  return data;
+}
+
+void plist_cursor_insert_after(plist_cursor *cursor, void *data) {
+  plist *self = cursor->list;
+
+  if (self->unrolled) {
+    if (!cursor->chunk) {
+      plist_unrolled_prepend(self, data);
+      cursor->chunk = self->first_chunk;
+      return;
+    }
+
+    plist_chunk *chunk = plist_unrolled_insert(self, cursor->chunk, &cursor->slot, data);
+
+    if (chunk != cursor->chunk) {
+      cursor->previous_chunk = cursor->chunk;
+      cursor->chunk = chunk;
+    }
+    return;
+  }
+
+  plist_node *before = cursor->current ? cursor->current : cursor->previous;
+  plist_node *element = plist_create_node(self, data);
+
+  if (before) {
+    plist_link_nodes(element, before->next);
+    plist_link_nodes(before, element);
+  } else {
+    plist_link_nodes(element, self->head);
+    self->head = element;
+  }
+
+  if (self->tail == before) {
+    self->tail = element;
+  }
+
+  self->elements_count++;
+}
+
+/********* PRIVATE FUNCTIONS **************/
 static void plist_link_nodes(plist_node *previous, plist_node *next) {
   if (previous) {
     previous->next = next;
   }
 }
 
-static plist_node *plist_create_node(void *data) {
-  plist_node *element = calloc(1, sizeof(plist_node));
+static plist_node *plist_create_node(plist *self, void *data) {
+  plist_node *element = self->pool ? ppool_alloc(self->pool) : calloc(1, sizeof(plist_node));
 
   if (element) {
     element->data = data;
@@ -354,6 +748,14 @@ static plist_node *plist_create_node(void *data) {
   return element;
 }
 
+static void plist_free_node(plist *self, plist_node *element) {
+  if (self->pool) {
+    ppool_free(self->pool, element);
+  } else {
+    free(element);
+  }
+}
+
 static plist_node *plist_get_node(plist *self, size_t index) {
   plist_node *element = 0;
   bool is_in_range = self->elements_count > index;
@@ -383,68 +785,713 @@ static plist_node *plist_find_node(plist *self, plist_evaluator condition,
     return 0;
   }
 
-  while (!condition(element->data)) {
+  while (element && !condition(element->data)) {
     element = element->next;
     position++;
   }
 
-  if (index) {
+  if (element && index) {
     *index = position;
   }
 
   return element;
 }
 
-static void plist_merge_sort(plist_node **headReference,
-                             plist_comparator comparator) {
-  plist_node *head = *headReference;
-  plist_node *a;
-  plist_node *b;
+/*
+ * Bottom up natural merge sort: splits the list into its sorted runs, then
+ * merges them TimSort style, keeping pending runs on a small fixed stack. It
+ * is stable, does not recurse, and a sorted (or reversed) list is done after
+ * a single pass.
+ */
+static void plist_natural_merge_sort(plist *self, plist_comparator comparator) {
+  plist_run runs[PLIST_SORT_MAX_RUNS];
+  size_t depth = 0;
+  plist_node *rest = self->head;
+
+  if (self->elements_count < 2) {
+    return;
+  }
+
+  while (rest) {
+    runs[depth++] = plist_take_run(&rest, comparator);
+    plist_collapse_runs(runs, &depth, comparator, false);
+  }
+
+  plist_collapse_runs(runs, &depth, comparator, true);
+  self->head = runs[0].head;
+  self->tail = runs[0].tail;
+}
+
+/*
+ * Detaches the run at the front of rest. Strictly descending runs are
+ * reversed, which cannot reorder equal elements, and short runs are extended
+ * to PLIST_SORT_MIN_RUN elements by insertion.
+ */
+static plist_run plist_take_run(plist_node **rest, plist_comparator comparator) {
+  plist_run run = {*rest, *rest, 1};
+  plist_node *next = run.head->next;
+
+  if (next && comparator(next->data, run.head->data)) {
+    while (next && comparator(next->data, run.head->data)) {
+      plist_node *after = next->next;
+      next->next = run.head;
+      run.head = next;
+      next = after;
+      run.length++;
+    }
+  } else {
+    while (next && !comparator(next->data, run.tail->data)) {
+      run.tail = next;
+      next = next->next;
+      run.length++;
+    }
+  }
+
+  while (next && run.length < PLIST_SORT_MIN_RUN) {
+    plist_node *after = next->next;
+
+    if (comparator(next->data, run.head->data)) {
+      next->next = run.head;
+      run.head = next;
+    } else {
+      plist_node *position = run.head;
+
+      while (position != run.tail && !comparator(next->data, position->next->data)) {
+        position = position->next;
+      }
+
+      if (position == run.tail) {
+        run.tail = next;
+      } else {
+        next->next = position->next;
+      }
+      position->next = next;
+    }
 
-  if (head == 0 || head->next == 0) {
+    next = after;
+    run.length++;
+  }
+
+  run.tail->next = 0;
+  *rest = next;
+  return run;
+}
+
+/*
+ * Merges pending runs until their lengths shrink fast enough from the bottom
+ * of the stack to the top (each one longer than the next two together), or
+ * down to a single run when forced. This is TimSort's merge_collapse.
+ */
+static void plist_collapse_runs(plist_run *runs, size_t *depth,
+                                plist_comparator comparator, bool force) {
+  while (*depth > 1) {
+    size_t n = *depth - 2;
+
+    if (force) {
+      if (n > 0 && runs[n - 1].length < runs[n + 1].length) {
+        n--;
+      }
+    } else if ((n > 0 && runs[n - 1].length <= runs[n].length + runs[n + 1].length) ||
+               (n > 1 && runs[n - 2].length <= runs[n - 1].length + runs[n].length)) {
+      if (runs[n - 1].length < runs[n + 1].length) {
+        n--;
+      }
+    } else if (runs[n].length > runs[n + 1].length) {
+      break;
+    }
+
+    runs[n] = plist_merge_runs(runs[n], runs[n + 1], comparator);
+    if (n + 2 < *depth) {
+      runs[n + 1] = runs[n + 2];
+    }
+    (*depth)--;
+  }
+}
+
+/* Stable: an element of right only goes first if it sorts strictly before */
+static plist_run plist_merge_runs(plist_run left, plist_run right,
+                                  plist_comparator comparator) {
+  plist_run merged = {0, 0, left.length + right.length};
+  plist_node head = {0};
+  plist_node *last = &head;
+  plist_node *a = left.head;
+  plist_node *b = right.head;
+
+  if (!comparator(b->data, left.tail->data)) {
+    left.tail->next = right.head;
+    merged.head = left.head;
+    merged.tail = right.tail;
+    return merged;
+  }
+
+  while (a && b) {
+    if (comparator(b->data, a->data)) {
+      last->next = b;
+      last = b;
+      b = b->next;
+    } else {
+      last->next = a;
+      last = a;
+      a = a->next;
+    }
+  }
+
+  last->next = a ? a : b;
+  merged.head = head.next;
+  merged.tail = a ? left.tail : right.tail;
+  return merged;
+}
+
+static plist *plist_create_like(plist *self) {
+  if (self && self->unrolled) {
+    return plist_create_unrolled();
+  }
+
+  return self && self->pool ? plist_create_pooled() : plist_create();
+}
+
+/* Node the next plist_cursor_next call returns on a linked list */
+static plist_node *plist_cursor_upcoming(plist_cursor *cursor) {
+  if (cursor->current) {
+    return cursor->current->next;
+  }
+
+  return cursor->previous ? cursor->previous->next : cursor->list->head;
+}
+
+static plist_walk plist_walk_start(plist *self) {
+  return (plist_walk) {
+    self->head, self->first_chunk, 0
+  };
+}
+
+/* Returns the slot holding the next element, or 0 once all were visited */
+static void **plist_walk_next(plist *self, plist_walk *walk) {
+  if (self->unrolled) {
+    while (walk->chunk && walk->slot == walk->chunk->count) {
+      walk->chunk = walk->chunk->next;
+      walk->slot = 0;
+    }
+
+    return walk->chunk ? &walk->chunk->data[walk->slot++] : 0;
+  }
+
+  plist_node *element = walk->node;
+
+  if (!element) {
+    return 0;
+  }
+
+  walk->node = element->next;
+  return &element->data;
+}
+
+static void **plist_get_slot(plist *self, size_t index) {
+  if (!self->unrolled) {
+    plist_node *element = plist_get_node(self, index);
+    return element ? &element->data : 0;
+  }
+
+  if (index >= self->elements_count) {
+    return 0;
+  }
+
+  plist_chunk *chunk = plist_unrolled_locate(self, &index, 0);
+  return &chunk->data[index];
+}
+
+/********* UNROLLED LAYOUT **************/
+
+static plist_chunk *plist_create_chunk(void) {
+  plist_chunk *chunk = aligned_alloc(64, sizeof(plist_chunk));
+
+  if (chunk) {
+    chunk->next = 0;
+    chunk->count = 0;
+  }
+
+  return chunk;
+}
+
+/*
+ * Returns the chunk holding element index (which must be in range) and turns
+ * index into its slot. The chunk before it is only looked for when previous
+ * is given, otherwise the last chunk is found without walking.
+ */
+static plist_chunk *plist_unrolled_locate(plist *self, size_t *index,
+                                          plist_chunk **previous) {
+  size_t last_first = self->elements_count - self->last_chunk->count;
+
+  if (!previous && *index >= last_first) {
+    *index -= last_first;
+    return self->last_chunk;
+  }
+
+  plist_chunk *before = 0;
+  plist_chunk *chunk = self->first_chunk;
+
+  while (*index >= chunk->count) {
+    *index -= chunk->count;
+    before = chunk;
+    chunk = chunk->next;
+  }
+
+  if (previous) {
+    *previous = before;
+  }
+
+  return chunk;
+}
+
+static void plist_unrolled_append(plist *self, void *data) {
+  if (!self->last_chunk || self->last_chunk->count == PLIST_CHUNK_SLOTS) {
+    plist_chunk *chunk = plist_create_chunk();
+
+    if (self->last_chunk) {
+      self->last_chunk->next = chunk;
+    } else {
+      self->first_chunk = chunk;
+    }
+    self->last_chunk = chunk;
+  }
+
+  self->last_chunk->data[self->last_chunk->count++] = data;
+  self->elements_count++;
+}
+
+static void plist_unrolled_prepend(plist *self, void *data) {
+  if (!self->first_chunk || self->first_chunk->count == PLIST_CHUNK_SLOTS) {
+    plist_chunk *chunk = plist_create_chunk();
+
+    chunk->next = self->first_chunk;
+    self->first_chunk = chunk;
+    if (!self->last_chunk) {
+      self->last_chunk = chunk;
+    }
+  }
+
+  plist_chunk *first = self->first_chunk;
+  memmove(&first->data[1], &first->data[0], first->count * sizeof(void *));
+  first->data[0] = data;
+  first->count++;
+  self->elements_count++;
+}
+
+static void plist_unrolled_add(plist *self, size_t index, void *data) {
+  if (index == self->elements_count) {
+    plist_unrolled_append(self, data);
     return;
   }
 
-  plist_front_back_split(head, &a, &b);
-  plist_merge_sort(&a, comparator);
-  plist_merge_sort(&b, comparator);
-  *headReference = plist_sorted_merge(a, b, comparator);
+  plist_chunk *chunk = plist_unrolled_locate(self, &index, 0);
+  plist_unrolled_insert(self, chunk, &index, data);
+}
+
+/*
+ * Inserts data before chunk->data[*slot], splitting a full chunk in halves to
+ * make room. Returns the chunk data ended up in and updates slot accordingly.
+ */
+static plist_chunk *plist_unrolled_insert(plist *self, plist_chunk *chunk,
+                                          size_t *slot, void *data) {
+  if (chunk->count == PLIST_CHUNK_SLOTS) {
+    plist_chunk *half = plist_create_chunk();
+    size_t keep = PLIST_CHUNK_SLOTS / 2;
+
+    half->count = PLIST_CHUNK_SLOTS - keep;
+    memcpy(half->data, &chunk->data[keep], half->count * sizeof(void *));
+    chunk->count = keep;
+    half->next = chunk->next;
+    chunk->next = half;
+
+    if (self->last_chunk == chunk) {
+      self->last_chunk = half;
+    }
+
+    if (*slot > keep) {
+      *slot -= keep;
+      chunk = half;
+    }
+  }
+
+  memmove(&chunk->data[*slot + 1], &chunk->data[*slot],
+          (chunk->count - *slot) * sizeof(void *));
+  chunk->data[*slot] = data;
+  chunk->count++;
+  self->elements_count++;
+  return chunk;
 }
 
-static plist_node *plist_sorted_merge(plist_node *self, plist_node *other,
-                                      plist_comparator comparator) {
+/*
+ * Chunks are freed once empty, and absorb the next one whenever both fit in
+ * a single chunk, so removals cannot leave a trail of nearly empty chunks.
+ */
+static void *plist_unrolled_remove(plist *self, size_t index) {
+  plist_chunk *previous;
+  plist_chunk *chunk = plist_unrolled_locate(self, &index, &previous);
+  void *data = chunk->data[index];
+
+  chunk->count--;
+  memmove(&chunk->data[index], &chunk->data[index + 1],
+          (chunk->count - index) * sizeof(void *));
+  self->elements_count--;
+
+  if (chunk->count == 0) {
+    plist_unrolled_unlink(self, chunk, previous);
+  } else if (chunk->next && chunk->count + chunk->next->count <= PLIST_CHUNK_SLOTS) {
+    plist_chunk *next = chunk->next;
 
-  if (!self || !other) {
-    return self ? self : other;
+    memcpy(&chunk->data[chunk->count], next->data, next->count * sizeof(void *));
+    chunk->count += next->count;
+    plist_unrolled_unlink(self, next, chunk);
   }
 
-  plist_node *result;
-  if (comparator(self->data, other->data)) {
-    result = self;
-    result->next = plist_sorted_merge(self->next, other, comparator);
+  return data;
+}
+
+static void plist_unrolled_unlink(plist *self, plist_chunk *chunk,
+                                  plist_chunk *previous) {
+  if (previous) {
+    previous->next = chunk->next;
   } else {
-    result = other;
-    result->next = plist_sorted_merge(self, other->next, comparator);
+    self->first_chunk = chunk->next;
   }
 
-  return result;
+  if (self->last_chunk == chunk) {
+    self->last_chunk = previous;
+  }
+
+  free(chunk);
 }
 
-static void plist_front_back_split(plist_node *source, plist_node **frontRef,
-                                   plist_node **backRef) {
-  plist_node *slow = source;
-  plist_node *fast = source->next;
+static void **plist_unrolled_find(plist *self, plist_evaluator condition,
+                                  size_t *index) {
+  size_t position = 0;
 
-  while (fast != 0) {
-    fast = fast->next;
+  if (!condition) {
+    return 0;
+  }
 
-    if (fast != 0) {
-      slow = slow->next;
-      fast = fast->next;
+  for (plist_chunk *chunk = self->first_chunk; chunk; chunk = chunk->next) {
+    for (size_t slot = 0; slot < chunk->count; ++slot, ++position) {
+      if (condition(chunk->data[slot])) {
+        if (index) {
+          *index = position;
+        }
+        return &chunk->data[slot];
+      }
+    }
+  }
+
+  return 0;
+}
+
+static void plist_unrolled_clean(plist *self) {
+  plist_chunk *chunk = self->first_chunk;
+
+  while (chunk) {
+    plist_chunk *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+
+  self->first_chunk = 0;
+  self->last_chunk = 0;
+  self->elements_count = 0;
+}
+
+/*
+ * Moves the cursor to the chunk holding the next element, returns false at
+ * the end of the list. Chunks left behind are tidied up on the way: empty
+ * ones are freed and the next chunk is merged in whenever both fit in one.
+ */
+static bool plist_unrolled_cursor_advance(plist_cursor *cursor) {
+  plist *self = cursor->list;
+  plist_chunk *chunk = cursor->chunk;
+
+  while (chunk && cursor->slot == chunk->count) {
+    plist_chunk *next = chunk->next;
+
+    if (!next) {
+      break;
+    }
+
+    if (chunk->count + next->count <= PLIST_CHUNK_SLOTS) {
+      memcpy(&chunk->data[chunk->count], next->data, next->count * sizeof(void *));
+      chunk->count += next->count;
+      plist_unrolled_unlink(self, next, chunk);
+    } else {
+      cursor->previous_chunk = chunk;
+      chunk = next;
+      cursor->slot = 0;
+    }
+  }
+
+  cursor->chunk = chunk;
+  return chunk && cursor->slot < chunk->count;
+}
+
+/*
+ * Frees the chunk the cursor emptied and moves the cursor to the start of the
+ * next one. Past the last chunk the cursor waits at the end of the previous
+ * one instead. previous_chunk is only needed to unlink a chunk, and that
+ * chunk keeps the elements already visited before the cursor, so it can not
+ * be emptied through the cursor again.
+ */
+static void plist_unrolled_cursor_unlink(plist_cursor *cursor) {
+  plist_chunk *chunk = cursor->chunk;
+  plist_chunk *previous = cursor->previous_chunk;
+  plist_chunk *next = chunk->next;
+
+  plist_unrolled_unlink(cursor->list, chunk, previous);
+
+  if (next || !previous) {
+    cursor->chunk = next;
+    cursor->slot = 0;
+  } else {
+    cursor->chunk = previous;
+    cursor->slot = previous->count;
+  }
+}
+
+/* Sorts the elements as an array, then writes them back in place */
+static void plist_unrolled_sort(plist *self, plist_comparator comparator) {
+  size_t count = self->elements_count;
+  void **items = malloc(count * 2 * sizeof(void *));
+
+  if (count < 2 || !items) {
+    free(items);
+    return;
+  }
+
+  plist_unrolled_gather(self, items);
+  plist_sort_array(items, items + count, count, comparator, false);
+  plist_unrolled_scatter(self, items);
+  free(items);
+}
+
+static void plist_unrolled_gather(plist *self, void **items) {
+  for (plist_chunk *chunk = self->first_chunk; chunk; chunk = chunk->next) {
+    memcpy(items, chunk->data, chunk->count * sizeof(void *));
+    items += chunk->count;
+  }
+}
+
+static void plist_unrolled_scatter(plist *self, void **items) {
+  for (plist_chunk *chunk = self->first_chunk; chunk; chunk = chunk->next) {
+    memcpy(chunk->data, items, chunk->count * sizeof(void *));
+    items += chunk->count;
+  }
+}
+
+/* What the comparator gets for an item of plist_sort_array */
+static inline void *plist_sort_key(void *item, bool nodes) {
+  return nodes ? ((plist_node *) item)->data : item;
+}
+
+/*
+ * Bottom up merge sort, ping-ponging between items and buffer (both count
+ * long). Stable: the right element only goes first if it compares strictly
+ * before the left one. Runs already in order are copied without merging.
+ */
+static void plist_sort_array(void **items, void **buffer, size_t count,
+                             plist_comparator comparator, bool nodes) {
+  void **from = items;
+  void **to = buffer;
+  size_t ordered = 1;
+  size_t descending = 1;
+
+  /* sorted and strictly descending input is handled in a single pass */
+  while (ordered < count && !comparator(plist_sort_key(items[ordered], nodes),
+                                        plist_sort_key(items[ordered - 1], nodes))) {
+    ordered++;
+  }
+  while (descending < count && comparator(plist_sort_key(items[descending], nodes),
+                                          plist_sort_key(items[descending - 1], nodes))) {
+    descending++;
+  }
+
+  if (ordered == count) {
+    return;
+  }
+
+  if (descending == count) {
+    for (size_t i = 0; i < count / 2; ++i) {
+      void *swap = items[i];
+      items[i] = items[count - 1 - i];
+      items[count - 1 - i] = swap;
+    }
+    return;
+  }
+
+  for (size_t width = 1; width < count; width *= 2) {
+    for (size_t low = 0; low < count; low += 2 * width) {
+      size_t middle = low + width < count ? low + width : count;
+      size_t high = middle + width < count ? middle + width : count;
+      size_t left = low, right = middle, out = low;
+
+      if (middle < high && !comparator(plist_sort_key(from[middle], nodes),
+                                       plist_sort_key(from[middle - 1], nodes))) {
+        memcpy(&to[low], &from[low], (high - low) * sizeof(void *));
+        continue;
+      }
+
+      while (left < middle && right < high) {
+        bool take_right = comparator(plist_sort_key(from[right], nodes),
+                                     plist_sort_key(from[left], nodes));
+        to[out++] = take_right ? from[right++] : from[left++];
+      }
+      while (left < middle) {
+        to[out++] = from[left++];
+      }
+      while (right < high) {
+        to[out++] = from[right++];
+      }
+    }
+
+    void **swap = from;
+    from = to;
+    to = swap;
+  }
+
+  if (from != items) {
+    memcpy(items, from, count * sizeof(void *));
+  }
+}
+
+/********* PARALLEL SORT **************/
+
+/* Runs phase on every worker, the calling thread being worker 0 */
+static void plist_parallel_run(plist_parallel *sort, void *(*phase)(void *)) {
+  plist_parallel_worker *workers = malloc(sort->nthreads * sizeof(plist_parallel_worker));
+  pthread_t *threads = malloc(sort->nthreads * sizeof(pthread_t));
+  bool *started = calloc(sort->nthreads, sizeof(bool));
+
+  for (size_t id = 0; id < sort->nthreads; ++id) {
+    workers[id] = (plist_parallel_worker) {
+      sort, id
+    };
+  }
+
+  for (size_t id = 1; id < sort->nthreads; ++id) {
+    started[id] = pthread_create(&threads[id], 0, phase, &workers[id]) == 0;
+  }
+
+  phase(&workers[0]);
+
+  for (size_t id = 1; id < sort->nthreads; ++id) {
+    if (started[id]) {
+      pthread_join(threads[id], 0);
+    } else {
+      phase(&workers[id]);
+    }
+  }
+
+  free(started);
+  free(threads);
+  free(workers);
+}
+
+/* First element of thread slice id, slices split the items evenly */
+static inline size_t plist_parallel_bound(plist_parallel *sort, size_t id) {
+  id = id < sort->nthreads ? id : sort->nthreads;
+  return sort->count * id / sort->nthreads;
+}
+
+static void *plist_parallel_sort_slice(void *arg) {
+  plist_parallel_worker *worker = arg;
+  plist_parallel *sort = worker->sort;
+  size_t low = plist_parallel_bound(sort, worker->id);
+  size_t high = plist_parallel_bound(sort, worker->id + 1);
+
+  plist_sort_array(sort->source + low, sort->target + low, high - low, sort->comparator,
+                   sort->nodes);
+  return 0;
+}
+
+/*
+ * Merges pairs of adjacent sorted runs, width slices long each. Rather than
+ * one thread per pair, which would leave all but one thread idle in the last
+ * rounds, every thread writes its own slice of the output and co-ranks where
+ * that slice starts and ends in the runs it comes from.
+ */
+static void *plist_parallel_merge_round(void *arg) {
+  plist_parallel_worker *worker = arg;
+  plist_parallel *sort = worker->sort;
+  size_t out_low = plist_parallel_bound(sort, worker->id);
+  size_t out_high = plist_parallel_bound(sort, worker->id + 1);
+
+  for (size_t pair = 0; pair < sort->nthreads; pair += 2 * sort->width) {
+    size_t low = plist_parallel_bound(sort, pair);
+    size_t middle = plist_parallel_bound(sort, pair + sort->width);
+    size_t high = plist_parallel_bound(sort, pair + 2 * sort->width);
+    size_t start = low > out_low ? low : out_low;
+    size_t end = high < out_high ? high : out_high;
+
+    if (start >= end) {
+      continue;
+    }
+
+    void **left = sort->source + low;
+    void **right = sort->source + middle;
+    size_t left_count = middle - low, right_count = high - middle;
+    size_t i = plist_parallel_co_rank(left, left_count, right, right_count, start - low,
+                                      sort->comparator, sort->nodes);
+    size_t i_end = plist_parallel_co_rank(left, left_count, right, right_count, end - low,
+                                          sort->comparator, sort->nodes);
+    size_t j = start - low - i;
+    size_t j_end = end - low - i_end;
+    void **out = sort->target + start;
+
+    while (i < i_end && j < j_end) {
+      bool take_right = sort->comparator(plist_sort_key(right[j], sort->nodes),
+                                         plist_sort_key(left[i], sort->nodes));
+      *out++ = take_right ? right[j++] : left[i++];
+    }
+    while (i < i_end) {
+      *out++ = left[i++];
     }
+    while (j < j_end) {
+      *out++ = right[j++];
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * How many of the first k elements of the stable merge of left and right come
+ * from left.
+ */
+static size_t plist_parallel_co_rank(void **left, size_t left_count, void **right,
+                                     size_t right_count, size_t k,
+                                     plist_comparator comparator, bool nodes) {
+  size_t low = k > right_count ? k - right_count : 0;
+  size_t high = k < left_count ? k : left_count;
+
+  while (low < high) {
+    size_t i = low + (high - low) / 2;
+
+    /* left[i] is among the first k unless right[k - i - 1] sorts before it */
+    if (!comparator(plist_sort_key(right[k - i - 1], nodes), plist_sort_key(left[i], nodes))) {
+      low = i + 1;
+    } else {
+      high = i;
+    }
+  }
+
+  return low;
+}
+
+static void *plist_parallel_link(void *arg) {
+  plist_parallel_worker *worker = arg;
+  plist_parallel *sort = worker->sort;
+  size_t low = plist_parallel_bound(sort, worker->id);
+  size_t high = plist_parallel_bound(sort, worker->id + 1);
+
+  for (size_t i = low; i < high; ++i) {
+    plist_node *element = sort->source[i];
+    element->next = i + 1 < sort->count ? sort->source[i + 1] : 0;
   }
 
-  *frontRef = source;
-  *backRef = slow->next;
-  slow->next = 0;
+  return 0;
 }
@@ -0,0 +1,132 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+#include "putils/ppool.h"
+#include <stdlib.h>
+
+#define PPOOL_DEFAULT_SLAB_OBJECTS 256
+
+/* Objects follow the header, which keeps them pointer aligned */
+typedef struct ppool_slab ppool_slab;
+struct ppool_slab {
+  ppool_slab *next;
+};
+
+/* Free objects store the next free one in their first bytes */
+typedef struct ppool_free_object ppool_free_object;
+struct ppool_free_object {
+  ppool_free_object *next;
+};
+
+struct ppool {
+  size_t object_size;
+  size_t slab_objects;
+  ppool_slab *slabs;
+  ppool_free_object *free_list;
+  /* never used objects left in the newest slab */
+  char *bump;
+  char *bump_end;
+  ppool_stats stats;
+};
+
+static void *ppool_refill(ppool *self);
+
+ppool *ppool_create(size_t object_size, size_t objects_per_slab) {
+  ppool *pool = calloc(1, sizeof(ppool));
+
+  if (pool) {
+    size_t word = sizeof(void *);
+    object_size = object_size < word ? word : object_size;
+    pool->object_size = (object_size + word - 1) / word * word;
+    pool->slab_objects = objects_per_slab ? objects_per_slab : PPOOL_DEFAULT_SLAB_OBJECTS;
+  }
+
+  return pool;
+}
+
+void *ppool_alloc(ppool *self) {
+  void *object;
+
+  if (self->free_list) {
+    object = self->free_list;
+    self->free_list = self->free_list->next;
+    self->stats.reuses++;
+  } else if (self->bump != self->bump_end) {
+    object = self->bump;
+    self->bump += self->object_size;
+  } else if (!(object = ppool_refill(self))) {
+    return 0;
+  }
+
+  self->stats.allocations++;
+  self->stats.in_use++;
+  return object;
+}
+
+void ppool_free(ppool *self, void *object) {
+  if (object) {
+    ppool_free_object *freed = object;
+    freed->next = self->free_list;
+    self->free_list = freed;
+    self->stats.in_use--;
+  }
+}
+
+void ppool_get_stats(ppool *self, ppool_stats *stats) {
+  *stats = self->stats;
+}
+
+double ppool_reuse_rate(ppool *self) {
+  if (self->stats.allocations == 0) {
+    return 0;
+  }
+
+  return (double) self->stats.reuses / (double) self->stats.allocations;
+}
+
+void ppool_destroy(ppool *self) {
+  if (!self) {
+    return;
+  }
+
+  while (self->slabs) {
+    ppool_slab *next = self->slabs->next;
+    free(self->slabs);
+    self->slabs = next;
+  }
+
+  free(self);
+}
+
+/********* PRIVATE FUNCTIONS **************/
+
+/* Allocates a slab and returns its first object, the rest is handed out lazily */
+static void *ppool_refill(ppool *self) {
+  size_t bytes = self->object_size * self->slab_objects;
+  ppool_slab *slab = malloc(sizeof(ppool_slab) + bytes);
+
+  if (!slab) {
+    return 0;
+  }
+
+  slab->next = self->slabs;
+  self->slabs = slab;
+  self->stats.slabs++;
+
+  char *objects = (char *)(slab + 1);
+  self->bump = objects + self->object_size;
+  self->bump_end = objects + bytes;
+  return objects;
+}
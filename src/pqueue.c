@@ -26,6 +26,12 @@ pqueue *pqueue_create() {
   return q;
 }
 
+pqueue *pqueue_create_pooled() {
+  pqueue *q = calloc(1, sizeof(pqueue));
+  q->list = plist_create_pooled();
+  return q;
+}
+
 size_t pqueue_enqueue(pqueue *self, void *data) {
   return plist_append(self->list, data);
 }
@@ -27,6 +27,13 @@ pstack *pstack_create() {
   return stack;
 }
 
+pstack *pstack_create_pooled() {
+  pstack *stack = calloc(1, sizeof(pstack));
+  stack->list = plist_create_pooled();
+
+  return stack;
+}
+
 size_t pstack_push(pstack *self, void *data) {
   return plist_prepend(self->list, data);
 }
@@ -0,0 +1,280 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pcache.h"
+#include "unity.h"
+#include <stdio.h>
+#include <string.h>
+
+#define KEYS_COUNT 1000
+#define NAME_LEN 16
+
+pcache *C = 0;
+size_t values[KEYS_COUNT];
+char evicted[KEYS_COUNT][NAME_LEN];
+size_t evicted_count = 0;
+
+static void recordEviction(char *key, void *value, void *ctx) {
+  snprintf(evicted[evicted_count++], NAME_LEN, "%s", key);
+  *(size_t *) ctx += 1;
+}
+
+static pcache *createCache(pcache_policy policy, size_t max_entries, size_t max_charge) {
+  static size_t callbacks = 0;
+
+  return pcache_create_with_options(&(pcache_options) {
+    .policy = policy,
+    .max_entries = max_entries,
+    .max_charge = max_charge,
+    .on_evict = recordEviction,
+    .ctx = &callbacks,
+  });
+}
+
+void setUp(void) {
+  C = 0;
+  evicted_count = 0;
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    values[i] = i;
+  }
+}
+
+void tearDown(void) {
+  if (C) {
+    pcache_destroy(C);
+  }
+}
+
+void test_lru_ShouldEvictTheLeastRecentlyUsedEntry(void) {
+  C = createCache(PCACHE_LRU, 3, 0);
+  pcache_put(C, "a", &values[0]);
+  pcache_put(C, "b", &values[1]);
+  pcache_put(C, "c", &values[2]);
+  TEST_ASSERT_EQUAL_PTR(&values[0], pcache_get_value(C, "a"));
+
+  pcache_put(C, "d", &values[3]);
+  TEST_ASSERT_EQUAL(1, evicted_count);
+  TEST_ASSERT_EQUAL_STRING("b", evicted[0]);
+  TEST_ASSERT_FALSE(pcache_has_key(C, "b"));
+
+  TEST_ASSERT_TRUE(pcache_touch(C, "c"));
+  pcache_put(C, "e", &values[4]);
+  TEST_ASSERT_EQUAL_STRING("a", evicted[1]);
+  TEST_ASSERT_EQUAL(3, pcache_size(C));
+}
+
+void test_clock_ShouldGiveReferencedEntriesASecondChance(void) {
+  C = createCache(PCACHE_CLOCK, 3, 0);
+  pcache_put(C, "a", &values[0]);
+  pcache_put(C, "b", &values[1]);
+  pcache_put(C, "c", &values[2]);
+  TEST_ASSERT_TRUE(pcache_touch(C, "a"));
+
+  pcache_put(C, "d", &values[3]);
+  TEST_ASSERT_EQUAL(1, evicted_count);
+  TEST_ASSERT_EQUAL_STRING("b", evicted[0]);
+  TEST_ASSERT_EQUAL_PTR(&values[0], pcache_peek(C, "a"));
+  TEST_ASSERT_EQUAL_PTR(&values[3], pcache_peek(C, "d"));
+}
+
+void test_s3fifo_ShouldKeepHitEntriesThroughAScan(void) {
+  char key[NAME_LEN];
+
+  C = createCache(PCACHE_S3FIFO, 10, 0);
+  pcache_put(C, "hot", &values[0]);
+  TEST_ASSERT_NOT_NULL(pcache_get_value(C, "hot"));
+
+  for (size_t i = 1; i < 100; ++i) {
+    snprintf(key, NAME_LEN, "cold%zu", i);
+    pcache_put(C, key, &values[i]);
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[0], pcache_peek(C, "hot"));
+  TEST_ASSERT_EQUAL(10, pcache_size(C));
+  TEST_ASSERT_EQUAL(90, evicted_count);
+}
+
+void test_s3fifo_ShouldAdmitRecentlyEvictedKeysToTheMainQueue(void) {
+  char key[NAME_LEN];
+
+  C = createCache(PCACHE_S3FIFO, 10, 0);
+  for (size_t i = 0; i < 11; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pcache_put(C, key, &values[i]);
+  }
+
+  TEST_ASSERT_EQUAL_STRING("key0", evicted[0]);
+  pcache_put(C, "key0", &values[0]);
+
+  for (size_t i = 11; i < 100; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pcache_put(C, key, &values[i]);
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[0], pcache_peek(C, "key0"));
+}
+
+void test_charge_ShouldKeepTheCacheWithinItsBudget(void) {
+  C = createCache(PCACHE_LRU, 0, 100);
+  pcache_put_charged(C, "a", &values[0], 40);
+  pcache_put_charged(C, "b", &values[1], 40);
+  pcache_put_charged(C, "c", &values[2], 40);
+  TEST_ASSERT_EQUAL(80, pcache_charge(C));
+  TEST_ASSERT_EQUAL_STRING("a", evicted[0]);
+
+  pcache_put_charged(C, "b", &values[3], 10);
+  TEST_ASSERT_EQUAL(50, pcache_charge(C));
+  TEST_ASSERT_EQUAL_STRING("b", evicted[1]);
+
+  pcache_put_charged(C, "huge", &values[4], 200);
+  TEST_ASSERT_FALSE(pcache_has_key(C, "huge"));
+  TEST_ASSERT_EQUAL(2, pcache_size(C));
+  TEST_ASSERT_EQUAL(50, pcache_charge(C));
+}
+
+void test_charge_ShouldRejectEntriesBiggerThanTheBudget(void) {
+  pcache_policy policies[] = {PCACHE_LRU, PCACHE_CLOCK, PCACHE_S3FIFO};
+  pcache_stats stats;
+
+  for (size_t p = 0; p < 3; ++p) {
+    C = createCache(policies[p], 0, 100);
+    evicted_count = 0;
+    pcache_put_charged(C, "a", &values[0], 30);
+    pcache_put_charged(C, "b", &values[1], 30);
+
+    pcache_put_charged(C, "huge", &values[2], 101);
+    TEST_ASSERT_EQUAL(1, evicted_count);
+    TEST_ASSERT_EQUAL_STRING("huge", evicted[0]);
+    TEST_ASSERT_FALSE(pcache_has_key(C, "huge"));
+    TEST_ASSERT_EQUAL(2, pcache_size(C));
+    TEST_ASSERT_EQUAL(60, pcache_charge(C));
+
+    /* replacing a cached key drops its old value too */
+    pcache_put_charged(C, "a", &values[3], 101);
+    TEST_ASSERT_EQUAL(3, evicted_count);
+    TEST_ASSERT_EQUAL_STRING("a", evicted[1]);
+    TEST_ASSERT_EQUAL_STRING("a", evicted[2]);
+    TEST_ASSERT_FALSE(pcache_has_key(C, "a"));
+    TEST_ASSERT_EQUAL_PTR(&values[1], pcache_peek(C, "b"));
+    TEST_ASSERT_EQUAL(1, pcache_size(C));
+    TEST_ASSERT_EQUAL(30, pcache_charge(C));
+
+    pcache_get_stats(C, &stats);
+    TEST_ASSERT_EQUAL(2, stats.insertions);
+    TEST_ASSERT_EQUAL(3, stats.evictions);
+    pcache_destroy(C);
+  }
+  C = 0;
+}
+
+void test_remove_ShouldHandTheValueBackWithoutEvicting(void) {
+  C = createCache(PCACHE_CLOCK, 3, 0);
+  pcache_put(C, "a", &values[0]);
+  pcache_put(C, "b", &values[1]);
+
+  TEST_ASSERT_EQUAL_PTR(&values[0], pcache_remove(C, "a"));
+  TEST_ASSERT_NULL(pcache_remove(C, "a"));
+  TEST_ASSERT_EQUAL(0, evicted_count);
+  TEST_ASSERT_EQUAL(1, pcache_size(C));
+  TEST_ASSERT_TRUE(pcache_evict(C));
+  TEST_ASSERT_FALSE(pcache_evict(C));
+  TEST_ASSERT_EQUAL_STRING("b", evicted[0]);
+}
+
+void test_stats_ShouldCountHitsMissesAndEvictions(void) {
+  pcache_stats stats;
+
+  C = createCache(PCACHE_LRU, 2, 0);
+  TEST_ASSERT_TRUE(pcache_hit_ratio(C) == 0.0);
+  pcache_put(C, "a", &values[0]);
+  pcache_put(C, "b", &values[1]);
+  pcache_put(C, "c", &values[2]);
+  pcache_get_value(C, "a");
+  pcache_get_value(C, "b");
+  pcache_get_value(C, "c");
+  pcache_peek(C, "a");
+
+  pcache_get_stats(C, &stats);
+  TEST_ASSERT_EQUAL(2, stats.hits);
+  TEST_ASSERT_EQUAL(1, stats.misses);
+  TEST_ASSERT_EQUAL(3, stats.insertions);
+  TEST_ASSERT_EQUAL(1, stats.evictions);
+  TEST_ASSERT_TRUE(pcache_hit_ratio(C) > 0.66 && pcache_hit_ratio(C) < 0.67);
+
+  pcache_reset_stats(C);
+  pcache_get_stats(C, &stats);
+  TEST_ASSERT_EQUAL(0, stats.hits + stats.misses + stats.insertions + stats.evictions);
+}
+
+void test_policies_ShouldStayConsistentUnderRandomOperations(void) {
+  pcache_policy policies[] = {PCACHE_LRU, PCACHE_CLOCK, PCACHE_S3FIFO};
+  char key[NAME_LEN];
+
+  for (size_t p = 0; p < 3; ++p) {
+    uint64_t seed = 7;
+    size_t removed = 0;
+    pcache_stats stats;
+
+    C = createCache(policies[p], 50, 0);
+    evicted_count = 0;
+
+    for (size_t i = 0; i < 20000; ++i) {
+      seed = seed * 6364136223846793005u + 1442695040888963407u;
+      size_t k = (seed >> 33) % 200;
+      snprintf(key, NAME_LEN, "key%zu", k);
+
+      switch ((seed >> 20) % 4) {
+        case 0:
+          pcache_put(C, key, &values[k]);
+          TEST_ASSERT_EQUAL_PTR(&values[k], pcache_peek(C, key));
+          break;
+        case 1:
+          removed += pcache_remove(C, key) != 0;
+          break;
+        default: {
+          void *value = pcache_get_value(C, key);
+          TEST_ASSERT_TRUE(value == 0 || value == &values[k]);
+        }
+      }
+
+      TEST_ASSERT_TRUE(pcache_size(C) <= 50);
+      evicted_count %= KEYS_COUNT;
+    }
+
+    pcache_get_stats(C, &stats);
+    TEST_ASSERT_EQUAL(stats.insertions, pcache_size(C) + stats.evictions + removed);
+    TEST_ASSERT_EQUAL(pcache_size(C), pcache_charge(C));
+    pcache_destroy(C);
+    C = 0;
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_lru_ShouldEvictTheLeastRecentlyUsedEntry);
+  RUN_TEST(test_clock_ShouldGiveReferencedEntriesASecondChance);
+  RUN_TEST(test_s3fifo_ShouldKeepHitEntriesThroughAScan);
+  RUN_TEST(test_s3fifo_ShouldAdmitRecentlyEvictedKeysToTheMainQueue);
+  RUN_TEST(test_charge_ShouldKeepTheCacheWithinItsBudget);
+  RUN_TEST(test_charge_ShouldRejectEntriesBiggerThanTheBudget);
+  RUN_TEST(test_remove_ShouldHandTheValueBackWithoutEvicting);
+  RUN_TEST(test_stats_ShouldCountHitsMissesAndEvictions);
+  RUN_TEST(test_policies_ShouldStayConsistentUnderRandomOperations);
+
+  return UNITY_END();
+}
@@ -178,6 +178,768 @@ void test_remove_ShouldRemoveAllElementsFromDict(void) {
   free_keys_data();
 }
 
+void test_get_ShouldNotMatchAKeyPrefix(void) {
+  size_t _data = 1;
+  pdict_put(D, "abcd", &_data);
+  TEST_ASSERT_NULL(pdict_get_value(D, "abc"));
+  TEST_ASSERT_EQUAL_PTR(&_data, pdict_get_value(D, "abcd"));
+}
+
+void test_openAddressing_ShouldGetAllValuesAfterGrowing(void) {
+  pdict *open = pdict_create_with_options(&(pdict_options) {
+    .mode = PDICT_OPEN_ADDRESSING
+  });
+  char key[KEYS_LEN];
+  size_t values[1000];
+
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(key, KEYS_LEN, "key_%zu", i);
+    values[i] = i;
+    pdict_put(open, key, &values[i]);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(1000, pdict_size(open));
+
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(key, KEYS_LEN, "key_%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], pdict_get_value(open, key));
+  }
+
+  TEST_ASSERT_NULL(pdict_get_value(open, "missing"));
+  pdict_destroy(open);
+}
+
+void test_openAddressing_ShouldRemoveAndReuseSlots(void) {
+  pdict *open = pdict_create_with_options(&(pdict_options) {
+    .mode = PDICT_OPEN_ADDRESSING
+  });
+  char key[KEYS_LEN];
+  size_t value = 42;
+
+  for (size_t round = 0; round < 50; ++round) {
+    for (size_t i = 0; i < 100; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      pdict_put(open, key, &value);
+    }
+
+    for (size_t i = 0; i < 100; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      TEST_ASSERT_EQUAL_PTR(&value, pdict_remove(open, key));
+      TEST_ASSERT_FALSE(pdict_has_key(open, key));
+    }
+  }
+
+  TEST_ASSERT_TRUE(pdict_is_empty(open));
+  pdict_destroy(open);
+}
+
+void test_openAddressing_ShouldIterateAndCleanAllEntries(void) {
+  pdict *open = pdict_create_with_options(&(pdict_options) {
+    .mode = PDICT_OPEN_ADDRESSING
+  });
+  char key[KEYS_LEN];
+
+  for (size_t i = 0; i < 100; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    pdict_put(open, key, calloc(1, sizeof(size_t)));
+  }
+
+  pdict_entries entries = pdict_get_all(open);
+  TEST_ASSERT_EQUAL_UINT(100, entries.count);
+
+  for (size_t i = 0; i < entries.count; ++i) {
+    TEST_ASSERT_EQUAL_PTR(entries.entries[i].value,
+                          pdict_get_value(open, entries.entries[i].key));
+  }
+
+  free(entries.entries);
+  pdict_clean_and_destroy_elements(open, free);
+  TEST_ASSERT_TRUE(pdict_is_empty(open));
+  TEST_ASSERT_NULL(pdict_get_value(open, "k1"));
+  pdict_destroy(open);
+}
+
+static size_t hasher_calls = 0;
+
+static uint64_t helper_constant_hasher(const void *key, size_t key_len, uint64_t seed) {
+  hasher_calls++;
+  return 7;
+}
+
+void test_hasher_ShouldUseTheGivenHashFunction(void) {
+  pdict *custom = pdict_create_with_hasher(helper_constant_hasher, 1);
+  size_t value = 1;
+  hasher_calls = 0;
+  pdict_put(custom, "a", &value);
+  pdict_get_value(custom, "a");
+  TEST_ASSERT_EQUAL_UINT(2, hasher_calls);
+  pdict_destroy(custom);
+}
+
+void test_hasher_ShouldHandleEveryKeyColliding(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *custom = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m],
+      .hasher = helper_constant_hasher,
+    });
+    char key[KEYS_LEN];
+    size_t values[100];
+
+    for (size_t i = 0; i < 100; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      values[i] = i;
+      pdict_put(custom, key, &values[i]);
+    }
+
+    for (size_t i = 0; i < 100; i += 2) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      TEST_ASSERT_EQUAL_PTR(&values[i], pdict_remove(custom, key));
+    }
+
+    for (size_t i = 1; i < 100; i += 2) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      TEST_ASSERT_EQUAL_PTR(&values[i], pdict_get_value(custom, key));
+    }
+
+    TEST_ASSERT_EQUAL_UINT(50, pdict_size(custom));
+    pdict_destroy(custom);
+  }
+}
+
+void test_incrementalRehash_ShouldKeepEveryEntryReachableWhileGrowing(void) {
+  pdict *incremental = pdict_create_with_options(&(pdict_options) {
+    .incremental_rehash = true
+  });
+  char key[KEYS_LEN];
+  size_t values[2000];
+  bool was_rehashing = false;
+
+  for (size_t i = 0; i < 2000; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    values[i] = i;
+    pdict_put(incremental, key, &values[i]);
+    was_rehashing |= pdict_is_rehashing(incremental);
+
+    for (size_t j = 0; j <= i; j += 97) {
+      snprintf(key, KEYS_LEN, "k%zu", j);
+      TEST_ASSERT_EQUAL_PTR(&values[j], pdict_get_value(incremental, key));
+    }
+  }
+
+  TEST_ASSERT_TRUE(was_rehashing);
+  TEST_ASSERT_EQUAL_UINT(2000, pdict_size(incremental));
+  pdict_destroy(incremental);
+}
+
+static size_t iterated = 0;
+
+static void helper_count(char *key, void *value) {
+  iterated++;
+}
+
+void test_incrementalRehash_ShouldIterateAndRemoveAcrossBothTables(void) {
+  pdict *incremental = pdict_create_with_options(&(pdict_options) {
+    .incremental_rehash = true
+  });
+  char key[KEYS_LEN];
+  size_t value = 1;
+  size_t count = 0;
+
+  while (!pdict_is_rehashing(incremental)) {
+    snprintf(key, KEYS_LEN, "k%zu", count++);
+    pdict_put(incremental, key, &value);
+  }
+
+  iterated = 0;
+  pdict_iterate(incremental, helper_count);
+  TEST_ASSERT_EQUAL_UINT(count, iterated);
+
+  pdict_entries entries = pdict_get_all(incremental);
+  TEST_ASSERT_EQUAL_UINT(count, entries.count);
+  free(entries.entries);
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&value, pdict_remove(incremental, key));
+  }
+
+  TEST_ASSERT_TRUE(pdict_is_empty(incremental));
+  pdict_destroy(incremental);
+}
+
+void test_rehashStep_ShouldFinishAPendingRehash(void) {
+  pdict *incremental = pdict_create_with_options(&(pdict_options) {
+    .incremental_rehash = true
+  });
+  char key[KEYS_LEN];
+  size_t value = 1;
+  size_t count = 0;
+
+  while (!pdict_is_rehashing(incremental)) {
+    snprintf(key, KEYS_LEN, "k%zu", count++);
+    pdict_put(incremental, key, &value);
+  }
+
+  while (pdict_rehash_step(incremental, 1));
+
+  TEST_ASSERT_FALSE(pdict_is_rehashing(incremental));
+  TEST_ASSERT_FALSE(pdict_rehash_step(incremental, 1));
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    TEST_ASSERT_TRUE(pdict_has_key(incremental, key));
+  }
+
+  pdict_destroy(incremental);
+}
+
+void test_put_ShouldReplaceTheValueOfAnExistingKey(void) {
+  size_t first = 1, second = 2;
+  pdict_put(D, "key", &first);
+  pdict_put(D, "key", &second);
+  TEST_ASSERT_EQUAL_UINT(1, pdict_size(D));
+  TEST_ASSERT_EQUAL_PTR(&second, pdict_get_value(D, "key"));
+}
+
+void test_upsert_ShouldReturnTheReplacedValue(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    size_t first = 1, second = 2;
+
+    TEST_ASSERT_NULL(pdict_upsert(dict, "key", &first));
+    TEST_ASSERT_EQUAL_PTR(&first, pdict_upsert(dict, "key", &second));
+    TEST_ASSERT_EQUAL_PTR(&second, pdict_get_value(dict, "key"));
+    TEST_ASSERT_EQUAL_UINT(1, pdict_size(dict));
+    pdict_destroy(dict);
+  }
+}
+
+void test_putIfAbsent_ShouldOnlyStoreMissingKeys(void) {
+  size_t first = 1, second = 2;
+  TEST_ASSERT_TRUE(pdict_put_if_absent(D, "key", &first));
+  TEST_ASSERT_FALSE(pdict_put_if_absent(D, "key", &second));
+  TEST_ASSERT_EQUAL_PTR(&first, pdict_get_value(D, "key"));
+  TEST_ASSERT_EQUAL_UINT(1, pdict_size(D));
+}
+
+void test_getOrInsert_ShouldReturnAWritableSlot(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    char key[KEYS_LEN];
+    size_t counters[10] = {0};
+    bool inserted;
+
+    for (size_t i = 0; i < 1000; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i % 10);
+      void **slot = pdict_get_or_insert(dict, key, &inserted);
+      TEST_ASSERT_EQUAL(i < 10, inserted);
+
+      if (inserted) {
+        TEST_ASSERT_NULL(*slot);
+        *slot = &counters[i % 10];
+      }
+
+      (*(size_t *) *slot)++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT(10, pdict_size(dict));
+    for (size_t i = 0; i < 10; ++i) {
+      TEST_ASSERT_EQUAL_UINT(100, counters[i]);
+    }
+
+    pdict_destroy(dict);
+  }
+}
+
+static size_t destroyed_values = 0;
+
+static void countDestroyedValue(void *value) {
+  (void) value;
+  ++destroyed_values;
+}
+
+void test_remove_ShouldCountKeysHoldingNullValues(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    bool inserted;
+
+    pdict_get_or_insert(dict, "a", &inserted);
+    pdict_put(dict, "b", 0);
+    TEST_ASSERT_EQUAL_UINT(2, pdict_size(dict));
+
+    TEST_ASSERT_NULL(pdict_remove(dict, "a"));
+    TEST_ASSERT_FALSE(pdict_has_key(dict, "a"));
+    TEST_ASSERT_EQUAL_UINT(1, pdict_size(dict));
+    TEST_ASSERT_NULL(pdict_remove(dict, "a"));
+    TEST_ASSERT_EQUAL_UINT(1, pdict_size(dict));
+
+    destroyed_values = 0;
+    pdict_remove_and_destroy(dict, "b", countDestroyedValue);
+    pdict_remove_and_destroy(dict, "b", countDestroyedValue);
+    TEST_ASSERT_EQUAL_UINT(1, destroyed_values);
+    TEST_ASSERT_TRUE(pdict_is_empty(dict));
+
+    pdict_destroy(dict);
+  }
+}
+
+void test_upsert_ShouldUpdateKeysNotMigratedYet(void) {
+  pdict *incremental = pdict_create_with_options(&(pdict_options) {
+    .incremental_rehash = true
+  });
+  char key[KEYS_LEN];
+  size_t first = 1, second = 2;
+  size_t count = 0;
+
+  while (!pdict_is_rehashing(incremental)) {
+    snprintf(key, KEYS_LEN, "k%zu", count++);
+    pdict_put(incremental, key, &first);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&first, pdict_upsert(incremental, key, &second));
+  }
+
+  TEST_ASSERT_EQUAL_UINT(count, pdict_size(incremental));
+  pdict_destroy(incremental);
+}
+
+void test_binaryKeys_ShouldAllowEmbeddedNulBytes(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    const unsigned char first[] = {0x00, 0x01, 0x00, 0x02};
+    const unsigned char second[] = {0x00, 0x01, 0x00, 0x03};
+    size_t a = 1, b = 2;
+
+    pdict_put_n(dict, first, sizeof(first), &a);
+    pdict_put_n(dict, second, sizeof(second), &b);
+
+    TEST_ASSERT_EQUAL_UINT(2, pdict_size(dict));
+    TEST_ASSERT_EQUAL_PTR(&a, pdict_get_n(dict, first, sizeof(first)));
+    TEST_ASSERT_EQUAL_PTR(&b, pdict_get_n(dict, second, sizeof(second)));
+    TEST_ASSERT_NULL(pdict_get_n(dict, first, 0));
+    TEST_ASSERT_NULL(pdict_get_n(dict, first, 1));
+
+    TEST_ASSERT_EQUAL_PTR(&a, pdict_remove_n(dict, first, sizeof(first)));
+    TEST_ASSERT_NULL(pdict_get_n(dict, first, sizeof(first)));
+    TEST_ASSERT_EQUAL_UINT(1, pdict_size(dict));
+    pdict_destroy(dict);
+  }
+}
+
+void test_binaryKeys_ShouldCompareLengthBeforeBytes(void) {
+  const char key[] = "prefix_and_more";
+  size_t shorter = 1, longer = 2;
+
+  pdict_put_n(D, key, 6, &shorter);
+  pdict_put_n(D, key, sizeof(key) - 1, &longer);
+
+  TEST_ASSERT_EQUAL_UINT(2, pdict_size(D));
+  TEST_ASSERT_EQUAL_PTR(&shorter, pdict_get_value(D, "prefix"));
+  TEST_ASSERT_EQUAL_PTR(&longer, pdict_get_value(D, "prefix_and_more"));
+
+  pdict_entry entry = pdict_get(D, "prefix");
+  TEST_ASSERT_EQUAL_UINT(6, entry.key_len);
+  TEST_ASSERT_EQUAL_STRING("prefix", entry.key);
+}
+
+void test_keys_ShouldKeepShortAndLongKeysAcrossResizes(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+  size_t lengths[] = {0, 1, PDICT_INLINE_KEY_LEN - 2, PDICT_INLINE_KEY_LEN - 1,
+                      PDICT_INLINE_KEY_LEN, 100
+                     };
+  char key[128];
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    size_t values[6][200];
+
+    for (size_t i = 0; i < 200; ++i) {
+      for (size_t l = 0; l < 6; ++l) {
+        memset(key, 'x', sizeof(key));
+        snprintf(key, sizeof(key), "%zu", i);
+        key[strlen(key)] = 'x';
+        values[l][i] = i;
+        pdict_put_n(dict, key, lengths[l], &values[l][i]);
+      }
+    }
+
+    /* length 0 and 1 keys collapse into a handful of distinct keys */
+    for (size_t i = 0; i < 200; ++i) {
+      for (size_t l = 2; l < 6; ++l) {
+        memset(key, 'x', sizeof(key));
+        snprintf(key, sizeof(key), "%zu", i);
+        key[strlen(key)] = 'x';
+        TEST_ASSERT_EQUAL_PTR(&values[l][i], pdict_get_n(dict, key, lengths[l]));
+      }
+    }
+
+    pdict_entries entries = pdict_get_all(dict);
+    for (size_t i = 0; i < entries.count; ++i) {
+      TEST_ASSERT_EQUAL_UINT(strlen(entries.entries[i].key), entries.entries[i].key_len);
+      TEST_ASSERT_EQUAL_PTR(entries.entries[i].value,
+                            pdict_get_n(dict, entries.entries[i].key, entries.entries[i].key_len));
+    }
+
+    free(entries.entries);
+    pdict_destroy(dict);
+  }
+}
+
+void test_capacity_ShouldHoldTheRequestedElementsWithoutGrowing(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m],
+      .capacity = 5000,
+    });
+    size_t capacity = pdict_capacity(dict);
+    char key[KEYS_LEN];
+    size_t value = 1;
+
+    TEST_ASSERT_TRUE(capacity >= 5000);
+
+    for (size_t i = 0; i < 5000; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      pdict_put(dict, key, &value);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(capacity, pdict_capacity(dict));
+    pdict_destroy(dict);
+  }
+}
+
+void test_reserve_ShouldGrowOnlyOnce(void) {
+  char key[KEYS_LEN];
+  size_t value = 1;
+
+  pdict_reserve(D, 3000);
+  size_t capacity = pdict_capacity(D);
+  TEST_ASSERT_TRUE(capacity >= 3000);
+
+  for (size_t i = 0; i < 3000; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    pdict_put(D, key, &value);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(capacity, pdict_capacity(D));
+  pdict_reserve(D, 10);
+  TEST_ASSERT_EQUAL_UINT(capacity, pdict_capacity(D));
+}
+
+void test_shrinkToFit_ShouldKeepTheRemainingEntries(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&(pdict_options) {
+      .mode = modes[m]
+    });
+    char key[KEYS_LEN];
+    size_t value = 1;
+
+    for (size_t i = 0; i < 1000; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      pdict_put(dict, key, &value);
+    }
+
+    for (size_t i = 10; i < 1000; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      pdict_remove(dict, key);
+    }
+
+    size_t before = pdict_capacity(dict);
+    pdict_shrink_to_fit(dict);
+    TEST_ASSERT_TRUE(pdict_capacity(dict) < before);
+    TEST_ASSERT_TRUE(pdict_capacity(dict) >= 10);
+
+    for (size_t i = 0; i < 10; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      TEST_ASSERT_EQUAL_PTR(&value, pdict_get_value(dict, key));
+    }
+
+    pdict_destroy(dict);
+  }
+}
+
+void test_maxLoadFactor_ShouldBeTunable(void) {
+  pdict *dense = pdict_create_with_options(&(pdict_options) {
+    .capacity = 100,
+    .max_load_factor = 4.0,
+  });
+  pdict *open = pdict_create_with_options(&(pdict_options) {
+    .mode = PDICT_OPEN_ADDRESSING,
+    .max_load_factor = 2.0,
+  });
+
+  TEST_ASSERT_TRUE(pdict_max_load_factor(dense) == 4.0);
+  TEST_ASSERT_TRUE(pdict_capacity(dense) >= 100);
+  TEST_ASSERT_TRUE(pdict_max_load_factor(open) < 1.0);
+
+  pdict_set_max_load_factor(dense, 0.5);
+  TEST_ASSERT_TRUE(pdict_max_load_factor(dense) == 0.5);
+
+  char key[KEYS_LEN];
+  size_t value = 1;
+
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(key, KEYS_LEN, "k%zu", i);
+    pdict_put(dense, key, &value);
+    pdict_put(open, key, &value);
+  }
+
+  TEST_ASSERT_TRUE(pdict_capacity(dense) >= 1000);
+  TEST_ASSERT_TRUE(pdict_capacity(open) >= 1000);
+  pdict_destroy(dense);
+  pdict_destroy(open);
+}
+
+static void helper_sum(char *key, void *value, void *ctx) {
+  *(size_t *) ctx += *(size_t *) value;
+}
+
+void test_iter_ShouldVisitEveryEntryOnce(void) {
+  pdict_options options[] = {
+    {.mode = PDICT_CHAINED},
+    {.mode = PDICT_OPEN_ADDRESSING},
+    {.incremental_rehash = true},
+  };
+  size_t values[500];
+
+  for (size_t m = 0; m < 3; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+    char key[KEYS_LEN];
+    size_t count = 0;
+
+    /* the incremental dict is left in the middle of a rehash */
+    while (count < 500 && (m < 2 || !pdict_is_rehashing(dict) || count < 40)) {
+      values[count] = count;
+      snprintf(key, KEYS_LEN, "k%zu", count);
+      pdict_put(dict, key, &values[count++]);
+    }
+
+    if (m == 2) {
+      TEST_ASSERT_TRUE(pdict_is_rehashing(dict));
+    }
+
+    bool seen[500] = {0};
+    size_t visited = 0;
+    pdict_iter iter;
+    pdict_entry entry;
+
+    pdict_iter_init(&iter, dict);
+
+    while (pdict_iter_next(&iter, &entry)) {
+      size_t value = *(size_t *) entry.value;
+      TEST_ASSERT_FALSE(seen[value]);
+      snprintf(key, KEYS_LEN, "k%zu", value);
+      TEST_ASSERT_EQUAL_STRING(key, entry.key);
+      TEST_ASSERT_EQUAL_UINT(strlen(key), entry.key_len);
+      seen[value] = true;
+      visited++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT(count, visited);
+    TEST_ASSERT_FALSE(pdict_iter_next(&iter, &entry));
+
+    size_t sum = 0;
+    pdict_iterate_with_context(dict, helper_sum, &sum);
+    TEST_ASSERT_EQUAL_UINT(count * (count - 1) / 2, sum);
+    pdict_destroy(dict);
+  }
+}
+
+void test_iter_ShouldStopRightAwayOnAnEmptyDict(void) {
+  pdict_iter iter;
+  pdict_entry entry;
+
+  pdict_iter_init(&iter, D);
+  TEST_ASSERT_FALSE(pdict_iter_next(&iter, &entry));
+}
+
+void test_getMany_ShouldMatchSingleLookups(void) {
+  pdict_options options[] = {
+    {.mode = PDICT_CHAINED},
+    {.mode = PDICT_OPEN_ADDRESSING},
+    {.incremental_rehash = true},
+  };
+  size_t values[300];
+  char keys[300][KEYS_LEN];
+  const void *key_pointers[300];
+  size_t lens[300];
+  void *out[300];
+
+  for (size_t i = 0; i < 300; ++i) {
+    values[i] = i;
+    snprintf(keys[i], KEYS_LEN, "k%zu", i);
+    key_pointers[i] = keys[i];
+    lens[i] = strlen(keys[i]);
+  }
+
+  for (size_t m = 0; m < 3; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+
+    /* only even keys are stored, odd ones must come back as misses */
+    for (size_t i = 0; i < 300; i += 2) {
+      pdict_put(dict, keys[i], &values[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(150, pdict_get_many(dict, key_pointers, lens, 300, (void **) out));
+
+    for (size_t i = 0; i < 300; ++i) {
+      TEST_ASSERT_EQUAL_PTR(pdict_get_value(dict, keys[i]), out[i]);
+      TEST_ASSERT_EQUAL_PTR(i % 2 ? 0 : &values[i], out[i]);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(3, pdict_get_many(dict, key_pointers + 10, 0, 5, (void **) out));
+    TEST_ASSERT_EQUAL_PTR(&values[10], out[0]);
+    TEST_ASSERT_NULL(out[1]);
+    pdict_destroy(dict);
+  }
+}
+
+void test_bulkLoad_ShouldMatchSequentialPuts(void) {
+  pdict_options options[] = {
+    {.mode = PDICT_CHAINED},
+    {.mode = PDICT_OPEN_ADDRESSING},
+    {.mode = PDICT_CHAINED, .incremental_rehash = true},
+  };
+  size_t threads[] = {1, 3, 8};
+  enum { BULK_COUNT = 3000, BULK_KEY_LEN = 40 };
+  static char keys[BULK_COUNT][BULK_KEY_LEN];
+  static const void *key_pointers[BULK_COUNT];
+  static size_t values[BULK_COUNT];
+  static void *value_pointers[BULK_COUNT];
+
+  /* every tenth key repeats an earlier one, some keys are too long to inline */
+  for (size_t i = 0; i < BULK_COUNT; ++i) {
+    size_t id = i % 10 == 9 ? i / 2 : i;
+    snprintf(keys[i], BULK_KEY_LEN, id % 3 ? "k%zu" : "a-rather-long-key-number-%zu", id);
+    key_pointers[i] = keys[i];
+    values[i] = i;
+    value_pointers[i] = &values[i];
+  }
+
+  for (size_t m = 0; m < 3; ++m) {
+    for (size_t t = 0; t < 3; ++t) {
+      pdict *expected = pdict_create_with_options(&options[m]);
+      bool rehashed = false;
+      pdict *dict = pdict_bulk_load_with_options(&options[m], key_pointers, 0, value_pointers,
+                    BULK_COUNT, threads[t]);
+
+      for (size_t i = 0; i < BULK_COUNT; ++i) {
+        pdict_put(expected, keys[i], &values[i]);
+      }
+
+      TEST_ASSERT_EQUAL_UINT(pdict_size(expected), pdict_size(dict));
+      for (size_t i = 0; i < BULK_COUNT; ++i) {
+        TEST_ASSERT_EQUAL_PTR(pdict_get_value(expected, keys[i]), pdict_get_value(dict, keys[i]));
+      }
+
+      /* slab nodes and keys must survive removals, growth and new puts */
+      for (size_t i = 0; i < BULK_COUNT; i += 4) {
+        pdict_remove(dict, keys[i]);
+        pdict_remove(expected, keys[i]);
+      }
+      for (size_t i = 0; i < BULK_COUNT; ++i) {
+        char key[BULK_KEY_LEN];
+        snprintf(key, BULK_KEY_LEN, "extra-key-that-is-long-enough-%zu", i);
+        pdict_put(dict, key, &values[i]);
+        rehashed = rehashed || pdict_is_rehashing(dict);
+      }
+
+      /* the build itself never rehashes, later growth follows the options */
+      TEST_ASSERT_EQUAL(options[m].incremental_rehash, rehashed);
+      TEST_ASSERT_EQUAL_UINT(pdict_size(expected) + BULK_COUNT, pdict_size(dict));
+      for (size_t i = 0; i < BULK_COUNT; ++i) {
+        TEST_ASSERT_EQUAL_PTR(pdict_get_value(expected, keys[i]), pdict_get_value(dict, keys[i]));
+      }
+
+      pdict_destroy(expected);
+      pdict_destroy(dict);
+    }
+  }
+
+  pdict *empty = pdict_bulk_load(key_pointers, 0, value_pointers, 0, 4);
+  TEST_ASSERT_TRUE(pdict_is_empty(empty));
+  pdict_destroy(empty);
+}
+
+void test_stats_ShouldDescribeTheTableShape(void) {
+  pdict_options options[] = {
+    {.mode = PDICT_CHAINED, .capacity = 100},
+    {.mode = PDICT_OPEN_ADDRESSING, .capacity = 100},
+  };
+  char long_key[40];
+
+  memset(long_key, 'x', sizeof(long_key) - 1);
+  long_key[sizeof(long_key) - 1] = '\0';
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+    pdict_statistics stats;
+    char key[KEYS_LEN];
+    size_t total = 0;
+
+    for (size_t i = 0; i < 100; ++i) {
+      snprintf(key, KEYS_LEN, "k%zu", i);
+      pdict_put(dict, key, dict);
+    }
+    pdict_put(dict, long_key, dict);
+    pdict_remove(dict, "k0");
+
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_EQUAL(options[m].mode, stats.mode);
+    TEST_ASSERT_EQUAL_UINT(100, stats.elements);
+    TEST_ASSERT_EQUAL_UINT(sizeof(long_key), stats.key_bytes);
+    TEST_ASSERT_TRUE(stats.max_length >= 1);
+    TEST_ASSERT_TRUE(stats.bucket_bytes >= stats.buckets * sizeof(pdict_node *));
+    if (!stats.counters_enabled) {
+      TEST_ASSERT_EQUAL_UINT(0, stats.hits + stats.misses + stats.resizes);
+    }
+
+    if (stats.mode == PDICT_CHAINED) {
+      /* buckets by chain length: nodes add up to the element count */
+      for (size_t i = 0; i < PDICT_STATS_HISTOGRAM; ++i) {
+        total += i * stats.length_histogram[i];
+      }
+      TEST_ASSERT_EQUAL_UINT(100 * sizeof(pdict_node), stats.node_bytes);
+      TEST_ASSERT_EQUAL_UINT(stats.buckets - stats.length_histogram[0], stats.used_buckets);
+    } else {
+      /* elements by probe length */
+      for (size_t i = 0; i < PDICT_STATS_HISTOGRAM; ++i) {
+        total += stats.length_histogram[i];
+      }
+      TEST_ASSERT_EQUAL_UINT(0, stats.length_histogram[0]);
+      TEST_ASSERT_EQUAL_UINT(0, stats.node_bytes);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(100, total);
+    pdict_destroy(dict);
+  }
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_create_NewDictShouldBeEmpty);
@@ -203,6 +965,44 @@ int main(void) {
   RUN_TEST(test_getAll_ShouldNotErrorWithANullDict);
 
   RUN_TEST(test_remove_ShouldRemoveAllElementsFromDict);
+
+  RUN_TEST(test_get_ShouldNotMatchAKeyPrefix);
+
+  RUN_TEST(test_openAddressing_ShouldGetAllValuesAfterGrowing);
+  RUN_TEST(test_openAddressing_ShouldRemoveAndReuseSlots);
+  RUN_TEST(test_openAddressing_ShouldIterateAndCleanAllEntries);
+
+  RUN_TEST(test_hasher_ShouldUseTheGivenHashFunction);
+  RUN_TEST(test_hasher_ShouldHandleEveryKeyColliding);
+
+  RUN_TEST(test_incrementalRehash_ShouldKeepEveryEntryReachableWhileGrowing);
+  RUN_TEST(test_incrementalRehash_ShouldIterateAndRemoveAcrossBothTables);
+  RUN_TEST(test_rehashStep_ShouldFinishAPendingRehash);
+
+  RUN_TEST(test_put_ShouldReplaceTheValueOfAnExistingKey);
+  RUN_TEST(test_upsert_ShouldReturnTheReplacedValue);
+  RUN_TEST(test_putIfAbsent_ShouldOnlyStoreMissingKeys);
+  RUN_TEST(test_getOrInsert_ShouldReturnAWritableSlot);
+  RUN_TEST(test_remove_ShouldCountKeysHoldingNullValues);
+  RUN_TEST(test_upsert_ShouldUpdateKeysNotMigratedYet);
+
+  RUN_TEST(test_binaryKeys_ShouldAllowEmbeddedNulBytes);
+  RUN_TEST(test_binaryKeys_ShouldCompareLengthBeforeBytes);
+
+  RUN_TEST(test_keys_ShouldKeepShortAndLongKeysAcrossResizes);
+
+  RUN_TEST(test_capacity_ShouldHoldTheRequestedElementsWithoutGrowing);
+  RUN_TEST(test_reserve_ShouldGrowOnlyOnce);
+  RUN_TEST(test_shrinkToFit_ShouldKeepTheRemainingEntries);
+  RUN_TEST(test_maxLoadFactor_ShouldBeTunable);
+
+  RUN_TEST(test_iter_ShouldVisitEveryEntryOnce);
+  RUN_TEST(test_iter_ShouldStopRightAwayOnAnEmptyDict);
+
+  RUN_TEST(test_getMany_ShouldMatchSingleLookups);
+
+  RUN_TEST(test_bulkLoad_ShouldMatchSequentialPuts);
+  RUN_TEST(test_stats_ShouldDescribeTheTableShape);
   return UNITY_END();
 }
 
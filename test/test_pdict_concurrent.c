@@ -0,0 +1,181 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_concurrent.h"
+#include "putils/phash.h"
+#include "unity.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#define THREADS_COUNT 8
+#define KEYS_PER_THREAD 2000
+#define NAME_LEN 24
+
+pdict_concurrent *D = 0;
+
+void setUp(void) { D = pdict_concurrent_create(0); }
+
+void tearDown(void) { pdict_concurrent_destroy(D); }
+
+void test_create_ShouldRoundShardsToAPowerOfTwo(void) {
+  pdict_concurrent *dict = pdict_concurrent_create(5);
+
+  TEST_ASSERT_EQUAL_UINT(PDICT_CONCURRENT_DEFAULT_SHARDS, pdict_concurrent_shard_count(D));
+  TEST_ASSERT_EQUAL_UINT(8, pdict_concurrent_shard_count(dict));
+  pdict_concurrent_destroy(dict);
+}
+
+void test_put_ShouldBehaveLikeAPdict(void) {
+  size_t values[3] = {0, 1, 2};
+
+  pdict_concurrent_put(D, "a", &values[0]);
+  TEST_ASSERT_EQUAL_PTR(&values[0], pdict_concurrent_upsert(D, "a", &values[1]));
+  TEST_ASSERT_FALSE(pdict_concurrent_put_if_absent(D, "a", &values[2]));
+  TEST_ASSERT_TRUE(pdict_concurrent_put_if_absent(D, "b", &values[2]));
+
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_concurrent_get_value(D, "a"));
+  TEST_ASSERT_TRUE(pdict_concurrent_has_key(D, "b"));
+  TEST_ASSERT_EQUAL_UINT(2, pdict_concurrent_size(D));
+
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_concurrent_remove(D, "b"));
+  TEST_ASSERT_NULL(pdict_concurrent_get_value(D, "b"));
+  TEST_ASSERT_EQUAL_UINT(1, pdict_concurrent_size(D));
+}
+
+static void *helper_writer(void *arg) {
+  uintptr_t thread = (uintptr_t) arg;
+  char key[NAME_LEN];
+
+  for (uintptr_t i = 0; i < KEYS_PER_THREAD; ++i) {
+    snprintf(key, NAME_LEN, "t%zu-%zu", (size_t) thread, (size_t) i);
+    pdict_concurrent_put(D, key, (void *)(i + 1));
+
+    /* read back a key written by this thread and one that may be in flight */
+    if ((uintptr_t) pdict_concurrent_get_value(D, key) != i + 1) {
+      return (void *) 1;
+    }
+
+    snprintf(key, NAME_LEN, "t%zu-%zu", (size_t)((thread + 1) % THREADS_COUNT), (size_t) i);
+    pdict_concurrent_get_value(D, key);
+  }
+
+  for (uintptr_t i = 0; i < KEYS_PER_THREAD; i += 2) {
+    snprintf(key, NAME_LEN, "t%zu-%zu", (size_t) thread, (size_t) i);
+
+    if ((uintptr_t) pdict_concurrent_remove(D, key) != i + 1) {
+      return (void *) 1;
+    }
+  }
+
+  return 0;
+}
+
+void test_threads_ShouldNotLoseWrites(void) {
+  pthread_t threads[THREADS_COUNT];
+  char key[NAME_LEN];
+
+  for (uintptr_t i = 0; i < THREADS_COUNT; ++i) {
+    pthread_create(&threads[i], 0, helper_writer, (void *) i);
+  }
+
+  for (size_t i = 0; i < THREADS_COUNT; ++i) {
+    void *failed;
+    pthread_join(threads[i], &failed);
+    TEST_ASSERT_NULL(failed);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(THREADS_COUNT * KEYS_PER_THREAD / 2, pdict_concurrent_size(D));
+
+  for (size_t thread = 0; thread < THREADS_COUNT; ++thread) {
+    for (size_t i = 0; i < KEYS_PER_THREAD; ++i) {
+      snprintf(key, NAME_LEN, "t%zu-%zu", thread, i);
+      TEST_ASSERT_EQUAL_PTR(i % 2 ? (void *)(i + 1) : 0, pdict_concurrent_get_value(D, key));
+    }
+  }
+}
+
+static void helper_count(char *key, void *value, void *ctx) {
+  (*(size_t *) ctx)++;
+}
+
+void test_iterate_ShouldVisitEveryShard(void) {
+  pdict_concurrent *dict = pdict_concurrent_create_with_options(&(pdict_options) {
+    .mode = PDICT_OPEN_ADDRESSING,
+    .capacity = 1000,
+  }, 4);
+  char key[NAME_LEN];
+  size_t count = 0;
+
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(key, NAME_LEN, "k%zu", i);
+    pdict_concurrent_put(dict, key, dict);
+  }
+
+  pdict_concurrent_iterate_with_context(dict, helper_count, &count);
+  TEST_ASSERT_EQUAL_UINT(1000, count);
+  pdict_concurrent_destroy(dict);
+}
+
+void test_createWithOptions_ShouldAcceptNullOptions(void) {
+  pdict_concurrent *dict = pdict_concurrent_create_with_options(0, 2);
+
+  pdict_concurrent_put(dict, "key", dict);
+  TEST_ASSERT_EQUAL_PTR(dict, pdict_concurrent_get_value(dict, "key"));
+  pdict_concurrent_destroy(dict);
+}
+
+static size_t hasher_calls = 0;
+
+static uint64_t countingHasher(const void *key, size_t key_len, uint64_t seed) {
+  ++hasher_calls;
+  return phash_bytes(key, key_len, seed);
+}
+
+void test_createWithOptions_ShouldHashEveryKeyOnceWithTheGivenHasher(void) {
+  pdict_mode modes[] = {PDICT_CHAINED, PDICT_OPEN_ADDRESSING};
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict_concurrent *dict = pdict_concurrent_create_with_options(&(pdict_options) {
+      .mode = modes[m],
+      .hasher = countingHasher,
+      .capacity = 1024,
+    }, 4);
+
+    hasher_calls = 0;
+    pdict_concurrent_put(dict, "a", dict);
+    TEST_ASSERT_EQUAL_PTR(dict, pdict_concurrent_get_value(dict, "a"));
+    TEST_ASSERT_TRUE(pdict_concurrent_has_key(dict, "a"));
+    TEST_ASSERT_EQUAL_PTR(dict, pdict_concurrent_upsert(dict, "a", &hasher_calls));
+    TEST_ASSERT_FALSE(pdict_concurrent_put_if_absent(dict, "a", dict));
+    TEST_ASSERT_EQUAL_PTR(&hasher_calls, pdict_concurrent_remove(dict, "a"));
+    TEST_ASSERT_EQUAL_UINT(6, hasher_calls);
+    pdict_concurrent_destroy(dict);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_create_ShouldRoundShardsToAPowerOfTwo);
+  RUN_TEST(test_put_ShouldBehaveLikeAPdict);
+  RUN_TEST(test_threads_ShouldNotLoseWrites);
+  RUN_TEST(test_iterate_ShouldVisitEveryShard);
+  RUN_TEST(test_createWithOptions_ShouldAcceptNullOptions);
+  RUN_TEST(test_createWithOptions_ShouldHashEveryKeyOnceWithTheGivenHasher);
+
+  return UNITY_END();
+}
@@ -0,0 +1,192 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_define.h"
+#include "unity.h"
+
+PDICT_DEFINE(u64map, uint64_t, void *)
+
+PDICT_DEFINE(i32map, int32_t, double)
+
+typedef struct point point;
+struct point {
+  int32_t x;
+  int32_t y;
+};
+
+static inline uint64_t point_hash(point p) {
+  return pdict_define_mix(((uint64_t)(uint32_t) p.x << 32) | (uint32_t) p.y);
+}
+
+static inline bool point_equals(point a, point b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+PDICT_DEFINE_WITH(pointmap, point, int, point_hash, point_equals)
+
+#define IDS_COUNT 20000
+
+u64map *M = 0;
+size_t values[IDS_COUNT];
+
+void setUp(void) { M = u64map_create(); }
+
+void tearDown(void) { u64map_destroy(M); }
+
+void test_create_NewMapShouldBeEmpty(void) {
+  TEST_ASSERT_TRUE(u64map_is_empty(M));
+  TEST_ASSERT_EQUAL_UINT(0, u64map_size(M));
+  TEST_ASSERT_NULL(u64map_get(M, 0));
+}
+
+void test_put_ShouldStoreAndReplaceValues(void) {
+  for (uint64_t id = 0; id < IDS_COUNT; ++id) {
+    u64map_put(M, id * 4096, &values[id]);
+  }
+
+  u64map_put(M, 4096, &values[0]);
+
+  TEST_ASSERT_EQUAL_UINT(IDS_COUNT, u64map_size(M));
+  TEST_ASSERT_EQUAL_PTR(&values[0], *u64map_get(M, 4096));
+
+  for (uint64_t id = 2; id < IDS_COUNT; ++id) {
+    TEST_ASSERT_EQUAL_PTR(&values[id], *u64map_get(M, id * 4096));
+  }
+
+  TEST_ASSERT_FALSE(u64map_has_key(M, 1));
+  TEST_ASSERT_TRUE(u64map_has_key(M, 0));
+}
+
+void test_remove_ShouldKeepTheOtherKeysReachable(void) {
+  void *removed = 0;
+
+  for (uint64_t id = 0; id < IDS_COUNT; ++id) {
+    u64map_put(M, id, &values[id]);
+  }
+
+  for (uint64_t id = 0; id < IDS_COUNT; id += 3) {
+    TEST_ASSERT_TRUE(u64map_remove(M, id, &removed));
+    TEST_ASSERT_EQUAL_PTR(&values[id], removed);
+  }
+
+  TEST_ASSERT_FALSE(u64map_remove(M, 0, 0));
+
+  for (uint64_t id = 0; id < IDS_COUNT; ++id) {
+    void **found = u64map_get(M, id);
+
+    if (id % 3 == 0) {
+      TEST_ASSERT_NULL(found);
+    } else {
+      TEST_ASSERT_EQUAL_PTR(&values[id], *found);
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT(IDS_COUNT - (IDS_COUNT + 2) / 3, u64map_size(M));
+}
+
+void test_remove_ShouldHandleChurnWithoutGrowing(void) {
+  u64map *map = u64map_create_with_capacity(64);
+
+  for (uint64_t round = 0; round < 100000; ++round) {
+    u64map_put(map, round, &values[round % IDS_COUNT]);
+
+    if (round >= 32) {
+      TEST_ASSERT_TRUE(u64map_remove(map, round - 32, 0));
+    }
+  }
+
+  TEST_ASSERT_EQUAL_UINT(32, u64map_size(map));
+  TEST_ASSERT_EQUAL_UINT(127, map->mask);
+  u64map_destroy(map);
+}
+
+static void helper_sum(uint64_t key, void *value, void *ctx) {
+  *(uint64_t *) ctx += key;
+}
+
+void test_iterate_ShouldVisitEveryEntry(void) {
+  uint64_t sum = 0, iterated = 0, key;
+  void *value;
+  u64map_iter iter;
+
+  for (uint64_t id = 1; id <= 100; ++id) {
+    u64map_put(M, id, &values[id]);
+  }
+
+  u64map_iterate(M, helper_sum, &sum);
+  TEST_ASSERT_EQUAL_UINT64(5050, sum);
+
+  u64map_iter_init(&iter, M);
+
+  while (u64map_iter_next(&iter, &key, &value)) {
+    TEST_ASSERT_EQUAL_PTR(&values[key], value);
+    iterated++;
+  }
+
+  TEST_ASSERT_EQUAL_UINT64(100, iterated);
+}
+
+void test_clean_ShouldRemoveEverything(void) {
+  u64map_put(M, 1, &values[1]);
+  u64map_clean(M);
+
+  TEST_ASSERT_TRUE(u64map_is_empty(M));
+  TEST_ASSERT_NULL(u64map_get(M, 1));
+}
+
+void test_define_ShouldStoreValuesByValue(void) {
+  i32map *map = i32map_create();
+
+  i32map_put(map, -5, 2.5);
+  *i32map_get(map, -5) += 1.0;
+
+  TEST_ASSERT_TRUE(*i32map_get(map, -5) == 3.5);
+  i32map_destroy(map);
+}
+
+void test_defineWith_ShouldUseTheGivenHashAndEquals(void) {
+  pointmap *map = pointmap_create();
+  int removed = 0;
+
+  for (int32_t x = -50; x < 50; ++x) {
+    pointmap_put(map, (point) {x, -x}, x);
+  }
+
+  TEST_ASSERT_EQUAL_INT(7, *pointmap_get(map, (point) {7, -7}));
+  TEST_ASSERT_NULL(pointmap_get(map, (point) {7, 7}));
+  TEST_ASSERT_TRUE(pointmap_remove(map, (point) {-50, 50}, &removed));
+  TEST_ASSERT_EQUAL_INT(-50, removed);
+  TEST_ASSERT_EQUAL_UINT(99, pointmap_size(map));
+  pointmap_destroy(map);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_create_NewMapShouldBeEmpty);
+  RUN_TEST(test_put_ShouldStoreAndReplaceValues);
+
+  RUN_TEST(test_remove_ShouldKeepTheOtherKeysReachable);
+  RUN_TEST(test_remove_ShouldHandleChurnWithoutGrowing);
+
+  RUN_TEST(test_iterate_ShouldVisitEveryEntry);
+  RUN_TEST(test_clean_ShouldRemoveEverything);
+
+  RUN_TEST(test_define_ShouldStoreValuesByValue);
+  RUN_TEST(test_defineWith_ShouldUseTheGivenHashAndEquals);
+
+  return UNITY_END();
+}
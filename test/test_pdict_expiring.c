@@ -0,0 +1,192 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_expiring.h"
+#include "unity.h"
+#include <stdio.h>
+
+#define KEYS_COUNT 5000
+#define NAME_LEN 16
+
+pdict_expiring *D = 0;
+uint64_t now = 0;
+size_t destroyed = 0;
+size_t values[KEYS_COUNT];
+uint64_t deadlines[KEYS_COUNT];
+
+static uint64_t fakeClock(void *ctx) { return *(uint64_t *) ctx; }
+
+static void countDestroyed(void *data) { ++destroyed; }
+
+void setUp(void) {
+  now = 1000;
+  destroyed = 0;
+  D = pdict_expiring_create_with_clock(countDestroyed, fakeClock, &now);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    values[i] = i;
+  }
+}
+
+void tearDown(void) {
+  if (D) {
+    pdict_expiring_destroy(D);
+  }
+}
+
+void test_get_ShouldMissOnceTheDeadlineIsReachedEvenBeforeReaping(void) {
+  pdict_expiring_put(D, "short", &values[1], 10);
+  pdict_expiring_put(D, "long", &values[2], 100);
+
+  now += 9;
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_expiring_get_value(D, "short"));
+  TEST_ASSERT_TRUE(pdict_expiring_has_key(D, "short"));
+
+  now += 1;
+  TEST_ASSERT_NULL(pdict_expiring_get_value(D, "short"));
+  TEST_ASSERT_FALSE(pdict_expiring_has_key(D, "short"));
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_expiring_get_value(D, "long"));
+  TEST_ASSERT_EQUAL(2, pdict_expiring_size(D));
+  TEST_ASSERT_EQUAL(0, destroyed);
+
+  TEST_ASSERT_EQUAL(1, pdict_expiring_expire(D));
+  TEST_ASSERT_EQUAL(1, pdict_expiring_size(D));
+  TEST_ASSERT_EQUAL(1, destroyed);
+  TEST_ASSERT_EQUAL(0, pdict_expiring_expire(D));
+}
+
+void test_put_ShouldRefreshTheDeadlineAndDestroyTheReplacedValue(void) {
+  pdict_expiring_put(D, "key", &values[1], 10);
+  now += 5;
+  pdict_expiring_put(D, "key", &values[2], 10);
+  TEST_ASSERT_EQUAL(1, destroyed);
+
+  now += 9;
+  TEST_ASSERT_EQUAL(0, pdict_expiring_expire(D));
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_expiring_get_value(D, "key"));
+
+  now += 1;
+  TEST_ASSERT_EQUAL(1, pdict_expiring_expire(D));
+  TEST_ASSERT_NULL(pdict_expiring_get_value(D, "key"));
+  TEST_ASSERT_EQUAL(2, destroyed);
+}
+
+void test_remove_ShouldHandTheValueBackWithoutDestroyingIt(void) {
+  pdict_expiring_put(D, "kept", &values[1], 10);
+  pdict_expiring_put(D, "expired", &values[2], 10);
+
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_expiring_remove(D, "kept"));
+  TEST_ASSERT_EQUAL(0, destroyed);
+
+  now += 10;
+  TEST_ASSERT_NULL(pdict_expiring_remove(D, "expired"));
+  TEST_ASSERT_EQUAL(1, destroyed);
+  TEST_ASSERT_NULL(pdict_expiring_remove(D, "missing"));
+  TEST_ASSERT_EQUAL(0, pdict_expiring_size(D));
+  TEST_ASSERT_EQUAL(0, pdict_expiring_expire(D));
+}
+
+void test_binaryKeys_ShouldBeStoredReadRemovedAndReaped(void) {
+  const char shortKey[] = {'k', 0, 'a'};
+  const char otherKey[] = {'k', 0, 'b'};
+  char longKey[64] = {0};
+
+  longKey[63] = 'z';
+  pdict_expiring_put_n(D, shortKey, sizeof(shortKey), &values[1], 10);
+  pdict_expiring_put_n(D, otherKey, sizeof(otherKey), &values[2], 10);
+  pdict_expiring_put_n(D, longKey, sizeof(longKey), &values[3], 20);
+
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_expiring_get_n(D, shortKey, sizeof(shortKey)));
+  TEST_ASSERT_EQUAL_PTR(&values[3], pdict_expiring_get_n(D, longKey, sizeof(longKey)));
+  TEST_ASSERT_NULL(pdict_expiring_get_n(D, shortKey, 1));
+
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_expiring_remove_n(D, otherKey, sizeof(otherKey)));
+  TEST_ASSERT_NULL(pdict_expiring_get_n(D, otherKey, sizeof(otherKey)));
+  TEST_ASSERT_EQUAL(0, destroyed);
+
+  now += 10;
+  TEST_ASSERT_EQUAL(1, pdict_expiring_expire(D));
+  TEST_ASSERT_NULL(pdict_expiring_get_n(D, shortKey, sizeof(shortKey)));
+  now += 10;
+  TEST_ASSERT_EQUAL(1, pdict_expiring_expire(D));
+  TEST_ASSERT_EQUAL(0, pdict_expiring_size(D));
+  TEST_ASSERT_EQUAL(2, destroyed);
+}
+
+void test_expire_ShouldReapExactlyTheExpiredEntriesAcrossEveryLevel(void) {
+  char key[NAME_LEN];
+  uint64_t seed = 42;
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    seed = seed * 6364136223846793005u + 1442695040888963407u;
+    /* from a few ticks to well past the range of the wheel */
+    uint64_t ttl = 1 + ((seed >> 33) >> (seed % 32));
+    deadlines[i] = now + ttl;
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pdict_expiring_put(D, key, &values[i], ttl);
+  }
+
+  size_t live = KEYS_COUNT;
+
+  while (live) {
+    seed = seed * 6364136223846793005u + 1442695040888963407u;
+    now += 1 + ((seed >> 33) >> (seed % 32));
+
+    size_t expected = 0;
+
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      expected += deadlines[i] > now;
+    }
+
+    TEST_ASSERT_EQUAL(live - expected, pdict_expiring_expire(D));
+    TEST_ASSERT_EQUAL(expected, pdict_expiring_size(D));
+    TEST_ASSERT_EQUAL(KEYS_COUNT - expected, destroyed);
+    live = expected;
+
+    for (size_t i = 0; i < KEYS_COUNT; i += 97) {
+      snprintf(key, NAME_LEN, "key%zu", i);
+      TEST_ASSERT_EQUAL_PTR(deadlines[i] > now ? &values[i] : 0, pdict_expiring_get_value(D, key));
+    }
+  }
+}
+
+void test_destroy_ShouldDestroyTheRemainingValues(void) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < 100; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pdict_expiring_put(D, key, &values[i], i < 50 ? 5 : UINT64_MAX);
+  }
+
+  now += 5;
+  TEST_ASSERT_EQUAL(50, pdict_expiring_expire(D));
+  pdict_expiring_destroy(D);
+  D = 0;
+  TEST_ASSERT_EQUAL(100, destroyed);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_get_ShouldMissOnceTheDeadlineIsReachedEvenBeforeReaping);
+  RUN_TEST(test_put_ShouldRefreshTheDeadlineAndDestroyTheReplacedValue);
+  RUN_TEST(test_remove_ShouldHandTheValueBackWithoutDestroyingIt);
+  RUN_TEST(test_binaryKeys_ShouldBeStoredReadRemovedAndReaped);
+  RUN_TEST(test_expire_ShouldReapExactlyTheExpiredEntriesAcrossEveryLevel);
+  RUN_TEST(test_destroy_ShouldDestroyTheRemainingValues);
+
+  return UNITY_END();
+}
@@ -0,0 +1,216 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_frozen.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS_COUNT 5000
+#define ROUTE_LEN 16
+#define SNAPSHOT_PATH "test_pdict_frozen.snapshot"
+
+pdict *D = 0;
+pdict_frozen *F = 0;
+size_t values[KEYS_COUNT];
+
+void setUp(void) { D = pdict_create(); }
+
+void tearDown(void) {
+  pdict_frozen_destroy(F);
+  F = 0;
+
+  if (D) {
+    pdict_destroy(D);
+  }
+
+  remove(SNAPSHOT_PATH);
+}
+
+static void fillDict(size_t count) {
+  char key[ROUTE_LEN];
+
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = i;
+    snprintf(key, ROUTE_LEN, "route/%zu", i);
+    pdict_put(D, key, &values[i]);
+  }
+}
+
+void test_freeze_ShouldKeepEveryEntry(void) {
+  char key[ROUTE_LEN];
+
+  fillDict(KEYS_COUNT);
+  F = pdict_freeze(D);
+
+  TEST_ASSERT_NOT_NULL(F);
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, pdict_frozen_size(F));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, ROUTE_LEN, "route/%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], pdict_frozen_get(F, key));
+    TEST_ASSERT_TRUE(pdict_frozen_has_key(F, key));
+  }
+}
+
+void test_freeze_ShouldOutliveTheSourceDict(void) {
+  fillDict(10);
+  F = pdict_freeze(D);
+  pdict_destroy(D);
+  D = 0;
+
+  TEST_ASSERT_EQUAL_PTR(&values[7], pdict_frozen_get(F, "route/7"));
+}
+
+void test_get_ShouldReturnNullForMissingKeys(void) {
+  char key[ROUTE_LEN];
+
+  fillDict(KEYS_COUNT);
+  F = pdict_freeze(D);
+
+  for (size_t i = KEYS_COUNT; i < 2 * KEYS_COUNT; ++i) {
+    snprintf(key, ROUTE_LEN, "route/%zu", i);
+    TEST_ASSERT_NULL(pdict_frozen_get(F, key));
+  }
+
+  TEST_ASSERT_NULL(pdict_frozen_get(F, "route/"));
+  TEST_ASSERT_NULL(pdict_frozen_get(F, ""));
+  TEST_ASSERT_FALSE(pdict_frozen_has_key(F, "route/1 "));
+}
+
+void test_get_ShouldTellNullValuesFromMissingKeys(void) {
+  pdict_put(D, "empty", 0);
+  F = pdict_freeze(D);
+
+  TEST_ASSERT_NULL(pdict_frozen_get(F, "empty"));
+  TEST_ASSERT_TRUE(pdict_frozen_has_key(F, "empty"));
+  TEST_ASSERT_FALSE(pdict_frozen_has_key(F, "other"));
+}
+
+void test_freeze_ShouldHandleAnEmptyDict(void) {
+  F = pdict_freeze(D);
+
+  TEST_ASSERT_NOT_NULL(F);
+  TEST_ASSERT_EQUAL_UINT(0, pdict_frozen_size(F));
+  TEST_ASSERT_NULL(pdict_frozen_get(F, "anything"));
+}
+
+void test_getN_ShouldAllowBinaryKeys(void) {
+  const char first[] = {'a', '\0', 'b'};
+  const char second[] = {'a', '\0', 'c'};
+
+  pdict_put_n(D, first, sizeof(first), &values[1]);
+  pdict_put_n(D, second, sizeof(second), &values[2]);
+  F = pdict_freeze(D);
+
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_frozen_get_n(F, first, sizeof(first)));
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_frozen_get_n(F, second, sizeof(second)));
+  TEST_ASSERT_NULL(pdict_frozen_get(F, "a"));
+}
+
+typedef struct route route;
+struct route {
+  uint32_t port;
+  char host[12];
+};
+
+void test_save_ShouldRoundTripValueBytesThroughAFile(void) {
+  route *routes = malloc(KEYS_COUNT * sizeof(route));
+  char key[ROUTE_LEN];
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    routes[i].port = (uint32_t) i;
+    snprintf(routes[i].host, sizeof(routes[i].host), "host%zu", i % 7);
+    snprintf(key, ROUTE_LEN, "route/%zu", i);
+    pdict_put(D, key, &routes[i]);
+  }
+
+  TEST_ASSERT_TRUE(pdict_save(D, SNAPSHOT_PATH, sizeof(route)));
+  free(routes);
+
+  F = pdict_open_mmap(SNAPSHOT_PATH);
+  TEST_ASSERT_NOT_NULL(F);
+  TEST_ASSERT_TRUE(pdict_frozen_verify(F));
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, pdict_frozen_size(F));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, ROUTE_LEN, "route/%zu", i);
+    const route *found = pdict_frozen_get(F, key);
+    char host[12];
+
+    snprintf(host, sizeof(host), "host%zu", i % 7);
+    TEST_ASSERT_NOT_NULL(found);
+    TEST_ASSERT_EQUAL_UINT32(i, found->port);
+    TEST_ASSERT_EQUAL_STRING(host, found->host);
+  }
+
+  TEST_ASSERT_NULL(pdict_frozen_get(F, "route/x"));
+}
+
+void test_save_ShouldReplaceAnExistingSnapshot(void) {
+  fillDict(10);
+  TEST_ASSERT_TRUE(pdict_save(D, SNAPSHOT_PATH, sizeof(size_t)));
+
+  pdict_put(D, "late", &values[3]);
+  TEST_ASSERT_TRUE(pdict_save(D, SNAPSHOT_PATH, sizeof(size_t)));
+
+  F = pdict_open_mmap(SNAPSHOT_PATH);
+  TEST_ASSERT_EQUAL_UINT(11, pdict_frozen_size(F));
+  TEST_ASSERT_EQUAL_UINT(3, *(size_t *) pdict_frozen_get(F, "late"));
+}
+
+void test_openMmap_ShouldRejectMissingAndForeignFiles(void) {
+  TEST_ASSERT_NULL(pdict_open_mmap("test_pdict_frozen.missing"));
+
+  FILE *file = fopen(SNAPSHOT_PATH, "wb");
+  fputs("definitely not a pdict snapshot, just some text long enough", file);
+  fclose(file);
+
+  TEST_ASSERT_NULL(pdict_open_mmap(SNAPSHOT_PATH));
+}
+
+void test_verify_ShouldDetectCorruption(void) {
+  fillDict(100);
+  TEST_ASSERT_TRUE(pdict_save(D, SNAPSHOT_PATH, sizeof(size_t)));
+
+  FILE *file = fopen(SNAPSHOT_PATH, "r+b");
+  fseek(file, -3, SEEK_END);
+  fputc('!', file);
+  fclose(file);
+
+  F = pdict_open_mmap(SNAPSHOT_PATH);
+  TEST_ASSERT_NOT_NULL(F);
+  TEST_ASSERT_FALSE(pdict_frozen_verify(F));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_freeze_ShouldKeepEveryEntry);
+  RUN_TEST(test_freeze_ShouldOutliveTheSourceDict);
+  RUN_TEST(test_freeze_ShouldHandleAnEmptyDict);
+
+  RUN_TEST(test_get_ShouldReturnNullForMissingKeys);
+  RUN_TEST(test_get_ShouldTellNullValuesFromMissingKeys);
+  RUN_TEST(test_getN_ShouldAllowBinaryKeys);
+
+  RUN_TEST(test_save_ShouldRoundTripValueBytesThroughAFile);
+  RUN_TEST(test_save_ShouldReplaceAnExistingSnapshot);
+  RUN_TEST(test_openMmap_ShouldRejectMissingAndForeignFiles);
+  RUN_TEST(test_verify_ShouldDetectCorruption);
+
+  return UNITY_END();
+}
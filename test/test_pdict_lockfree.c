@@ -0,0 +1,162 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_lockfree.h"
+#include "unity.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define READERS_COUNT 4
+#define KEYS_COUNT 4000
+#define NAME_LEN 24
+
+pdict_lockfree *D = 0;
+pepoch_thread *R = 0;
+size_t values[KEYS_COUNT];
+
+void setUp(void) {
+  D = pdict_lockfree_create();
+  R = pdict_lockfree_register(D);
+}
+
+void tearDown(void) {
+  pdict_lockfree_unregister(D, R);
+  pdict_lockfree_destroy(D);
+}
+
+void test_put_ShouldBehaveLikeAPdict(void) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "route/%zu", i);
+    TEST_ASSERT_NULL(pdict_lockfree_put(D, key, &values[i]));
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[5], pdict_lockfree_put(D, "route/5", &values[0]));
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, pdict_lockfree_size(D));
+
+  for (size_t i = 6; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "route/%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], pdict_lockfree_get_value(D, R, key));
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[0], pdict_lockfree_get_value(D, R, "route/5"));
+  TEST_ASSERT_NULL(pdict_lockfree_get_value(D, R, "route/"));
+}
+
+void test_remove_ShouldUnlinkOnlyTheGivenKey(void) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < 100; ++i) {
+    snprintf(key, NAME_LEN, "route/%zu", i);
+    pdict_lockfree_put(D, key, &values[i]);
+  }
+
+  for (size_t i = 0; i < 100; i += 2) {
+    snprintf(key, NAME_LEN, "route/%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], pdict_lockfree_remove(D, key));
+  }
+
+  TEST_ASSERT_NULL(pdict_lockfree_remove(D, "route/0"));
+  TEST_ASSERT_EQUAL_UINT(50, pdict_lockfree_size(D));
+
+  for (size_t i = 0; i < 100; ++i) {
+    snprintf(key, NAME_LEN, "route/%zu", i);
+    TEST_ASSERT_EQUAL_PTR(i % 2 ? &values[i] : 0, pdict_lockfree_get_value(D, R, key));
+  }
+}
+
+static atomic_bool stop_readers;
+
+static void *helper_reader(void *arg) {
+  pepoch_thread *reader = pdict_lockfree_register(D);
+  char key[NAME_LEN];
+  uintptr_t failures = 0;
+
+  while (!atomic_load(&stop_readers)) {
+    /* stable keys are never removed, they must always be found */
+    for (size_t i = 0; i < 64; ++i) {
+      snprintf(key, NAME_LEN, "stable/%zu", i);
+
+      if (pdict_lockfree_get_value(D, reader, key) != &values[i]) {
+        failures++;
+      }
+    }
+
+    for (size_t i = 0; i < 64; ++i) {
+      snprintf(key, NAME_LEN, "churn/%zu", i);
+      void *value = pdict_lockfree_get_value(D, reader, key);
+
+      if (value && value != &values[i]) {
+        failures++;
+      }
+    }
+  }
+
+  pdict_lockfree_unregister(D, reader);
+  return (void *) failures;
+}
+
+void test_readers_ShouldSeeConsistentDataWhileWritersChurn(void) {
+  pthread_t readers[READERS_COUNT];
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < 64; ++i) {
+    snprintf(key, NAME_LEN, "stable/%zu", i);
+    pdict_lockfree_put(D, key, &values[i]);
+  }
+
+  atomic_store(&stop_readers, false);
+
+  for (size_t i = 0; i < READERS_COUNT; ++i) {
+    pthread_create(&readers[i], 0, helper_reader, 0);
+  }
+
+  /* growing tables and removing nodes both retire memory readers may hold */
+  for (size_t round = 0; round < 20; ++round) {
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      snprintf(key, NAME_LEN, "churn/%zu", i);
+      pdict_lockfree_put(D, key, &values[i]);
+    }
+
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      snprintf(key, NAME_LEN, "churn/%zu", i);
+      pdict_lockfree_remove(D, key);
+    }
+  }
+
+  atomic_store(&stop_readers, true);
+
+  for (size_t i = 0; i < READERS_COUNT; ++i) {
+    void *failures;
+    pthread_join(readers[i], &failures);
+    TEST_ASSERT_NULL(failures);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(64, pdict_lockfree_size(D));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_put_ShouldBehaveLikeAPdict);
+  RUN_TEST(test_remove_ShouldUnlinkOnlyTheGivenKey);
+  RUN_TEST(test_readers_ShouldSeeConsistentDataWhileWritersChurn);
+
+  return UNITY_END();
+}
@@ -0,0 +1,211 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pdict_ordered.h"
+#include "unity.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS_COUNT 3000
+#define NAME_LEN 16
+
+pdict_ordered *D = 0;
+size_t values[KEYS_COUNT];
+
+void setUp(void) { D = pdict_ordered_create(); }
+
+void tearDown(void) { pdict_ordered_destroy(D); }
+
+static void fillDict(size_t count) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = i;
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pdict_ordered_put(D, key, &values[i]);
+  }
+}
+
+void test_create_NewDictShouldBeEmpty(void) {
+  TEST_ASSERT_TRUE(pdict_ordered_is_empty(D));
+  TEST_ASSERT_EQUAL_UINT(0, pdict_ordered_size(D));
+  TEST_ASSERT_NULL(pdict_ordered_get_value(D, "missing"));
+}
+
+void test_put_ShouldStoreAndReplaceValues(void) {
+  fillDict(KEYS_COUNT);
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, pdict_ordered_size(D));
+
+  pdict_ordered_put(D, "key7", &values[0]);
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, pdict_ordered_size(D));
+  TEST_ASSERT_EQUAL_PTR(&values[0], pdict_ordered_get_value(D, "key7"));
+  TEST_ASSERT_EQUAL_PTR(&values[2999], pdict_ordered_get_value(D, "key2999"));
+  TEST_ASSERT_TRUE(pdict_ordered_has_key(D, "key0"));
+  TEST_ASSERT_FALSE(pdict_ordered_has_key(D, "key3000"));
+}
+
+void test_iterate_ShouldFollowInsertionOrderAcrossResizes(void) {
+  pdict_ordered_iter iter;
+  pdict_entry entry;
+  size_t expected = 0;
+
+  fillDict(KEYS_COUNT);
+  pdict_ordered_iter_init(&iter, D);
+
+  while (pdict_ordered_iter_next(&iter, &entry)) {
+    TEST_ASSERT_EQUAL_PTR(&values[expected++], entry.value);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, expected);
+}
+
+void test_remove_ShouldKeepTheOrderOfTheRemainingKeys(void) {
+  char key[NAME_LEN];
+  pdict_ordered_iter iter;
+  pdict_entry entry;
+  size_t expected = 1;
+
+  fillDict(KEYS_COUNT);
+
+  /* drop even keys, then grow again so the removed entries get compacted */
+  for (size_t i = 0; i < KEYS_COUNT; i += 2) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], pdict_ordered_remove(D, key));
+  }
+
+  TEST_ASSERT_NULL(pdict_ordered_remove(D, "key0"));
+  pdict_ordered_put(D, "key0", &values[0]);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "extra%zu", i);
+    pdict_ordered_put(D, key, &values[i]);
+  }
+
+  pdict_ordered_iter_init(&iter, D);
+
+  for (; expected < KEYS_COUNT; expected += 2) {
+    TEST_ASSERT_TRUE(pdict_ordered_iter_next(&iter, &entry));
+    TEST_ASSERT_EQUAL_PTR(&values[expected], entry.value);
+  }
+
+  TEST_ASSERT_TRUE(pdict_ordered_iter_next(&iter, &entry));
+  TEST_ASSERT_EQUAL_STRING("key0", entry.key);
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT / 2 + 1 + KEYS_COUNT, pdict_ordered_size(D));
+}
+
+void test_remove_ShouldLetKeysBeReinsertedRepeatedly(void) {
+  for (size_t round = 0; round < 1000; ++round) {
+    pdict_ordered_put(D, "churn", &values[round]);
+    TEST_ASSERT_EQUAL_PTR(&values[round], pdict_ordered_remove(D, "churn"));
+  }
+
+  TEST_ASSERT_TRUE(pdict_ordered_is_empty(D));
+}
+
+static void helper_count(char *key, void *value, void *ctx) {
+  (*(size_t *) ctx)++;
+}
+
+void test_iterateWithContext_ShouldVisitEveryEntry(void) {
+  size_t count = 0;
+
+  fillDict(100);
+  pdict_ordered_iterate_with_context(D, helper_count, &count);
+  TEST_ASSERT_EQUAL_UINT(100, count);
+}
+
+void test_clean_ShouldRemoveEverything(void) {
+  fillDict(100);
+  pdict_ordered_clean(D);
+
+  TEST_ASSERT_TRUE(pdict_ordered_is_empty(D));
+  TEST_ASSERT_NULL(pdict_ordered_get_value(D, "key1"));
+
+  fillDict(10);
+  TEST_ASSERT_EQUAL_UINT(10, pdict_ordered_size(D));
+}
+
+void test_binaryKeys_ShouldAllowEmbeddedNulBytes(void) {
+  const char first[] = {'k', '\0', '1'};
+  const char second[] = {'k', '\0', '2'};
+
+  pdict_ordered_put_n(D, first, sizeof(first), &values[1]);
+  pdict_ordered_put_n(D, second, sizeof(second), &values[2]);
+
+  TEST_ASSERT_EQUAL_PTR(&values[1], pdict_ordered_get_n(D, first, sizeof(first)));
+  TEST_ASSERT_EQUAL_PTR(&values[2], pdict_ordered_remove_n(D, second, sizeof(second)));
+  TEST_ASSERT_NULL(pdict_ordered_get_value(D, "k"));
+}
+
+void test_createWithCapacity_ShouldHoldLargeTables(void) {
+  pdict_ordered *dict = pdict_ordered_create_with_capacity(70000);
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < 70000; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    pdict_ordered_put(dict, key, &values[i % KEYS_COUNT]);
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[69999 % KEYS_COUNT], pdict_ordered_get_value(dict, "key69999"));
+  pdict_ordered_destroy(dict);
+}
+
+void test_put_ShouldAcceptKeysHandedOutByIteration(void) {
+  char key[16];
+  pdict_ordered_iter iter;
+  pdict_entry entry;
+
+  for (int i = 0; i < 100; ++i) {
+    snprintf(key, sizeof(key), "key-%d", i);
+    pdict_ordered_put(D, key, (void *)(intptr_t)(i + 1));
+  }
+
+  /* keep moving the oldest key to the end, through the arena pointer */
+  for (int round = 0; round < 1000; ++round) {
+    pdict_ordered_iter_init(&iter, D);
+    TEST_ASSERT_TRUE(pdict_ordered_iter_next(&iter, &entry));
+    void *value = pdict_ordered_remove_n(D, entry.key, entry.key_len);
+    pdict_ordered_put_n(D, entry.key, entry.key_len, value);
+  }
+
+  TEST_ASSERT_EQUAL(100, pdict_ordered_size(D));
+  for (int i = 0; i < 100; ++i) {
+    snprintf(key, sizeof(key), "key-%d", i);
+    TEST_ASSERT_EQUAL_PTR((void *)(intptr_t)(i + 1), pdict_ordered_get_value(D, key));
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_create_NewDictShouldBeEmpty);
+  RUN_TEST(test_put_ShouldStoreAndReplaceValues);
+
+  RUN_TEST(test_iterate_ShouldFollowInsertionOrderAcrossResizes);
+  RUN_TEST(test_iterateWithContext_ShouldVisitEveryEntry);
+
+  RUN_TEST(test_remove_ShouldKeepTheOrderOfTheRemainingKeys);
+  RUN_TEST(test_remove_ShouldLetKeysBeReinsertedRepeatedly);
+
+  RUN_TEST(test_clean_ShouldRemoveEverything);
+  RUN_TEST(test_binaryKeys_ShouldAllowEmbeddedNulBytes);
+  RUN_TEST(test_createWithCapacity_ShouldHoldLargeTables);
+  RUN_TEST(test_put_ShouldAcceptKeysHandedOutByIteration);
+
+  return UNITY_END();
+}
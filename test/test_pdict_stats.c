@@ -0,0 +1,146 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+/*
+ * Built together with its own copy of pdict.c compiled with
+ * PDICT_ENABLE_STATS, see test/CMakeLists.txt.
+ */
+#include "putils/pdict.h"
+#include "unity.h"
+#include <pthread.h>
+#include <stdio.h>
+
+#define KEYS_COUNT 1000
+#define NAME_LEN 16
+#define READERS 4
+#define READS 10000
+
+pdict_options options[] = {
+  {.mode = PDICT_CHAINED},
+  {.mode = PDICT_OPEN_ADDRESSING},
+  {.incremental_rehash = true},
+};
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_counters_ShouldCountHitsAndMisses(void) {
+  char key[NAME_LEN];
+
+  for (size_t m = 0; m < 3; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+    pdict_statistics stats;
+    const void *keys[] = {"k1", "k2", "nope"};
+    void *out[3];
+
+    for (size_t i = 0; i < 10; ++i) {
+      snprintf(key, NAME_LEN, "k%zu", i);
+      pdict_put(dict, key, dict);
+    }
+
+    pdict_get_value(dict, "k3");
+    pdict_get_value(dict, "missing");
+    pdict_has_key(dict, "k4");
+    pdict_get_many(dict, keys, 0, 3, out);
+
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_TRUE(stats.counters_enabled);
+    TEST_ASSERT_EQUAL_UINT64(4, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(2, stats.misses);
+
+    pdict_reset_stats(dict);
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.hits + stats.misses);
+    pdict_destroy(dict);
+  }
+}
+
+void test_counters_ShouldCountResizes(void) {
+  char key[NAME_LEN];
+
+  for (size_t m = 0; m < 3; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+    pdict_statistics stats;
+
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_EQUAL_UINT64(0, stats.resizes);
+
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      snprintf(key, NAME_LEN, "key%zu", i);
+      pdict_put(dict, key, dict);
+    }
+
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_TRUE(stats.resizes >= 5);
+    TEST_ASSERT_TRUE(stats.resize_seconds > 0);
+
+    uint64_t resizes = stats.resizes;
+    pdict_reserve(dict, 100 * KEYS_COUNT);
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_EQUAL_UINT64(resizes + 1, stats.resizes);
+    pdict_destroy(dict);
+  }
+}
+
+static void *read_keys(void *dict) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < READS; ++i) {
+    /* every other key is missing */
+    snprintf(key, NAME_LEN, "key%zu", i % (2 * KEYS_COUNT));
+    pdict_get_value(dict, key);
+  }
+  return 0;
+}
+
+void test_counters_ShouldNotLoseConcurrentLookups(void) {
+  char key[NAME_LEN];
+
+  for (size_t m = 0; m < 2; ++m) {
+    pdict *dict = pdict_create_with_options(&options[m]);
+    pthread_t readers[READERS];
+    pdict_statistics stats;
+
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      snprintf(key, NAME_LEN, "key%zu", i);
+      pdict_put(dict, key, dict);
+    }
+    pdict_reset_stats(dict);
+
+    for (size_t t = 0; t < READERS; ++t) {
+      TEST_ASSERT_EQUAL_INT(0, pthread_create(&readers[t], 0, read_keys, dict));
+    }
+    for (size_t t = 0; t < READERS; ++t) {
+      pthread_join(readers[t], 0);
+    }
+
+    pdict_stats(dict, &stats);
+    TEST_ASSERT_EQUAL_UINT64(READERS * READS / 2, stats.hits);
+    TEST_ASSERT_EQUAL_UINT64(READERS * READS / 2, stats.misses);
+    pdict_destroy(dict);
+  }
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_counters_ShouldCountHitsAndMisses);
+  RUN_TEST(test_counters_ShouldCountResizes);
+  RUN_TEST(test_counters_ShouldNotLoseConcurrentLookups);
+
+  return UNITY_END();
+}
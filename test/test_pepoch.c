@@ -0,0 +1,122 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/pepoch.h"
+#include "unity.h"
+#include <stdlib.h>
+
+pepoch *E = 0;
+size_t destroyed = 0;
+
+void setUp(void) {
+  E = pepoch_create();
+  destroyed = 0;
+}
+
+void tearDown(void) { pepoch_destroy(E); }
+
+static void helper_destroy(void *pointer) {
+  destroyed++;
+  free(pointer);
+}
+
+static void helper_count(void *pointer) {
+  destroyed++;
+}
+
+void test_reclaim_ShouldDestroyWhenNoReaderIsActive(void) {
+  pepoch_retire(E, malloc(8), helper_destroy);
+  pepoch_retire(E, malloc(8), helper_destroy);
+
+  for (int i = 0; i < 3; ++i) {
+    pepoch_reclaim(E);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(2, destroyed);
+  TEST_ASSERT_EQUAL_UINT(0, pepoch_reclaim(E));
+}
+
+void test_reclaim_ShouldWaitForActiveReaders(void) {
+  pepoch_thread *reader = pepoch_register(E);
+
+  pepoch_enter(E, reader);
+  pepoch_retire(E, malloc(8), helper_destroy);
+
+  for (int i = 0; i < 10; ++i) {
+    pepoch_reclaim(E);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(0, destroyed);
+
+  pepoch_exit(reader);
+
+  for (int i = 0; i < 3; ++i) {
+    pepoch_reclaim(E);
+  }
+
+  TEST_ASSERT_EQUAL_UINT(1, destroyed);
+  pepoch_unregister(E, reader);
+}
+
+void test_reclaim_ShouldNotWaitForReadersThatEnteredLater(void) {
+  pepoch_thread *reader = pepoch_register(E);
+
+  pepoch_retire(E, malloc(8), helper_destroy);
+  pepoch_reclaim(E);
+
+  /* a reader entering now cannot see what was retired before */
+  pepoch_enter(E, reader);
+
+  for (int i = 0; i < 3; ++i) {
+    pepoch_reclaim(E);
+  }
+
+  pepoch_exit(reader);
+  pepoch_unregister(E, reader);
+  TEST_ASSERT_EQUAL_UINT(1, destroyed);
+}
+
+void test_register_ShouldReuseReleasedRecords(void) {
+  pepoch_thread *first = pepoch_register(E);
+  pepoch_unregister(E, first);
+
+  TEST_ASSERT_EQUAL_PTR(first, pepoch_register(E));
+  TEST_ASSERT_NOT_EQUAL(first, pepoch_register(E));
+}
+
+void test_destroy_ShouldDestroyEverythingPending(void) {
+  pepoch *epoch = pepoch_create();
+  size_t before = destroyed;
+
+  for (int i = 0; i < 10; ++i) {
+    pepoch_retire(epoch, 0, helper_count);
+  }
+
+  pepoch_destroy(epoch);
+  TEST_ASSERT_EQUAL_UINT(before + 10, destroyed);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_reclaim_ShouldDestroyWhenNoReaderIsActive);
+  RUN_TEST(test_reclaim_ShouldWaitForActiveReaders);
+  RUN_TEST(test_reclaim_ShouldNotWaitForReadersThatEnteredLater);
+  RUN_TEST(test_register_ShouldReuseReleasedRecords);
+  RUN_TEST(test_destroy_ShouldDestroyEverythingPending);
+
+  return UNITY_END();
+}
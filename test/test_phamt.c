@@ -0,0 +1,198 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/phamt.h"
+#include "unity.h"
+#include <pthread.h>
+#include <string.h>
+
+#define KEYS_COUNT 5000
+#define NAME_LEN 16
+
+phamt *H = 0;
+size_t values[KEYS_COUNT];
+
+void setUp(void) {
+  H = phamt_create();
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    values[i] = i;
+  }
+}
+
+void tearDown(void) { phamt_destroy(H); }
+
+static void fillTrie(phamt *trie, size_t count) {
+  char key[NAME_LEN];
+
+  for (size_t i = 0; i < count; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    phamt_put(trie, key, &values[i]);
+  }
+}
+
+static void helper_sum(char *key, void *value, void *ctx) {
+  *(size_t *) ctx += *(size_t *) value;
+}
+
+static size_t sumOf(const phamt *trie) {
+  size_t sum = 0;
+  phamt_iterate_with_context(trie, helper_sum, &sum);
+  return sum;
+}
+
+void test_create_NewTrieShouldBeEmpty(void) {
+  TEST_ASSERT_TRUE(phamt_is_empty(H));
+  TEST_ASSERT_NULL(phamt_get_value(H, "key0"));
+  TEST_ASSERT_NULL(phamt_remove(H, "key0"));
+}
+
+void test_put_ShouldStoreAndReplaceValues(void) {
+  char key[NAME_LEN];
+
+  fillTrie(H, KEYS_COUNT);
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, phamt_size(H));
+  TEST_ASSERT_EQUAL_PTR(&values[3], phamt_put(H, "key3", &values[4]));
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT, phamt_size(H));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    TEST_ASSERT_EQUAL_PTR(i == 3 ? &values[4] : &values[i], phamt_get_value(H, key));
+  }
+
+  TEST_ASSERT_FALSE(phamt_has_key(H, "key"));
+  TEST_ASSERT_EQUAL_UINT(KEYS_COUNT * (KEYS_COUNT - 1) / 2 + 1, sumOf(H));
+}
+
+void test_remove_ShouldRemoveEveryKey(void) {
+  char key[NAME_LEN];
+
+  fillTrie(H, KEYS_COUNT);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i);
+    TEST_ASSERT_EQUAL_PTR(&values[i], phamt_remove(H, key));
+    TEST_ASSERT_NULL(phamt_get_value(H, key));
+
+    if (i + 1 < KEYS_COUNT) {
+      snprintf(key, NAME_LEN, "key%zu", i + 1);
+      TEST_ASSERT_EQUAL_PTR(&values[i + 1], phamt_get_value(H, key));
+    }
+  }
+
+  TEST_ASSERT_TRUE(phamt_is_empty(H));
+}
+
+void test_snapshot_ShouldNotSeeLaterUpdates(void) {
+  fillTrie(H, 100);
+
+  phamt *snapshot = phamt_snapshot(H);
+  size_t before = sumOf(snapshot);
+
+  phamt_put(H, "key1", &values[50]);
+  phamt_remove(H, "key2");
+  phamt_put(H, "extra", &values[7]);
+
+  TEST_ASSERT_EQUAL_UINT(100, phamt_size(snapshot));
+  TEST_ASSERT_EQUAL_UINT(before, sumOf(snapshot));
+  TEST_ASSERT_EQUAL_PTR(&values[1], phamt_get_value(snapshot, "key1"));
+  TEST_ASSERT_EQUAL_PTR(&values[2], phamt_get_value(snapshot, "key2"));
+  TEST_ASSERT_NULL(phamt_get_value(snapshot, "extra"));
+
+  TEST_ASSERT_EQUAL_PTR(&values[50], phamt_get_value(H, "key1"));
+  TEST_ASSERT_NULL(phamt_get_value(H, "key2"));
+
+  /* updating the snapshot must not leak into the original either */
+  phamt_remove(snapshot, "key3");
+  TEST_ASSERT_EQUAL_PTR(&values[3], phamt_get_value(H, "key3"));
+
+  phamt_destroy(snapshot);
+  TEST_ASSERT_EQUAL_PTR(&values[3], phamt_get_value(H, "key3"));
+}
+
+static uint64_t helper_weak_hasher(const void *key, size_t key_len, uint64_t seed) {
+  return key_len;
+}
+
+void test_collisions_ShouldKeepKeysWithTheSameHashApart(void) {
+  phamt *trie = phamt_create_with_hasher(helper_weak_hasher, 0);
+
+  phamt_put(trie, "a", &values[1]);
+  phamt_put(trie, "b", &values[2]);
+  phamt_put(trie, "c", &values[3]);
+  phamt_put(trie, "dd", &values[4]);
+
+  phamt *snapshot = phamt_snapshot(trie);
+
+  TEST_ASSERT_EQUAL_PTR(&values[2], phamt_get_value(trie, "b"));
+  TEST_ASSERT_EQUAL_PTR(&values[2], phamt_remove(trie, "b"));
+  TEST_ASSERT_EQUAL_PTR(&values[1], phamt_remove(trie, "a"));
+  TEST_ASSERT_EQUAL_PTR(&values[3], phamt_get_value(trie, "c"));
+  TEST_ASSERT_EQUAL_PTR(&values[4], phamt_get_value(trie, "dd"));
+  TEST_ASSERT_EQUAL_UINT(2, phamt_size(trie));
+
+  TEST_ASSERT_EQUAL_PTR(&values[2], phamt_get_value(snapshot, "b"));
+  TEST_ASSERT_EQUAL_UINT(4, phamt_size(snapshot));
+
+  phamt_destroy(snapshot);
+  phamt_destroy(trie);
+}
+
+static void *helper_export(void *arg) {
+  phamt *snapshot = arg;
+  size_t first = sumOf(snapshot);
+
+  for (int i = 0; i < 50; ++i) {
+    if (sumOf(snapshot) != first) {
+      return snapshot;
+    }
+  }
+
+  phamt_destroy(snapshot);
+  return 0;
+}
+
+void test_snapshot_ShouldBeReadableFromAnotherThreadWhileWriting(void) {
+  char key[NAME_LEN];
+  pthread_t exporter;
+
+  fillTrie(H, 1000);
+  pthread_create(&exporter, 0, helper_export, phamt_snapshot(H));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(key, NAME_LEN, "key%zu", i % 1000);
+    phamt_remove(H, key);
+    phamt_put(H, key, &values[KEYS_COUNT - 1 - i]);
+  }
+
+  void *failed;
+  pthread_join(exporter, &failed);
+  TEST_ASSERT_NULL(failed);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_create_NewTrieShouldBeEmpty);
+  RUN_TEST(test_put_ShouldStoreAndReplaceValues);
+  RUN_TEST(test_remove_ShouldRemoveEveryKey);
+
+  RUN_TEST(test_snapshot_ShouldNotSeeLaterUpdates);
+  RUN_TEST(test_collisions_ShouldKeepKeysWithTheSameHashApart);
+  RUN_TEST(test_snapshot_ShouldBeReadableFromAnotherThreadWhileWriting);
+
+  return UNITY_END();
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/phash.h"
+#include "unity.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BUFFER_LEN 256
+
+static unsigned char *buffer = 0;
+
+void setUp(void) {
+  buffer = malloc(BUFFER_LEN + 1);
+  for (size_t i = 0; i < BUFFER_LEN + 1; ++i) {
+    buffer[i] = (unsigned char)(i * 31 + 7);
+  }
+}
+
+void tearDown(void) { free(buffer); }
+
+void test_bytes_ShouldBeDeterministicForTheSameSeed(void) {
+  for (size_t len = 0; len <= BUFFER_LEN; ++len) {
+    TEST_ASSERT_TRUE(phash_bytes(buffer, len, 42) == phash_bytes(buffer, len, 42));
+  }
+}
+
+void test_bytes_ShouldDependOnTheSeed(void) {
+  for (size_t len = 0; len <= BUFFER_LEN; ++len) {
+    TEST_ASSERT_TRUE(phash_bytes(buffer, len, 1) != phash_bytes(buffer, len, 2));
+  }
+}
+
+void test_bytes_ShouldDependOnTheLength(void) {
+  for (size_t len = 1; len <= BUFFER_LEN; ++len) {
+    TEST_ASSERT_TRUE(phash_bytes(buffer, len, 7) != phash_bytes(buffer, len - 1, 7));
+  }
+}
+
+void test_bytes_ShouldNotDependOnAlignment(void) {
+  for (size_t len = 0; len < BUFFER_LEN; ++len) {
+    unsigned char *copy = malloc(len + 1);
+    memcpy(copy, buffer, len);
+    memmove(buffer + 1, buffer, len);
+    TEST_ASSERT_TRUE(phash_bytes(copy, len, 3) == phash_bytes(buffer + 1, len, 3));
+    memmove(buffer, buffer + 1, len);
+    free(copy);
+  }
+}
+
+void test_bytes_ShouldChangeWhenASingleBitFlips(void) {
+  for (size_t len = 1; len <= 120; ++len) {
+    uint64_t original = phash_bytes(buffer, len, 5);
+    for (size_t byte = 0; byte < len; ++byte) {
+      buffer[byte] ^= 0x10;
+      TEST_ASSERT_TRUE(original != phash_bytes(buffer, len, 5));
+      buffer[byte] ^= 0x10;
+    }
+  }
+}
+
+void test_string_ShouldMatchBytesOverTheStringLength(void) {
+  const char *key = "session:0123456789abcdef";
+  TEST_ASSERT_TRUE(phash_string(key, 9) == phash_bytes(key, strlen(key), 9));
+}
+
+void test_djb2_ShouldMatchTheClassicDefinition(void) {
+  TEST_ASSERT_TRUE(phash_djb2("", 0, 0) == 5381);
+  TEST_ASSERT_TRUE(phash_djb2("a", 1, 0) == 5381 * 33 + 'a');
+}
+
+void test_randomSeed_ShouldReturnDistinctSeeds(void) {
+  uint64_t first = phash_random_seed();
+  uint64_t second = phash_random_seed();
+  TEST_ASSERT_TRUE(first != second);
+  TEST_ASSERT_TRUE(first != 0 && second != 0);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_bytes_ShouldBeDeterministicForTheSameSeed);
+  RUN_TEST(test_bytes_ShouldDependOnTheSeed);
+  RUN_TEST(test_bytes_ShouldDependOnTheLength);
+  RUN_TEST(test_bytes_ShouldNotDependOnAlignment);
+  RUN_TEST(test_bytes_ShouldChangeWhenASingleBitFlips);
+
+  RUN_TEST(test_string_ShouldMatchBytesOverTheStringLength);
+
+  RUN_TEST(test_djb2_ShouldMatchTheClassicDefinition);
+
+  RUN_TEST(test_randomSeed_ShouldReturnDistinctSeeds);
+  return UNITY_END();
+}
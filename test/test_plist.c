@@ -56,6 +56,16 @@ bool helper_is_99(const void *val) {
   return *_val == 99;
 }
 
+static size_t threshold = 0;
+
+bool helper_is_below_threshold(const void *val) {
+  return *(const size_t *)val < threshold;
+}
+
+bool helper_is_at_least_threshold(const void *val) {
+  return *(const size_t *)val >= threshold;
+}
+
 void helper_load_list(plist *list) {
   for (size_t i = 0; i < DATA_ARRAY_LEN; ++i) {
     data[i] = i + 1;
@@ -154,6 +164,157 @@ void test_sort_ShouldOrderShuffledList(void) {
   }
 }
 
+/* Values are key * 100000 + original position, only keys are compared */
+static bool helper_key_comparator(const void *a, const void *b) {
+  return *(const size_t *) a / 100000 < *(const size_t *) b / 100000;
+}
+
+static void helper_sort_pattern(plist *list, size_t count, size_t pattern) {
+  size_t *values = malloc(count * sizeof(size_t));
+  unsigned int state = 3;
+  size_t marker = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t key;
+    state = state * 1103515245 + 12345;
+
+    switch (pattern) {
+      case 0:
+        key = (state >> 8) % 500;
+        break;
+      case 1:
+        key = i;
+        break;
+      case 2:
+        key = count - i;
+        break;
+      case 3:
+        key = (state >> 8) % 20 == 0 ? (state >> 12) % count : i;
+        break;
+      case 4:
+        key = 7;
+        break;
+      default:
+        key = i % 37;
+        break;
+    }
+
+    values[i] = key * 100000 + i;
+    plist_append(list, &values[i]);
+  }
+
+  plist_sort(list, helper_key_comparator);
+  TEST_ASSERT_EQUAL(count, plist_size(list));
+
+  plist_cursor cursor;
+  void *element;
+  size_t previous = 0;
+  plist_cursor_init(&cursor, list);
+  while (plist_cursor_next(&cursor, &element)) {
+    size_t current = *(size_t *) element;
+    TEST_ASSERT_TRUE(previous / 100000 < current / 100000 ||
+                     (previous / 100000 == current / 100000 && previous <= current));
+    previous = current;
+  }
+
+  plist_append(list, &marker);
+  TEST_ASSERT_EQUAL_PTR(&marker, plist_get(list, count));
+  plist_clean(list);
+  free(values);
+}
+
+void test_sort_ShouldBeStableOnEveryInputShape(void) {
+  plist *unrolled = plist_create_unrolled();
+
+  for (size_t pattern = 0; pattern < 6; ++pattern) {
+    helper_sort_pattern(L, 3000, pattern);
+    helper_sort_pattern(unrolled, 3000, pattern);
+    helper_sort_pattern(L, 5, pattern);
+  }
+
+  plist_destroy(&unrolled);
+}
+
+void test_sort_ShouldSortLongListsWithoutRecursing(void) {
+  size_t count = 1u << 20;
+  size_t *values = malloc(count * sizeof(size_t));
+  unsigned int state = 5;
+
+  for (size_t i = 0; i < count; ++i) {
+    state = state * 1103515245 + 12345;
+    values[i] = state;
+    plist_append(L, &values[i]);
+  }
+
+  plist_sort(L, helper_comparator);
+
+  plist_cursor cursor;
+  void *element;
+  size_t previous = 0;
+  plist_cursor_init(&cursor, L);
+  while (plist_cursor_next(&cursor, &element)) {
+    TEST_ASSERT_TRUE(previous <= *(size_t *) element);
+    previous = *(size_t *) element;
+  }
+
+  plist_clean(L);
+  free(values);
+}
+
+static void helper_sort_parallel_against_sort(plist *(*create)(void), size_t count,
+                                              size_t nthreads) {
+  plist *sequential = create();
+  plist *parallel = create();
+  size_t *values = malloc(count * sizeof(size_t));
+  unsigned int state = 9;
+  size_t marker = 0;
+
+  for (size_t i = 0; i < count; ++i) {
+    state = state * 1103515245 + 12345;
+    values[i] = (i % 3 == 0 ? i / 100 : (state >> 8) % 1000) * 100000 + i;
+    plist_append(sequential, &values[i]);
+    plist_append(parallel, &values[i]);
+  }
+
+  plist_sort(sequential, helper_key_comparator);
+  plist_sort_parallel(parallel, helper_key_comparator, nthreads);
+  TEST_ASSERT_EQUAL(count, plist_size(parallel));
+
+  plist_cursor expected, actual;
+  void *a, *b;
+  plist_cursor_init(&expected, sequential);
+  plist_cursor_init(&actual, parallel);
+  while (plist_cursor_next(&expected, &a)) {
+    TEST_ASSERT_TRUE(plist_cursor_next(&actual, &b));
+    TEST_ASSERT_EQUAL_PTR(a, b);
+  }
+  TEST_ASSERT_FALSE(plist_cursor_next(&actual, &b));
+
+  plist_append(parallel, &marker);
+  TEST_ASSERT_EQUAL_PTR(&marker, plist_get(parallel, count));
+
+  plist_destroy(&sequential);
+  plist_destroy(&parallel);
+  free(values);
+}
+
+void test_sortParallel_ShouldMatchPlistSort(void) {
+  size_t threads[] = {2, 3, 4, 7};
+
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+    helper_sort_parallel_against_sort(plist_create, 100003, threads[t]);
+    helper_sort_parallel_against_sort(plist_create_unrolled, 100003, threads[t]);
+  }
+}
+
+void test_sortParallel_ShouldSortSmallListsToo(void) {
+  helper_sort_parallel_against_sort(plist_create, 10, 4);
+  helper_sort_parallel_against_sort(plist_create_pooled, 20000, 0);
+  plist_sort_parallel(L, helper_comparator, 4);
+  plist_sort_parallel(0, helper_comparator, 4);
+  TEST_ASSERT_TRUE(plist_is_empty(L));
+}
+
 void test_add_ShouldAddANewElement(void) {
   size_t x = 99;
   TEST_ASSERT_TRUE(plist_is_empty(L));
@@ -692,6 +853,277 @@ void test_removeDestroyingSelected_ShouldRemoveAndDestroyAnElementSelectedFromTh
   TEST_ASSERT_EQUAL_UINT(DATA_ARRAY_LEN, plist_size(L));
 }
 
+void test_unrolled_ShouldMatchALinkedListUnderRandomOperations(void) {
+  plist *linked = plist_create();
+  plist *unrolled = plist_create_unrolled();
+  size_t values[512];
+  unsigned int state = 7;
+
+  for (size_t i = 0; i < 512; ++i) {
+    values[i] = i;
+  }
+
+  for (size_t step = 0; step < 4000; ++step) {
+    state = state * 1103515245 + 12345;
+    size_t choice = (state >> 16) % 6;
+    size_t value = (state >> 8) % 512;
+    size_t index = plist_size(linked) ? (state >> 4) % (plist_size(linked) + 1) : 0;
+
+    switch (choice) {
+      case 0:
+        plist_append(linked, &values[value]);
+        plist_append(unrolled, &values[value]);
+        break;
+      case 1:
+        plist_prepend(linked, &values[value]);
+        plist_prepend(unrolled, &values[value]);
+        break;
+      case 2:
+      case 3:
+        plist_add(linked, index, &values[value]);
+        plist_add(unrolled, index, &values[value]);
+        break;
+      default:
+        TEST_ASSERT_EQUAL_PTR(plist_remove(linked, index), plist_remove(unrolled, index));
+        break;
+    }
+
+    TEST_ASSERT_EQUAL(plist_size(linked), plist_size(unrolled));
+  }
+
+  for (size_t i = 0; i < plist_size(linked); ++i) {
+    TEST_ASSERT_EQUAL_PTR(plist_get(linked, i), plist_get(unrolled, i));
+  }
+
+  while (!plist_is_empty(linked)) {
+    TEST_ASSERT_EQUAL_PTR(plist_remove(linked, 0), plist_remove(unrolled, 0));
+  }
+  TEST_ASSERT_TRUE(plist_is_empty(unrolled));
+  TEST_ASSERT_NULL(plist_get(unrolled, 0));
+
+  plist_destroy(&linked);
+  plist_destroy(&unrolled);
+}
+
+void test_unrolled_ShouldFilterMapSortAndFind(void) {
+  plist *unrolled = plist_create_unrolled();
+  size_t values[100];
+
+  for (size_t i = 0; i < 100; ++i) {
+    values[i] = (i * 37) % 100;
+    plist_append(unrolled, &values[i]);
+  }
+
+  plist *even = plist_filter(unrolled, helper_is_even);
+  TEST_ASSERT_EQUAL(50, plist_size(even));
+  TEST_ASSERT_EQUAL(50, plist_count_matching(unrolled, helper_is_even));
+
+  plist *mapped = plist_map(unrolled, helper_mapper);
+  TEST_ASSERT_EQUAL(100, plist_size(mapped));
+  TEST_ASSERT_EQUAL(74, *(size_t *)plist_get(mapped, 1));
+
+  size_t index = 0;
+  TEST_ASSERT_EQUAL_PTR(&values[27], plist_find(unrolled, helper_is_99, &index));
+  TEST_ASSERT_EQUAL(27, index);
+
+  plist_sort(unrolled, helper_comparator);
+  for (size_t i = 0; i < 100; ++i) {
+    TEST_ASSERT_EQUAL(i, *(size_t *)plist_get(unrolled, i));
+  }
+
+  TEST_ASSERT_EQUAL_PTR(&values[27], plist_remove_selected(unrolled, helper_is_99));
+  TEST_ASSERT_EQUAL(99, plist_size(unrolled));
+
+  plist_destroy(&even);
+  plist_destroy_all(&mapped, free);
+  plist_destroy(&unrolled);
+}
+
+void test_unrolled_ShouldFreeChunksEmptiedOneElementAtATime(void) {
+  plist *unrolled = plist_create_unrolled();
+  size_t values[4 * PLIST_CHUNK_SLOTS];
+  plist_cursor cursor;
+  void *element;
+
+  for (size_t i = 0; i < 4 * PLIST_CHUNK_SLOTS; ++i) {
+    values[i] = i;
+    plist_append(unrolled, &values[i]);
+  }
+  TEST_ASSERT_EQUAL(4, plist_chunk_count(unrolled));
+  TEST_ASSERT_EQUAL(0, plist_chunk_count(L));
+
+  /* the last chunk, then the first one */
+  threshold = 3 * PLIST_CHUNK_SLOTS;
+  for (size_t i = threshold; i < 4 * PLIST_CHUNK_SLOTS; ++i) {
+    TEST_ASSERT_EQUAL_PTR(&values[i], plist_remove_selected(unrolled, helper_is_at_least_threshold));
+  }
+  TEST_ASSERT_EQUAL(3, plist_chunk_count(unrolled));
+
+  threshold = PLIST_CHUNK_SLOTS;
+  for (size_t i = 0; i < threshold; ++i) {
+    TEST_ASSERT_EQUAL_PTR(&values[i], plist_remove_selected(unrolled, helper_is_below_threshold));
+  }
+  TEST_ASSERT_EQUAL(2, plist_chunk_count(unrolled));
+
+  /* a cursor emptying the last chunk stays usable at the end of the list */
+  plist_cursor_init(&cursor, unrolled);
+  while (plist_cursor_next(&cursor, &element)) {
+    if (*(size_t *)element >= 2 * PLIST_CHUNK_SLOTS) {
+      plist_cursor_remove_current(&cursor);
+    }
+  }
+  TEST_ASSERT_EQUAL(1, plist_chunk_count(unrolled));
+  plist_cursor_insert_after(&cursor, &values[0]);
+  TEST_ASSERT_TRUE(plist_cursor_next(&cursor, &element));
+  TEST_ASSERT_EQUAL_PTR(&values[0], element);
+  TEST_ASSERT_FALSE(plist_cursor_next(&cursor, &element));
+
+  TEST_ASSERT_EQUAL(PLIST_CHUNK_SLOTS + 1, plist_size(unrolled));
+  for (size_t i = 0; i < PLIST_CHUNK_SLOTS; ++i) {
+    TEST_ASSERT_EQUAL_PTR(&values[PLIST_CHUNK_SLOTS + i], plist_get(unrolled, i));
+  }
+  TEST_ASSERT_EQUAL_PTR(&values[0], plist_get(unrolled, PLIST_CHUNK_SLOTS));
+
+  plist_destroy(&unrolled);
+}
+
+void test_find_ShouldReturnNullWhenNothingMatches(void) {
+  size_t index = 42;
+
+  helper_load_default_list();
+  TEST_ASSERT_NULL(plist_find(L, helper_is_99, &index));
+  TEST_ASSERT_EQUAL(42, index);
+  TEST_ASSERT_NULL(plist_remove_selected(L, helper_is_99));
+  TEST_ASSERT_EQUAL(DATA_ARRAY_LEN, plist_size(L));
+}
+
+void test_cursor_ShouldRemoveEvenElementsInOnePass(void) {
+  plist_cursor cursor;
+  void *element;
+
+  helper_load_default_list();
+  plist_cursor_init(&cursor, L);
+  TEST_ASSERT_NULL(plist_cursor_remove_current(&cursor));
+
+  while (plist_cursor_next(&cursor, &element)) {
+    if (helper_is_even(element)) {
+      TEST_ASSERT_EQUAL_PTR(element, plist_cursor_remove_current(&cursor));
+      TEST_ASSERT_NULL(plist_cursor_remove_current(&cursor));
+    }
+  }
+
+  TEST_ASSERT_EQUAL(DATA_ARRAY_LEN / 2, plist_size(L));
+  for (size_t i = 0; i < plist_size(L); ++i) {
+    TEST_ASSERT_EQUAL(2 * i + 1, *(size_t *)plist_get(L, i));
+  }
+
+  plist_append(L, &data[1]);
+  TEST_ASSERT_EQUAL_PTR(&data[1], plist_get(L, DATA_ARRAY_LEN / 2));
+}
+
+void test_cursor_ShouldHaveNoCurrentElementOnceExhausted(void) {
+  plist *lists[] = {L, plist_create_unrolled()};
+  plist_cursor cursor;
+  void *element;
+
+  for (size_t l = 0; l < 2; ++l) {
+    for (size_t i = 0; i < 3; ++i) {
+      plist_append(lists[l], &data[i]);
+    }
+
+    plist_cursor_init(&cursor, lists[l]);
+    while (plist_cursor_next(&cursor, &element)) {
+    }
+    TEST_ASSERT_FALSE(plist_cursor_next(&cursor, &element));
+    TEST_ASSERT_NULL(plist_cursor_remove_current(&cursor));
+    TEST_ASSERT_EQUAL(3, plist_size(lists[l]));
+
+    plist_cursor_insert_after(&cursor, &data[3]);
+    TEST_ASSERT_EQUAL_PTR(&data[3], plist_get(lists[l], 3));
+  }
+
+  plist_destroy(&lists[1]);
+}
+
+/* Replays the same random cursor operations on a list and on an array */
+static void helper_cursor_against_array(plist *list) {
+  size_t values[64];
+  void *model[4096];
+  size_t size = 0;
+  unsigned int state = 11;
+
+  for (size_t i = 0; i < 64; ++i) {
+    values[i] = i;
+  }
+
+  for (int pass = 0; pass < 60; ++pass) {
+    plist_cursor cursor;
+    size_t position = 0;
+    bool has_current = false;
+    void *element;
+
+    plist_cursor_init(&cursor, list);
+
+    for (;;) {
+      state = state * 1103515245 + 12345;
+      size_t choice = (state >> 16) % 8;
+
+      /* the last passes only remove, to empty and merge chunks */
+      if (pass >= 50 && choice >= 3) {
+        choice = 5;
+      }
+
+      if (choice < 3) {
+        TEST_ASSERT_EQUAL_PTR(position < size ? model[position] : 0, plist_cursor_peek(&cursor));
+        if (!plist_cursor_next(&cursor, &element)) {
+          TEST_ASSERT_EQUAL(size, position);
+          break;
+        }
+        TEST_ASSERT_EQUAL_PTR(model[position], element);
+        position++;
+        has_current = true;
+      } else if (choice < 5 && size < 4000) {
+        void *inserted = &values[(state >> 8) % 64];
+        plist_cursor_insert_after(&cursor, inserted);
+        memmove(&model[position + 1], &model[position], (size - position) * sizeof(void *));
+        model[position] = inserted;
+        size++;
+      } else {
+        void *removed = plist_cursor_remove_current(&cursor);
+        if (!has_current) {
+          TEST_ASSERT_NULL(removed);
+          continue;
+        }
+        position--;
+        TEST_ASSERT_EQUAL_PTR(model[position], removed);
+        memmove(&model[position], &model[position + 1], (size - position - 1) * sizeof(void *));
+        size--;
+        has_current = false;
+      }
+    }
+
+    TEST_ASSERT_EQUAL(size, plist_size(list));
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    TEST_ASSERT_EQUAL_PTR(model[i], plist_get(list, i));
+  }
+  if (size > 1) {
+    TEST_ASSERT_EQUAL_PTR(model[0], plist_remove(list, 0));
+    TEST_ASSERT_EQUAL_PTR(model[size - 1], plist_remove(list, size - 2));
+  }
+}
+
+void test_cursor_ShouldMatchAnArrayOnALinkedList(void) {
+  helper_cursor_against_array(L);
+}
+
+void test_cursor_ShouldMatchAnArrayOnAnUnrolledList(void) {
+  plist *unrolled = plist_create_unrolled();
+  helper_cursor_against_array(unrolled);
+  plist_destroy(&unrolled);
+}
+
 int main(void) {
   UNITY_BEGIN();
 
@@ -709,6 +1141,10 @@ int main(void) {
   RUN_TEST(test_sort_ShouldHandleAnEmptyList);
   RUN_TEST(test_sort_ShouldNotErrorWithANullList);
   RUN_TEST(test_sort_ShouldHandleAListWithTwoElements);
+  RUN_TEST(test_sort_ShouldBeStableOnEveryInputShape);
+  RUN_TEST(test_sort_ShouldSortLongListsWithoutRecursing);
+  RUN_TEST(test_sortParallel_ShouldMatchPlistSort);
+  RUN_TEST(test_sortParallel_ShouldSortSmallListsToo);
 
   RUN_TEST(test_add_ShouldAddANewElement);
   RUN_TEST(test_add_ShouldAddANewElementAndCheckIt);
@@ -793,5 +1229,16 @@ int main(void) {
 
   RUN_TEST(test_removeDestroyingSelected_ShouldRemoveAndDestroyAnElementSelectedFromTheList);
 
+  RUN_TEST(test_unrolled_ShouldMatchALinkedListUnderRandomOperations);
+  RUN_TEST(test_unrolled_ShouldFilterMapSortAndFind);
+  RUN_TEST(test_unrolled_ShouldFreeChunksEmptiedOneElementAtATime);
+
+  RUN_TEST(test_find_ShouldReturnNullWhenNothingMatches);
+
+  RUN_TEST(test_cursor_ShouldRemoveEvenElementsInOnePass);
+  RUN_TEST(test_cursor_ShouldHaveNoCurrentElementOnceExhausted);
+  RUN_TEST(test_cursor_ShouldMatchAnArrayOnALinkedList);
+  RUN_TEST(test_cursor_ShouldMatchAnArrayOnAnUnrolledList);
+
   return UNITY_END();
 }
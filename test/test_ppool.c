@@ -0,0 +1,149 @@
+/***************************************************************************
+ * Copyright (C) 2016 - 2022 Patricio Bonsembiante. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ***************************************************************************/
+
+#include "putils/plist.h"
+#include "putils/ppool.h"
+#include "unity.h"
+
+ppool *P = 0;
+
+static bool helper_always(const void *data) { return data != 0; }
+
+void setUp(void) { P = ppool_create(sizeof(plist_node), 4); }
+
+void tearDown(void) { ppool_destroy(P); }
+
+void test_alloc_ShouldCarveObjectsOutOfSlabs(void) {
+  ppool_stats stats;
+  void *objects[9];
+
+  for (size_t i = 0; i < 9; ++i) {
+    objects[i] = ppool_alloc(P);
+    TEST_ASSERT_NOT_NULL(objects[i]);
+    for (size_t j = 0; j < i; ++j) {
+      TEST_ASSERT_NOT_EQUAL(objects[j], objects[i]);
+    }
+  }
+
+  ppool_get_stats(P, &stats);
+  TEST_ASSERT_EQUAL(3, stats.slabs);
+  TEST_ASSERT_EQUAL(9, stats.allocations);
+  TEST_ASSERT_EQUAL(0, stats.reuses);
+  TEST_ASSERT_EQUAL(9, stats.in_use);
+}
+
+void test_free_ShouldReuseFreedObjectsBeforeGrowing(void) {
+  ppool_stats stats;
+  void *first = ppool_alloc(P);
+  void *second = ppool_alloc(P);
+
+  ppool_free(P, first);
+  ppool_free(P, second);
+  ppool_free(P, 0);
+
+  TEST_ASSERT_EQUAL_PTR(second, ppool_alloc(P));
+  TEST_ASSERT_EQUAL_PTR(first, ppool_alloc(P));
+
+  ppool_get_stats(P, &stats);
+  TEST_ASSERT_EQUAL(1, stats.slabs);
+  TEST_ASSERT_EQUAL(2, stats.reuses);
+  TEST_ASSERT_EQUAL(2, stats.in_use);
+  TEST_ASSERT_TRUE(ppool_reuse_rate(P) > 0.49 && ppool_reuse_rate(P) < 0.51);
+}
+
+void test_reuseRate_ShouldBeZeroOnANewPool(void) {
+  TEST_ASSERT_TRUE(ppool_reuse_rate(P) == 0);
+}
+
+void test_create_ShouldRoundTinyObjectsUpToAPointer(void) {
+  ppool *tiny = ppool_create(1, 0);
+  char *a = ppool_alloc(tiny);
+  char *b = ppool_alloc(tiny);
+
+  TEST_ASSERT_EQUAL(sizeof(void *), (size_t)(b - a));
+  ppool_free(tiny, a);
+  TEST_ASSERT_EQUAL_PTR(a, ppool_alloc(tiny));
+  ppool_destroy(tiny);
+}
+
+void test_pooledList_ShouldRecycleNodes(void) {
+  plist *list = plist_create_pooled();
+  ppool_stats stats;
+  size_t values[100];
+
+  for (int round = 0; round < 10; ++round) {
+    for (size_t i = 0; i < 100; ++i) {
+      values[i] = i;
+      plist_append(list, &values[i]);
+    }
+    for (size_t i = 0; i < 100; ++i) {
+      TEST_ASSERT_EQUAL_PTR(&values[i], plist_remove(list, 0));
+    }
+  }
+
+  TEST_ASSERT_TRUE(plist_pool_stats(list, &stats));
+  TEST_ASSERT_EQUAL(1000, stats.allocations);
+  TEST_ASSERT_EQUAL(900, stats.reuses);
+  TEST_ASSERT_EQUAL(0, stats.in_use);
+
+  plist_append(list, &values[0]);
+  plist *filtered = plist_filter(list, helper_always);
+  TEST_ASSERT_TRUE(plist_pool_stats(filtered, &stats));
+  TEST_ASSERT_EQUAL(1, stats.in_use);
+  plist_destroy(&filtered);
+  plist_destroy(&list);
+}
+
+void test_poolStats_ShouldFailOnAListWithoutPool(void) {
+  plist *list = plist_create();
+  ppool_stats stats;
+
+  TEST_ASSERT_FALSE(plist_pool_stats(list, &stats));
+  TEST_ASSERT_FALSE(plist_pool_stats(0, &stats));
+  plist_destroy(&list);
+}
+
+void test_pooledList_ShouldBehaveLikeALinkedList(void) {
+  plist *list = plist_create_pooled();
+  size_t values[5] = {4, 2, 0, 3, 1};
+
+  for (size_t i = 0; i < 5; ++i) {
+    plist_prepend(list, &values[i]);
+  }
+  plist_add(list, 2, &values[2]);
+  TEST_ASSERT_EQUAL_PTR(&values[2], plist_remove(list, 2));
+  plist_clean(list);
+  TEST_ASSERT_TRUE(plist_is_empty(list));
+
+  plist_append(list, &values[1]);
+  TEST_ASSERT_EQUAL_PTR(&values[1], plist_get(list, 0));
+  plist_destroy(&list);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+
+  RUN_TEST(test_alloc_ShouldCarveObjectsOutOfSlabs);
+  RUN_TEST(test_free_ShouldReuseFreedObjectsBeforeGrowing);
+  RUN_TEST(test_reuseRate_ShouldBeZeroOnANewPool);
+  RUN_TEST(test_create_ShouldRoundTinyObjectsUpToAPointer);
+
+  RUN_TEST(test_pooledList_ShouldRecycleNodes);
+  RUN_TEST(test_pooledList_ShouldBehaveLikeALinkedList);
+  RUN_TEST(test_poolStats_ShouldFailOnAListWithoutPool);
+
+  return UNITY_END();
+}
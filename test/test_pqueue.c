@@ -130,12 +130,31 @@ void test_cleanDestroy_ShouldDestroyTheQueueAndEveryElementInIt(void) {
   TEST_ASSERT_TRUE(pqueue_is_empty(Q));
 }
 
+void test_createPooled_ShouldKeepFifoOrderWhileRecyclingNodes(void) {
+  pqueue *queue = pqueue_create_pooled();
+  size_t values[6] = {0, 1, 2, 3, 4, 5};
+
+  pqueue_enqueue(queue, &values[0]);
+  pqueue_enqueue(queue, &values[1]);
+  TEST_ASSERT_EQUAL_PTR(&values[0], pqueue_dequeue(queue));
+  for (size_t i = 2; i < 6; ++i) {
+    pqueue_enqueue(queue, &values[i]);
+  }
+  for (size_t i = 1; i < 6; ++i) {
+    TEST_ASSERT_EQUAL_PTR(&values[i], pqueue_dequeue(queue));
+  }
+  TEST_ASSERT_TRUE(pqueue_is_empty(queue));
+
+  pqueue_destroy(&queue);
+}
+
 int main(void) {
   UNITY_BEGIN();
 
   RUN_TEST(test_create_ShouldCreateAnEmptyQueue);
   RUN_TEST(test_create_ShouldCreateAnEmptyQueue);
   RUN_TEST(test_create_ShouldCreateAZeroSizeQueue);
+  RUN_TEST(test_createPooled_ShouldKeepFifoOrderWhileRecyclingNodes);
 
   RUN_TEST(test_dequeue_ShouldNotDequeueFromAnEmptyQueue);
   RUN_TEST(test_dequeue_ShouldRemoveAnElementFromTheQueue);
@@ -96,10 +96,30 @@ void test_peek_ShouldRetrieveTheTopElementFromTheStackButNotPopIt(void) {
   TEST_ASSERT_EQUAL_UINT(3, pstack_size(S));
 }
 
+void test_createPooled_ShouldKeepLifoOrderWhileRecyclingNodes(void) {
+  pstack *stack = pstack_create_pooled();
+  size_t values[6] = {0, 1, 2, 3, 4, 5};
+
+  pstack_push(stack, &values[0]);
+  pstack_push(stack, &values[1]);
+  TEST_ASSERT_EQUAL_PTR(&values[1], pstack_pop(stack));
+  for (size_t i = 2; i < 6; ++i) {
+    pstack_push(stack, &values[i]);
+  }
+  for (size_t i = 5; i > 1; --i) {
+    TEST_ASSERT_EQUAL_PTR(&values[i], pstack_pop(stack));
+  }
+  TEST_ASSERT_EQUAL_PTR(&values[0], pstack_pop(stack));
+  TEST_ASSERT_EQUAL_UINT(0, pstack_size(stack));
+
+  pstack_destroy(&stack);
+}
+
 int main(void) {
   UNITY_BEGIN();
 
   RUN_TEST(test_create_ShouldCreateAnEmptyStack);
+  RUN_TEST(test_createPooled_ShouldKeepLifoOrderWhileRecyclingNodes);
 
   RUN_TEST(test_pop_ShouldNotPopFromAnEmptyStack);
   RUN_TEST(test_pop_ShouldRemoveAnElementFromTheStack);